@@ -0,0 +1,203 @@
+"""
+
+Counting and index calculation for many sequences at once, with results
+written into caller provided arrays. Included into `codonw.pyx`.
+
+"""
+
+from libc.stdlib cimport malloc, free
+
+index_names = ['CAI', 'Fop', 'CBI', 'Nc', 'Gravy', 'Aromo', 'GC', 'GC3s',
+               'L_sym', 'L_aa', 'T3s', 'C3s', 'A3s', 'G3s']
+
+
+def count_sequences(seqs, genetic_code=0, ids=None, int threads=1, dtype=None,
+                    bool hash=False, bool translate=False):
+    """Counts the codon and amino acid usage of many sequences, returning
+    a `CodonCounts`
+
+    `seqs`: sequences as `str` or `bytes`, or a `pd.Series` of them (whose
+        index is used as `ids`)
+    `genetic_code`: as for `CodonSeq`
+    `ids`: identifiers of the sequences, by default their position
+    `threads`: number of threads to count on
+    `dtype`: element type of the count matrices, see `CodonCounts.astype`.
+        "auto" picks the narrowest one that fits the longest sequence.
+    `hash`: also hash each sequence as it is counted, so that identical
+        sequences can be found (see `CodonCounts.unique`)
+    `translate`: also translate each sequence as it is counted, and return
+        the proteins as well, as a `pd.Series` of `str` indexed by `ids`.
+        Each complete codon becomes its one letter amino acid (`ref_aa1`),
+        stops "*" and codons with other characters "X". A trailing partial
+        codon is left out.
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+
+    if isinstance(seqs, pd.Series):
+        if ids is None:
+            ids = seqs.index
+        seqs = seqs.values
+    data = [s.encode('ascii') if isinstance(s, str) else bytes(s) for s in seqs]
+    cdef long n = len(data)
+    if ids is None:
+        ids = np.arange(n)
+
+    lens = np.array([len(s) for s in data], dtype=np.longlong)
+    cdef long long[::1] lens_v = lens
+    # no count can exceed the number of (partial) codons
+    dtype = _count_dtype(dtype, (lens.max(initial=0) + 2) // 3)
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(dtype)
+
+    cdef np.ndarray ncod = np.zeros([n, 65], dtype=dtype)
+    cdef np.ndarray naa = np.zeros([n, 22], dtype=dtype)
+    codon_tot = np.zeros([n], dtype=c_long)
+    valid_stops = np.zeros([n], dtype=c_int)
+    cdef long[::1] tot_v = codon_tot
+    cdef int[::1] stops_v = valid_stops
+    digests = np.zeros([n, 2], dtype=np.uint64) if hash else None
+    cdef void *pdigest = NULL
+
+    prot_off = np.zeros([n + 1], dtype=np.longlong)
+    np.cumsum(lens // 3, out=prot_off[1:])
+    cdef long long[::1] off_v = prot_off
+    prot = bytearray(prot_off[n] if translate else 0)
+    cdef char *pprot = NULL
+
+    if n == 0:
+        counts = CodonCounts(ids, ncod, naa, codon_tot, valid_stops, genetic_code,
+                             digests=digests)
+        return (counts, pd.Series([], index=counts.ids, dtype=object)) if translate else counts
+    if hash:
+        pdigest = np.PyArray_DATA(digests)
+    if translate and prot_off[n]:
+        pprot = prot
+
+    cdef const char **ptrs = <const char **>malloc(n * sizeof(char *))
+    if ptrs == NULL:
+        raise MemoryError()
+    cdef long i
+    try:
+        for i in range(n):
+            ptrs[i] = <bytes>data[i]
+        with nogil:
+            codonwlib.count_seqs(n, ptrs, &lens_v[0], &code,
+                                 np.PyArray_DATA(ncod), np.PyArray_DATA(naa), ctype,
+                                 &tot_v[0], &stops_v[0], <uint64_t (*)[2]>pdigest,
+                                 pprot, &off_v[0], max(threads, 1))
+    finally:
+        free(ptrs)
+
+    counts = CodonCounts(ids, ncod, naa, codon_tot, valid_stops, genetic_code,
+                         digests=digests)
+    if not translate:
+        return counts
+    text = prot.decode('ascii')
+    proteins = [text[prot_off[i]:prot_off[i + 1]] for i in range(n)]
+    return counts, pd.Series(proteins, index=counts.ids, dtype=object)
+
+
+def compute_indices(counts, indices=None, int cai_ref=0, int fop_ref=0,
+                    int cbi_ref=0, bool factor_in_rare=False, out=None,
+                    long row_offset=0, int threads=1, bool dedup=False):
+    """Calculates indices for every sequence of a `CodonCounts`
+
+    `indices`: names from `index_names` to calculate (default all), giving
+        the order of the result columns. Nc is NaN where it can not be
+        calculated.
+    `cai_ref`, `fop_ref`, `cbi_ref`, `factor_in_rare`: as for `CodonSeq`
+    `out`: a float64 array (or a `multiprocessing.shared_memory.SharedMemory`
+        viewed as one) with a column per index, into which the results are
+        written starting at row `row_offset`. Lets workers that each count
+        part of a data set fill one shared result table without copies.
+    `threads`: number of threads to calculate on
+    `dedup`: calculate indices once per unique sequence and copy them to
+        the identical ones, for counts made with `hash=True`. The fraction
+        of rows saved is in `attrs['dedup_ratio']` of the result.
+
+    Counts held as any of `count_dtypes` are used as they are, and widened
+    one row at a time as indices are calculated.
+
+    Returns a `pd.DataFrame` if `out` is None, otherwise the array written to.
+    """
+    if indices is None:
+        indices = index_names
+    indices = list(indices)
+    unknown = [i for i in indices if i not in index_names]
+    if unknown:
+        raise ValueError("Unknown indices: {}".format(", ".join(map(str, unknown))))
+    _check_refs(cai_ref, fop_ref, cbi_ref)
+
+    cdef long n = len(counts)
+    cdef int nwhich = len(indices)
+    which = np.array([index_names.index(i) for i in indices], dtype=c_int)
+    cdef int[::1] which_v = which
+
+    result = out
+    if out is None:
+        result = np.empty([n, nwhich], dtype=c_double)
+        row_offset = 0
+    elif hasattr(out, 'buf'):
+        # multiprocessing.shared_memory.SharedMemory
+        result = np.ndarray([out.size // (8 * max(nwhich, 1)), nwhich],
+                            dtype=np.float64, buffer=out.buf)
+    if (not isinstance(result, np.ndarray) or result.dtype != np.float64 or
+            result.ndim != 2 or result.shape[1] != nwhich):
+        raise ValueError("out must be a float64 array with {} columns".format(nwhich))
+    if row_offset < 0 or row_offset + n > result.shape[0]:
+        raise ValueError("out has too few rows for {} results at row {}".format(n, row_offset))
+
+    ratio = 0.0
+    if dedup and n and nwhich:
+        uniq, inverse = counts.unique()
+        ratio = 1 - len(uniq) / n
+        part = compute_indices(uniq, indices, cai_ref, fop_ref, cbi_ref,
+                               factor_in_rare, threads=threads)
+        result[row_offset:row_offset + n] = part.values[inverse]
+    elif n and nwhich:
+        ncod, naa = counts.ncod, counts.naa
+        if ncod.dtype != naa.dtype or ncod.dtype not in count_dtypes:
+            ncod, naa = ncod.astype(c_long), naa.astype(c_long)
+        ncod, naa = np.ascontiguousarray(ncod), np.ascontiguousarray(naa)
+        _compute_into(ncod, naa, which_v, result, row_offset, counts.genetic_code,
+                      cai_ref, fop_ref, cbi_ref, factor_in_rare, threads)
+
+    if out is None:
+        df = pd.DataFrame(result, index=counts.ids, columns=indices)
+        df.attrs['dedup_ratio'] = ratio
+        return df
+    return result
+
+
+def _check_refs(cai_ref, fop_ref, cbi_ref):
+    """Raises `ValueError` unless the references are built in"""
+    if not 0 <= cai_ref < codonwlib.NUM_CAI_SPECIES:
+        raise ValueError("cai_ref must be between 0 and {}".format(codonwlib.NUM_CAI_SPECIES - 1))
+    for ref in (fop_ref, cbi_ref):
+        if not 0 <= ref < codonwlib.NUM_FOP_SPECIES:
+            raise ValueError("fop_ref and cbi_ref must be between 0 and {}".format(
+                codonwlib.NUM_FOP_SPECIES - 1))
+
+
+cdef _compute_into(np.ndarray ncod, np.ndarray naa, int[::1] which,
+                   double[:, :] result, long row_offset, genetic_code,
+                   int cai_ref, int fop_ref, int cbi_ref, bool factor_in_rare,
+                   int threads):
+    """Runs `batch_indices` over all rows, writing from `row_offset` on
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT plan
+    cdef codonwlib.INDEX_PLAN_STRUCT pi
+    cdef long n = ncod.shape[0]
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(ncod.dtype)
+
+    if result.strides[1] != sizeof(double) or result.strides[0] % sizeof(double):
+        raise ValueError("out must have contiguous rows")
+
+    codonwlib.code_plan_init(&plan, &code)
+    codonwlib.index_plan_init(&pi, &plan, &codonwlib.cai_ref[cai_ref],
+                              &codonwlib.fop_ref[fop_ref], &codonwlib.fop_ref[cbi_ref],
+                              &codonwlib.amino_prop, factor_in_rare)
+    with nogil:
+        codonwlib.batch_indices(n, np.PyArray_DATA(ncod), np.PyArray_DATA(naa), ctype,
+                                &which[0], which.shape[0], &result[row_offset, 0],
+                                result.strides[0] // sizeof(double), &pi, max(threads, 1))
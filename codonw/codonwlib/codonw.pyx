@@ -10,8 +10,11 @@ from the C code.
 
 from libcpp cimport bool
 from cython.operator cimport dereference
+from libc.stdint cimport uint64_t
 from ctypes import c_int, c_long, c_float, c_double
 
+import pickle
+
 import numpy as np
 cimport numpy as np
 np.import_array()
@@ -40,6 +43,29 @@ def get_reference_code(idx):
     cseq = CodonSeq("ATG", idx)
     return cseq.genetic_code
 
+cdef codonwlib.GENETIC_CODE_STRUCT _resolve_code(object genetic_code) except *:
+    """Looks up a reference genetic code by index or builds one from a
+    `pd.Series` mapping codons to single letter amino acids
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code
+    if isinstance(genetic_code, int):
+        if not 0 <= genetic_code < codonwlib.NUM_GENETIC_CODES:
+            raise ValueError("genetic_code must be between 0 and {}".format(
+                codonwlib.NUM_GENETIC_CODES - 1))
+        return codonwlib.cu_ref[genetic_code]
+
+    ser = genetic_code
+    if 'UNK' not in ser:
+        ser['UNK'] = 'X'
+
+    # place in required order and map amino acids letter to code
+    ser = ser[ref_codons]
+    aa_to_idx = pd.Series(np.arange(len(ref_aa1)), index=ref_aa1)
+
+    code = codonwlib.GENETIC_CODE_STRUCT(b"", b"")
+    code.ca = aa_to_idx[ser].values
+    return code
+
 cdef class CodonSeq:
     # Use memory view to arrays
     # https://suzyahyah.github.io/cython/programming/2018/12/01/Gotchas-in-Cython.html
@@ -52,8 +78,11 @@ cdef class CodonSeq:
     cdef public int valid_stops
     cdef public long[::1] ncod
     cdef public long[::1] naa
+    cdef public object din
+    cdef public object code_key
+    cdef public object packed
 
-    def __init__(self, object seq, genetic_code=0):
+    def __init__(self, object seq, genetic_code=0, bool pack=False):
         """Initializes an object of class CodonSeq
 
         `seq`: the nucleotide sequence to be analyzed/for which metrics are desired
@@ -68,22 +97,24 @@ cdef class CodonSeq:
             6. Nuclear code of Euplotes
             7. Mitochondrial code of Echinoderms
 
-        """
-        self.dds = np.zeros([65], dtype=c_int)
-        self.dda = np.zeros([23], dtype=c_int)
-
-        if isinstance(genetic_code, int):
-            self.ref_code = codonwlib.cu_ref[genetic_code]
-        else:
-            self.genetic_code = genetic_code
+        `pack`: keep the sequence as a `PackedSeq` (2 bits per base, packed
+            as it is counted) in `CodonSeq.packed` rather than as bytes
 
-        codonwlib.how_synon(&self.dds[0], &self.ref_code)
-        codonwlib.how_synon_aa(&self.dda[0], &self.ref_code)
+        """
+        self._init_code(genetic_code)
 
         self.codon_tot = 0
         self.valid_stops = 0
         self.ncod = np.zeros([65], dtype=c_long)
         self.naa = np.zeros([22], dtype=c_long)
+        self.din = None
+        self.packed = None
+
+        if pack:
+            self.seq = None
+            self.packed = PackedSeq()
+            self.packed._pack_counting(seq, self)
+            return
 
         self.seq = seq.encode()
         codonwlib.codon_usage_tot(<char *>self.seq,
@@ -91,6 +122,45 @@ cdef class CodonSeq:
         
         return
 
+    cdef _init_code(self, genetic_code):
+        self.dds = np.zeros([65], dtype=c_int)
+        self.dda = np.zeros([23], dtype=c_int)
+
+        self.ref_code = _resolve_code(genetic_code)
+        self.code_key = genetic_code if isinstance(genetic_code, int) else None
+
+        codonwlib.how_synon(&self.dds[0], &self.ref_code)
+        codonwlib.how_synon_aa(&self.dda[0], &self.ref_code)
+        return
+
+    @staticmethod
+    def from_counts(ncod, naa, long codon_tot=0, int valid_stops=0, genetic_code=0, din=None):
+        """Initializes an object of class CodonSeq from precomputed counts
+
+        `ncod`: codon counts, 65 values in the order of `ref_codons`
+        `naa`: amino acid counts, 22 values in the order of `ref_aa1`
+        `din`: optional 3x16 dinucleotide counts by frame
+
+        No sequence is kept, so `CodonSeq.dinuc` is only available if
+        `din` is provided.
+        """
+        cdef CodonSeq cseq = CodonSeq.__new__(CodonSeq)
+        cseq._init_code(genetic_code)
+
+        ncod = np.array(ncod, dtype=c_long)
+        naa = np.array(naa, dtype=c_long)
+        if ncod.shape != (65,) or naa.shape != (22,):
+            raise ValueError("ncod and naa must have 65 and 22 values")
+
+        cseq.ncod = ncod
+        cseq.naa = naa
+        cseq.codon_tot = codon_tot
+        cseq.valid_stops = valid_stops
+        cseq.seq = None
+        cseq.packed = None
+        cseq.din = None if din is None else np.array(din, dtype=c_long).reshape([3, 16])
+        return cseq
+
     # Read/Set genetic code through pd.Series
     @property
     def genetic_code(self):
@@ -100,17 +170,35 @@ cdef class CodonSeq:
 
     @genetic_code.setter
     def genetic_code(self, ser):
-        if 'UNK' not in ser:
-            ser['UNK'] = 'X'
-        
-        # place in required order and map amino acids letter to code
-        ser = ser[ref_codons]
-        aa_to_idx = pd.Series(np.arange(len(ref_aa1)), index=ref_aa1)
-
-        self.ref_code = codonwlib.GENETIC_CODE_STRUCT(b"", b"")
-        self.ref_code.ca = aa_to_idx[ser].values
+        self.ref_code = _resolve_code(ser)
+        self.code_key = ser if isinstance(ser, int) else None
         return
 
+    def __reduce_ex__(self, protocol):
+        """Pickles the counts and the genetic code (its index, or the
+        amino acid of each codon for a custom code) but not the sequence,
+        so objects move cheaply between processes. With pickle protocol 5
+        the count arrays are passed as out-of-band buffers.
+
+        An unpickled object can only report `CodonSeq.dinuc` if it was
+        made from dinucleotide counts, e.g. by `CodonStream`.
+        """
+        code = self.code_key
+        if code is None:
+            code = bytes(np.asarray(<int[:65]>self.ref_code.ca, dtype=np.uint8))
+
+        ncod = np.ascontiguousarray(self.ncod)
+        naa = np.ascontiguousarray(self.naa)
+        if protocol >= 5:
+            ncod = pickle.PickleBuffer(ncod)
+            naa = pickle.PickleBuffer(naa)
+        else:
+            ncod = ncod.tobytes()
+            naa = naa.tobytes()
+
+        return (_codonseq_from_state,
+                (code, ncod, naa, self.codon_tot, self.valid_stops, self.din))
+
 
     cpdef double cai(self, int cai_ref=0):
         """Calculates Codon Adaptation Index
@@ -284,6 +372,12 @@ cdef class CodonSeq:
             <int (*)>codonwlib.amino_prop.aromo)
         return aromo_val
 
+    def protein_properties(self, properties=None, scales=None, ph=7.0):
+        """Composition based properties of the hypothetical translated gene
+        product (molecular weight, pI, charge, ...) as a `pd.Series`, see
+        `protein_properties`
+        """
+        return protein_properties(self, properties, scales, ph)
 
     cpdef np.ndarray[dtype=double, ndim=1, mode="c"] silent_base_usage_(self):
         cdef np.ndarray[dtype=double, ndim=1, mode="c"] base_sil_vals = np.zeros([4], dtype=c_double)
@@ -408,9 +502,21 @@ cdef class CodonSeq:
         cdef np.ndarray[dtype=long, ndim=2, mode="c"] dinuc_frames = np.zeros([4, 16], dtype=c_long)
         cdef np.ndarray[dtype=long, ndim=1, mode="c"] dinuc_tot = np.zeros([4], dtype=c_long)
         cdef int fram = 0
-
-        cdef int ret = codonwlib.dinuc_count(<char *>self.seq,
-            <long (*)[16]>&dinuc_frames[0, 0], &dinuc_tot[0], &fram)
+        cdef int ret
+
+        if self.seq is not None:
+            ret = codonwlib.dinuc_count(<char *>self.seq,
+                <long (*)[16]>&dinuc_frames[0, 0], &dinuc_tot[0], &fram)
+        elif self.packed is not None:
+            dinuc_frames[0:3, :] = self.packed.dinuc()
+            dinuc_tot[0:3] = np.sum(dinuc_frames[0:3, :], axis=1)
+            dinuc_tot[3] = np.sum(dinuc_tot[0:3])
+        elif self.din is not None:
+            dinuc_frames[0:3, :] = self.din
+            dinuc_tot[0:3] = np.sum(dinuc_frames[0:3, :], axis=1)
+            dinuc_tot[3] = np.sum(dinuc_tot[0:3])
+        else:
+            raise ValueError("No sequence or dinucleotide counts to use")
 
         dinuc_frames[3, :] = np.sum(dinuc_frames, axis=0)
             
@@ -444,3 +550,144 @@ cdef class CodonSeq:
             index=['1:2', '2:3', '3:1', 'all'])
         
         return v
+
+
+def _codonseq_from_state(code, ncod, naa, codon_tot, valid_stops, din):
+    """Rebuilds a `CodonSeq` pickled by `CodonSeq.__reduce_ex__`
+    """
+    if isinstance(code, bytes):
+        code = pd.Series(np.array(ref_aa1, dtype=object)[np.frombuffer(code, dtype=np.uint8)],
+                         index=ref_codons)
+    return CodonSeq.from_counts(np.frombuffer(ncod, dtype=c_long),
+                                np.frombuffer(naa, dtype=c_long),
+                                codon_tot, valid_stops, code, din)
+
+
+cdef class CodonStream:
+    """Counts codon, amino acid and dinucleotide usage of a sequence fed in
+    chunks, e.g. a chromosome read from disk piece by piece
+
+        stream = codonw.CodonStream()
+        for chunk in chunks:
+            stream.feed(chunk)
+        cseq = stream.finish()
+
+    Codons split across chunks and the dinucleotide frame are carried over,
+    lengths are 64-bit, and memory use does not depend on sequence length.
+    """
+    cdef codonwlib.CODON_STREAM_STRUCT state
+    cdef codonwlib.GENETIC_CODE_STRUCT ref_code
+    cdef object code_arg
+    cdef bint finished
+    cdef readonly object packed
+
+    def __init__(self, genetic_code=0, bool dinuc=True, bool hash=False,
+                 bool pack=False):
+        """`genetic_code`: as for `CodonSeq`
+        `dinuc`: also count dinucleotides (needed for `CodonSeq.dinuc`)
+        `hash`: also hash the sequence, see `CodonStream.digest`
+        `pack`: also pack the sequence into `CodonStream.packed`, a
+            `PackedSeq` that the finished `CodonSeq` keeps
+        """
+        self.ref_code = _resolve_code(genetic_code)
+        self.code_arg = genetic_code
+        self.finished = False
+        codonwlib.codon_stream_init(&self.state, &self.ref_code, dinuc)
+        self.state.hash = hash
+        self.packed = None
+        if pack:
+            self.packed = PackedSeq()
+            self.state.pack = (<PackedSeq>self.packed)._struct()
+
+    @property
+    def seqlen(self):
+        """Number of bases fed so far"""
+        return self.state.seqlen
+
+    @property
+    def digest(self):
+        """128 bit hash (MurmurHash3 x64 128) of the bases fed, as two
+        `uint64`, once finished with `hash=True`. Identical sequences have
+        identical digests however they were split into chunks.
+        """
+        if not (self.state.hash and self.finished):
+            raise ValueError("Only available once a hashed stream is finished")
+        return np.array([self.state.digest[0], self.state.digest[1]], dtype=np.uint64)
+
+    def feed(self, chunk):
+        """Counts the next chunk (`str` or `bytes`) of the sequence
+        """
+        cdef const char *buf
+        cdef long long n
+
+        if self.finished:
+            raise ValueError("CodonStream has already been finished")
+        if isinstance(chunk, str):
+            chunk = chunk.encode()
+
+        buf = chunk
+        n = len(chunk)
+        cdef int ret
+        with nogil:
+            ret = codonwlib.codon_stream_feed(&self.state, buf, n)
+        if ret:
+            raise MemoryError()
+        return
+
+    def finish(self):
+        """Ends the sequence and returns a `CodonSeq` holding its counts
+        """
+        if not self.finished:
+            codonwlib.codon_stream_finish(&self.state)
+            self.finished = True
+
+        cseq = CodonSeq.from_counts(self.state.ncod, self.state.naa,
+            self.state.codon_tot, self.state.valid_stops, self.code_arg,
+            self.state.din if self.state.dinuc else None)
+        cseq.packed = self.packed
+        return cseq
+
+
+def cpu_features():
+    """Reports which instruction set variant of the counting kernels is in use
+
+    Returns a dict with `active`: the variant in use, `available`: the
+    variants this CPU supports and `built`: all variants compiled in (both
+    best first). The best available variant is used unless the
+    `CODONW_ISA` environment variable names another one.
+    """
+    built = []
+    cdef int i = 0
+    while codonwlib.simd_variant(i) != NULL:
+        built.append(codonwlib.simd_variant(i).decode())
+        i += 1
+    return dict(active=codonwlib.simd_isa().decode(),
+                available=[v for v in built if codonwlib.simd_supported(v.encode())],
+                built=built)
+
+
+def select_isa(name):
+    """Switches the counting kernels to the named variant of
+    `cpu_features()['available']`, e.g. to compare them. Not to be called
+    while counting on other threads.
+    """
+    if codonwlib.simd_select(name.encode()):
+        raise ValueError("{} is not available on this CPU".format(name))
+    return
+
+
+include "counts.pxi"
+include "fasta.pxi"
+include "batch.pxi"
+include "ranges.pxi"
+include "genome.pxi"
+include "summary.pxi"
+include "score.pxi"
+include "dist.pxi"
+include "neighbors.pxi"
+include "ordination.pxi"
+include "expression.pxi"
+include "protein.pxi"
+include "kmer.pxi"
+include "packed.pxi"
+include "profile.pxi"
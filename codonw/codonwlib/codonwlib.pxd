@@ -5,8 +5,13 @@ Exports to be used in the Python interface
 """
 
 from libcpp cimport bool
+from libc.stdint cimport uint64_t
 
 cdef extern from "include/codonW.h":
+    enum: NUM_GENETIC_CODES
+    enum: NUM_FOP_SPECIES
+    enum: NUM_CAI_SPECIES
+
     ctypedef struct GENETIC_CODE_STRUCT:
         char *des
         char *typ
@@ -31,15 +36,149 @@ cdef extern from "include/codonW.h":
         float *hydro[22]
         int *aromo[22]
 
+    ctypedef struct PROTEIN_PROP_STRUCT:
+        double pk_nterm
+        double pk_cterm
+
+    ctypedef struct PROTEIN_PLAN_STRUCT:
+        PROTEIN_PROP_STRUCT *ppp
+        AMINO_PROP_STRUCT *pap
+        double ph
+        int nscale
+        const double *scale
+
+    ctypedef struct PACKED_SEQ_STRUCT:
+        long long len
+        long long nwords
+        long nexc
+        long long nexc_chars
+        long nlow
+        long nrna
+
+    ctypedef struct CODON_STREAM_STRUCT:
+        GENETIC_CODE_STRUCT *pcu
+        char dinuc
+        char hash
+        long long seqlen
+        long codon_tot
+        int valid_stops
+        long ncod[65]
+        long naa[22]
+        long din[3][16]
+        int fram
+        uint64_t digest[2]
+        PACKED_SEQ_STRUCT *pack
+
+    ctypedef struct CODE_PLAN_STRUCT:
+        GENETIC_CODE_STRUCT *pcu
+        int ds[65]
+        int da[23]
+
+    enum:
+        INDEX_CAI, INDEX_FOP, INDEX_CBI, INDEX_ENC, INDEX_GRAVY, INDEX_AROMO,
+        INDEX_GC, INDEX_GC3S, INDEX_L_SYM, INDEX_L_AA,
+        INDEX_T3S, INDEX_C3S, INDEX_A3S, INDEX_G3S,
+        NUM_INDICES
+
+    enum:
+        PROT_MW, PROT_PI, PROT_CHARGE, PROT_ALIPHATIC, PROT_EXTINCT,
+        PROT_GRAVY, PROT_AROMO,
+        NUM_PROT
+
+    ctypedef struct CODON_INDEX_STRUCT:
+        long long len
+        int step
+
+    ctypedef struct GENOME_RECORD:
+        char *name
+        long long length
+
+    ctypedef struct GENOME_STRUCT:
+        long n
+        GENOME_RECORD *rec
+        char twobit
+
+    ctypedef enum COUNT_TYPE:
+        COUNT_LONG, COUNT_U32, COUNT_U16
+
+    ctypedef struct INDEX_PLAN_STRUCT:
+        CODE_PLAN_STRUCT *plan
+
+    ctypedef enum DIST_METRIC:
+        DIST_EUCLIDEAN, DIST_MANHATTAN, DIST_CHI2, DIST_KARLIN
+
+    enum:
+        KMER_MAX_K
+
+    ctypedef struct KMER_COO_STRUCT:
+        long n
+        long *row
+        uint64_t *kmer
+        long (*count)[3]
+
+    ctypedef struct DIST_PAIRS_STRUCT:
+        long n
+        long *i
+        long *j
+        double *d
+
+    ctypedef enum COA_METHOD:
+        COA_CA, COA_PCA_RSCU, COA_PCA_FREQ
+
+    ctypedef struct VPTREE_STRUCT:
+        DIST_METRIC metric
+        int rscu
+        long n
+        const char *extra
+        size_t nextra
+        void *map
+
+    ctypedef struct SCORE_PLAN_STRUCT:
+        long nref
+
+    ctypedef enum PROFILE_MODE:
+        PROFILE_START, PROFILE_END, PROFILE_RELATIVE
+
+    ctypedef struct EXPR_PLAN_STRUCT:
+        long ngroups
+
+    ctypedef struct SUMMARY_STRUCT:
+        long ngroups
+        int nwhich
+        int nbins
+        const double *lo
+        const double *hi
+        long *count
+        long *nan
+        double *mean
+        double *m2
+        double *min
+        double *max
+        long *hist
+
+    ctypedef struct COUNT_TABLE_STRUCT:
+        long n
+        char **title
+        void *ncod
+        void *naa
+        COUNT_TYPE type
+        char widen
+        long *codon_tot
+        int *valid_stops
+        char hash
+        uint64_t (*digest)[2]
+
     GENETIC_CODE_STRUCT *cu_ref
     FOP_STRUCT *fop_ref
     CAI_STRUCT *cai_ref
     AMINO_STRUCT amino_acids
     AMINO_PROP_STRUCT amino_prop
+    PROTEIN_PROP_STRUCT protein_prop
 
     int ident_codon(char *codon)
     int how_synon(int dds[], GENETIC_CODE_STRUCT *pcu)
     int how_synon_aa(int dda[], GENETIC_CODE_STRUCT *pcu)
+    int code_plan_init(CODE_PLAN_STRUCT *pp, GENETIC_CODE_STRUCT *pcu)
 
     int codon_usage_tot(char *seq, long *codon_tot, int *valid_stops, long ncod[], long naa[], GENETIC_CODE_STRUCT *pcu)
     int rscu_usage(long *nncod, long *nnaa, float rscu[], int *ds, GENETIC_CODE_STRUCT *pcu)
@@ -51,5 +190,78 @@ cdef extern from "include/codonW.h":
     int enc(long *nncod, long *nnaa, float *enc_tot, int *da, GENETIC_CODE_STRUCT *pcu)
     int gc(int *ds, long *ncod, long bases[5], long base_tot[5], long base_1[5], long base_2[5], long base_3[5], long *tot_s, long *totalaa, double gc_metrics[], GENETIC_CODE_STRUCT *pcu)
     int dinuc_count(char *seq, long din[3][16], long dinuc_tot[4], int *fram)
+    int dinuc_feed(const char *seq, long long len, long din[3][16], int *fram, int *last)
     int hydro(long *nnaa, float *hydro, float hydro_ref[22])
     int aromo(long *nnaa, float *aromo, int aromo_ref[22])
+
+    int codon_stream_init(CODON_STREAM_STRUCT *ps, GENETIC_CODE_STRUCT *pcu, char dinuc)
+    int codon_stream_feed(CODON_STREAM_STRUCT *ps, const char *chunk, long long len) nogil
+    int codon_stream_finish(CODON_STREAM_STRUCT *ps)
+
+    int count_table_init(COUNT_TABLE_STRUCT *pt)
+    int count_table_free(COUNT_TABLE_STRUCT *pt)
+    int fasta_count(const char *filename, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt) nogil
+    int fasta_count_range(const char *filename, long long start, long long end, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt) nogil
+
+    int genome_open(GENOME_STRUCT *pg, const char *filename) nogil
+    void genome_close(GENOME_STRUCT *pg)
+    int genome_fetch(GENOME_STRUCT *pg, long rec, long long start, long long end, char strand, char *out) nogil
+    int genome_count_cds(GENOME_STRUCT *pg, long n, const long *rec, const char *strand, const long *seg_ptr, const long long *seg_start, const long long *seg_end, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads) nogil
+
+    int codon_index_build(CODON_INDEX_STRUCT *px, const char *seq, long long len, int step) nogil
+    int codon_index_ranges(CODON_INDEX_STRUCT *px, long n, const long long *starts, const long long *ends, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads) nogil
+    void codon_index_free(CODON_INDEX_STRUCT *px)
+
+    const char *simd_variant(int i)
+    int simd_supported(const char *name)
+    const char *simd_isa()
+    int simd_select(const char *name)
+    void base_codes(const char *seq, long n, unsigned char *codes)
+    void codon_codes(const char *seq, long n, unsigned char *codes)
+
+    int index_plan_init(INDEX_PLAN_STRUCT *pi, CODE_PLAN_STRUCT *plan, CAI_STRUCT *pcai, FOP_STRUCT *pfop, FOP_STRUCT *pcbi, AMINO_PROP_STRUCT *pap, bool factor_in_rare)
+    int count_seqs(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, void *ncod, void *naa, COUNT_TYPE type, long *codon_tot, int *valid_stops, uint64_t (*digest)[2], char *prot, const long long *prot_off, int threads) nogil
+    int batch_indices(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, double *out, long out_stride, INDEX_PLAN_STRUCT *pi, int threads) nogil
+    int batch_summary(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, const long *group, INDEX_PLAN_STRUCT *pi, SUMMARY_STRUCT *ps, int threads) nogil
+    void summary_reset(SUMMARY_STRUCT *ps)
+
+    int dist_features(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, DIST_METRIC metric, bool rscu, double *feat, double *wt) nogil
+    int dist_matrix(DIST_METRIC metric, long na, const double *fa, const double *wa, long nb, const double *fb, const double *wb, double *out, long out_stride, int threads) nogil
+    int dist_condensed(DIST_METRIC metric, long n, const double *f, const double *w, double *out, int threads) nogil
+    int dist_within(DIST_METRIC metric, long n, const double *f, const double *w, double threshold, DIST_PAIRS_STRUCT *pp, int threads) nogil
+    void dist_pairs_free(DIST_PAIRS_STRUCT *pp)
+
+    int coa_accumulate(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, double *weight, double *mean, double *gram, int threads) nogil
+    int coa_project(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, const double *center, const double *axes, int k, double *out, int threads) nogil
+
+    int vptree_build(VPTREE_STRUCT *pt, DIST_METRIC metric, long n, const double *feat, int threads) nogil
+    int vptree_query(const VPTREE_STRUCT *pt, long nq, const double *q, int k, double eps, long budget, long *nbr, double *dist, int threads) nogil
+    int vptree_save(const VPTREE_STRUCT *pt, const char *filename) nogil
+    int vptree_load(VPTREE_STRUCT *pt, const char *filename) nogil
+    void vptree_free(VPTREE_STRUCT *pt)
+
+    void packed_init(PACKED_SEQ_STRUCT *pp)
+    void packed_free(PACKED_SEQ_STRUCT *pp)
+    int packed_feed(PACKED_SEQ_STRUCT *pp, const char *chunk, long long len) nogil
+    void packed_unpack(const PACKED_SEQ_STRUCT *pp, long long start, long long end, char *out) nogil
+    int packed_tally(const PACKED_SEQ_STRUCT *pp, long long start, long long end, long ncod[65], long naa[22], GENETIC_CODE_STRUCT *pcu) nogil
+    void packed_dinuc(const PACKED_SEQ_STRUCT *pp, long din[3][16]) nogil
+    void packed_windows(const PACKED_SEQ_STRUCT *pp, long long width, long long step, long nwin, long long *gc, long long *valid) nogil
+
+    int kmer_seqs(long n, const char **seqs, const long long *lens, int k, int by_count, long *dense, int threads) nogil
+    int kmer_seqs_sparse(long n, const char **seqs, const long long *lens, int k, int by_count, KMER_COO_STRUCT *pc, int threads) nogil
+    void kmer_coo_free(KMER_COO_STRUCT *pc)
+
+    int protein_props(long n, const void *naa, COUNT_TYPE type, PROTEIN_PLAN_STRUCT *pp, const int *which, int nwhich, double *out, long out_stride, int threads) nogil
+
+    int codon_profile(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, PROFILE_MODE mode, long nbins, long width, long (*ncod)[65], long (*naa)[22], long *genes, int threads) nogil
+    int expr_totals(long n, const void *ncod, COUNT_TYPE type, const long *group, const unsigned char *he, long ngroups, long (*tot)[65], long (*tot_he)[65], int threads) nogil
+    int expr_plan_init(EXPR_PLAN_STRUCT *pe, CODE_PLAN_STRUCT *plan, long ngroups, long (*tot)[65], long (*tot_he)[65], double pseudo)
+    void expr_plan_free(EXPR_PLAN_STRUCT *pe)
+    int expr_scores(long n, const void *ncod, COUNT_TYPE type, const long *group, EXPR_PLAN_STRUCT *pe, const int *which, int nwhich, double *out, long out_stride, int threads) nogil
+
+    int score_plan_cai(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const double *w)
+    int score_plan_fop(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const char *fop_cod, bool factor_in_rare)
+    void score_plan_free(SCORE_PLAN_STRUCT *ps)
+    int score_matrix(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, double *out, long out_stride, int threads) nogil
+    int score_topk(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, int k, long *top, double *score, int threads) nogil
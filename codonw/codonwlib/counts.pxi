@@ -0,0 +1,262 @@
+"""
+
+Codon and amino acid counts of many sequences held as matrices, i.e. one
+row per sequence. Included into `codonw.pyx`.
+
+"""
+
+class CodonCounts:
+    """Codon and amino acid usage of many sequences
+
+    `ids`: sequence identifiers
+    `ncod`: N x 65 codon counts, columns ordered as `ref_codons`
+    `naa`: N x 22 amino acid counts, columns ordered as `ref_aa1`
+    `codon_tot`: number of codons in each sequence
+    `valid_stops`: 1 where a sequence ends with a stop codon
+    `genetic_code`: the genetic code used to count, as for `CodonSeq`
+    `titles`: full title of each sequence (defaults to `ids`)
+    `groups`: optional label of each sequence, e.g. the file or genome it
+        came from
+    `digests`: optional N x 2 `uint64` hash of each sequence (see
+        `CodonStream.digest`), used to find identical sequences
+
+    `ncod` and `naa` may be held as `uint16` or `uint32` rather than `long`
+    to save memory on large data sets, see `CodonCounts.astype`.
+    """
+
+    def __init__(self, ids, ncod, naa, codon_tot=None, valid_stops=None,
+                 genetic_code=0, titles=None, groups=None, digests=None):
+        self.ids = np.asarray(ids, dtype=object)
+        self.ncod = np.asarray(ncod)
+        self.naa = np.asarray(naa)
+
+        n = len(self.ids)
+        if self.ncod.shape != (n, 65) or self.naa.shape != (n, 22):
+            raise ValueError("ncod and naa must be N x 65 and N x 22")
+
+        if codon_tot is None:
+            codon_tot = self.ncod.sum(axis=1)
+        if valid_stops is None:
+            valid_stops = np.zeros(n, dtype=c_int)
+        self.codon_tot = np.asarray(codon_tot)
+        self.valid_stops = np.asarray(valid_stops)
+        self.genetic_code = genetic_code
+        self.titles = self.ids if titles is None else np.asarray(titles, dtype=object)
+        self.groups = None if groups is None else np.asarray(groups, dtype=object)
+        self.digests = None if digests is None else np.asarray(digests, dtype=np.uint64)
+        if self.digests is not None and self.digests.shape != (n, 2):
+            raise ValueError("digests must be N x 2")
+        return
+
+    def __len__(self):
+        return len(self.ids)
+
+    def __getitem__(self, i):
+        """Returns a `CodonSeq` for the `i`-th sequence"""
+        return CodonSeq.from_counts(self.ncod[i], self.naa[i],
+            self.codon_tot[i], self.valid_stops[i], self.genetic_code)
+
+    def __repr__(self):
+        return "<CodonCounts of {} sequences>".format(len(self))
+
+    def astype(self, dtype):
+        """Returns a copy with `ncod` and `naa` held as `dtype`, one of
+        `count_dtypes`, or "auto" for the narrowest one that holds every
+        count. Raises `OverflowError` if a count does not fit.
+        """
+        top = max(self.ncod.max(initial=0), self.naa.max(initial=0))
+        dtype = _count_dtype(dtype, top)
+        return CodonCounts(self.ids, self.ncod.astype(dtype), self.naa.astype(dtype),
+                           self.codon_tot, self.valid_stops, self.genetic_code,
+                           self.titles, self.groups, self.digests)
+
+    def take(self, rows):
+        """Returns a `CodonCounts` of the given rows"""
+        pick = lambda a: None if a is None else a[rows]
+        return CodonCounts(self.ids[rows], self.ncod[rows], self.naa[rows],
+                           self.codon_tot[rows], self.valid_stops[rows],
+                           self.genetic_code, self.titles[rows],
+                           pick(self.groups), pick(self.digests))
+
+    def unique(self):
+        """Finds identical sequences by their digests (see `count_sequences`
+        with `hash=True`), returning the `CodonCounts` of the first of each
+        and, for every row, the row of its copy in those
+        """
+        if self.digests is None:
+            raise ValueError("Counts were made without hash=True")
+        key = np.ascontiguousarray(self.digests).view('V16').ravel()
+        _, first, inverse = np.unique(key, return_index=True, return_inverse=True)
+
+        # keep the order in which sequences were first seen
+        order = np.argsort(first)
+        rank = np.empty_like(order)
+        rank[order] = np.arange(len(order))
+        return self.take(first[order]), rank[inverse.ravel()]
+
+    def dedup_ratio(self):
+        """Fraction of sequences identical to an earlier one"""
+        if not len(self):
+            return 0.0
+        return 1 - len(self.unique()[0]) / len(self)
+
+    def codon_usage(self):
+        """Codon tabulation of each sequence as a `pd.DataFrame`
+        """
+        return pd.DataFrame(self.ncod[:, 1:65], index=self.ids,
+                            columns=ref_codons[1:65])
+
+    def aa_usage(self):
+        """Amino acid tabulation of each sequence as a `pd.DataFrame`
+        """
+        return pd.DataFrame(self.naa, index=self.ids, columns=ref_aa1)
+
+    def indices(self, indices=None, **kwargs):
+        """Indices of each sequence as a `pd.DataFrame`, see `compute_indices`
+        """
+        return compute_indices(self, indices, **kwargs)
+
+    def protein_properties(self, properties=None, **kwargs):
+        """Properties of each translated product as a `pd.DataFrame`, see
+        `protein_properties`
+        """
+        return protein_properties(self, properties, **kwargs)
+
+    def summarize(self, indices=None, **kwargs):
+        """Distributions of indices by group as an `IndexSummary`, see
+        `summarize_indices`
+        """
+        return summarize_indices(self, indices, **kwargs)
+
+    def save(self, filename):
+        """Saves the counts to a `.npz` file, e.g. as the partial result
+        of one shard to be combined with `merge_counts`
+        """
+        code = self.genetic_code
+        if isinstance(code, int):
+            code_args = dict(genetic_code=np.array(code))
+        else:
+            code_args = dict(code_codons=np.array(code.index, dtype=str),
+                             code_aa=np.array(code.values, dtype=str))
+        if self.groups is not None:
+            code_args['groups'] = np.array(self.groups, dtype=str)
+        if self.digests is not None:
+            code_args['digests'] = self.digests
+
+        np.savez(filename, ids=np.array(self.ids, dtype=str),
+                 titles=np.array(self.titles, dtype=str),
+                 ncod=self.ncod, naa=self.naa, codon_tot=self.codon_tot,
+                 valid_stops=self.valid_stops, **code_args)
+        return
+
+    @staticmethod
+    def load(filename):
+        """Loads counts saved with `CodonCounts.save`
+        """
+        with np.load(filename) as f:
+            if 'genetic_code' in f:
+                code = int(f['genetic_code'])
+            else:
+                code = pd.Series(f['code_aa'], index=f['code_codons'])
+            groups = f['groups'].astype(object) if 'groups' in f else None
+            digests = f['digests'] if 'digests' in f else None
+            return CodonCounts(f['ids'].astype(object), f['ncod'], f['naa'],
+                               f['codon_tot'], f['valid_stops'], code,
+                               f['titles'].astype(object), groups, digests)
+
+
+count_dtypes = [np.dtype(np.uint16), np.dtype(np.uint32), np.dtype(c_long)]
+
+
+def _count_dtype(dtype, max_count):
+    """Resolves the element type of count matrices. None means `long`,
+    "auto" the narrowest of `count_dtypes` that holds `max_count`.
+    """
+    if dtype is None:
+        return np.dtype(c_long)
+    if isinstance(dtype, str) and dtype == "auto":
+        for dt in count_dtypes:
+            if max_count <= np.iinfo(dt).max:
+                return dt
+    dtype = np.dtype(dtype)
+    if dtype not in count_dtypes:
+        raise ValueError("Counts must be one of {}".format(
+            ", ".join(map(str, count_dtypes))))
+    if max_count > np.iinfo(dtype).max:
+        raise OverflowError("Counts of up to {} do not fit {}".format(max_count, dtype))
+    return dtype
+
+
+cdef codonwlib.COUNT_TYPE _count_type(dtype) except *:
+    """The C element type of a count matrix of `count_dtypes`
+    """
+    if dtype == np.uint16:
+        return codonwlib.COUNT_U16
+    elif dtype == np.uint32:
+        return codonwlib.COUNT_U32
+    elif dtype == np.dtype(c_long):
+        return codonwlib.COUNT_LONG
+    raise ValueError("Unsupported count dtype {}".format(dtype))
+
+
+def _same_code(a, b):
+    """Whether two genetic codes (as for `CodonSeq`) are the same"""
+    if isinstance(b, int):
+        return isinstance(a, int) and a == b
+    return isinstance(a, pd.Series) and a.equals(b)
+
+
+def merge_counts(parts):
+    """Concatenates `CodonCounts` (or files saved with `CodonCounts.save`)
+    in the order given, e.g. the shards of a file from `count_fasta`
+    """
+    parts = [CodonCounts.load(p) if not isinstance(p, CodonCounts) else p
+             for p in parts]
+    if not parts:
+        raise ValueError("Nothing to merge")
+
+    code = parts[0].genetic_code
+    for p in parts[1:]:
+        if not _same_code(p.genetic_code, code):
+            raise ValueError("Counts were made with different genetic codes")
+
+    groups = None
+    if all(p.groups is not None for p in parts):
+        groups = np.concatenate([p.groups for p in parts])
+    digests = None
+    if all(p.digests is not None for p in parts):
+        digests = np.concatenate([p.digests for p in parts])
+
+    return CodonCounts(np.concatenate([p.ids for p in parts]),
+                       np.concatenate([p.ncod for p in parts]),
+                       np.concatenate([p.naa for p in parts]),
+                       np.concatenate([p.codon_tot for p in parts]),
+                       np.concatenate([p.valid_stops for p in parts]),
+                       code,
+                       np.concatenate([p.titles for p in parts]),
+                       groups, digests)
+
+
+cdef object _counts_from_table(codonwlib.COUNT_TABLE_STRUCT *pt, genetic_code):
+    """Copies a C count table into a `CodonCounts`
+    """
+    cdef long n = pt.n
+    titles = [pt.title[i].decode('UTF-8', 'replace') for i in range(n)]
+    ids = [t.split(' ')[0] if t else t for t in titles]
+
+    dtype = [dt for dt in count_dtypes if _count_type(dt) == pt.type][0]
+    ncod = np.zeros([n, 65], dtype=dtype)
+    naa = np.zeros([n, 22], dtype=dtype)
+    codon_tot = np.zeros([n], dtype=c_long)
+    valid_stops = np.zeros([n], dtype=c_int)
+    digests = np.zeros([n, 2], dtype=np.uint64) if pt.hash else None
+    if n:
+        ncod.view(np.uint8)[:] = <unsigned char[:n, :65 * dtype.itemsize]><unsigned char *>pt.ncod
+        naa.view(np.uint8)[:] = <unsigned char[:n, :22 * dtype.itemsize]><unsigned char *>pt.naa
+        codon_tot[:] = <long[:n]>pt.codon_tot
+        valid_stops[:] = <int[:n]>pt.valid_stops
+        if pt.hash:
+            digests[:] = <uint64_t[:n, :2]>&pt.digest[0][0]
+
+    return CodonCounts(ids, ncod, naa, codon_tot, valid_stops,
+                       genetic_code, titles, digests=digests)
@@ -0,0 +1,148 @@
+"""
+
+Distances between the codon usage of many sequences. Included into
+`codonw.pyx`.
+
+"""
+
+distance_metrics = ['euclidean', 'manhattan', 'chi2', 'karlin']
+
+
+cdef codonwlib.DIST_METRIC _dist_metric(metric) except *:
+    if metric == 'euclidean':
+        return codonwlib.DIST_EUCLIDEAN
+    elif metric == 'manhattan':
+        return codonwlib.DIST_MANHATTAN
+    elif metric == 'chi2':
+        return codonwlib.DIST_CHI2
+    elif metric == 'karlin':
+        return codonwlib.DIST_KARLIN
+    raise ValueError("metric must be one of {}".format(", ".join(distance_metrics)))
+
+
+def _dist_features(counts, metric, on):
+    """The features each distance is calculated from (see `dist_features`)
+    and for Karlin's B the weights
+    """
+    cdef codonwlib.DIST_METRIC cmetric = _dist_metric(metric)
+    if on not in ("rscu", "freq"):
+        raise ValueError("on must be 'rscu' or 'freq'")
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(counts.genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT plan
+    codonwlib.code_plan_init(&plan, &code)
+
+    ncod = counts.ncod
+    if ncod.dtype not in count_dtypes:
+        ncod = ncod.astype(c_long)
+    ncod = np.ascontiguousarray(ncod)
+    cdef long n = len(ncod)
+    feat = np.zeros([n, 64], dtype=c_double)
+    wt = np.zeros([n, 64], dtype=c_double) if metric == 'karlin' else None
+    if n:
+        codonwlib.dist_features(n, np.PyArray_DATA(ncod), _count_type(ncod.dtype), &plan,
+                                cmetric, on == "rscu", <double *>np.PyArray_DATA(feat),
+                                NULL if wt is None else <double *>np.PyArray_DATA(wt))
+    return feat, wt
+
+
+cdef double *_data(a):
+    return NULL if a is None else <double *>np.PyArray_DATA(a)
+
+
+def codon_distances(counts, metric="euclidean", on="rscu", threshold=None,
+                    int threads=1):
+    """Distances between the codon usage of every pair of sequences of a
+    `CodonCounts`
+
+    `metric`: one of `distance_metrics`
+        "euclidean", "manhattan": on the RSCU (as `CodonSeq.rscu`) or the
+            codon frequencies of each sequence, see `on`
+        "chi2": sum over codons of (f - g)^2 / (f + g) of codon frequencies
+        "karlin": Karlin's codon usage difference B (Karlin et al. 1998),
+            averaged over both directions: the differences of codon
+            frequencies within each amino acid, weighted by the mean
+            frequency of the amino acid in both sequences. It stands in for
+            Karlin's genomic signature difference delta*, which needs
+            dinucleotide counts across codon boundaries that codon counts
+            do not hold (see `kmer_counts` for those)
+    `on`: "rscu" or "freq", the features of "euclidean" and "manhattan"
+    `threshold`: only return pairs no further apart than this
+    `threads`: number of threads to calculate on
+
+    Returns the condensed distance matrix (as `scipy.spatial.distance.pdist`,
+    see `squareform`), or if `threshold` is given a `pd.DataFrame` of the
+    close pairs (`i`, `j` rows with i < j, and `distance`) ordered by rows.
+    """
+    cdef codonwlib.DIST_METRIC cmetric = _dist_metric(metric)
+    feat, wt = _dist_features(counts, metric, on)
+    cdef long n = len(feat)
+    cdef double *pf = _data(feat)
+    cdef double *pw = _data(wt)
+    cdef double cthresh
+    cdef double *pout
+    cdef codonwlib.DIST_PAIRS_STRUCT pairs
+    cdef int ret = 0
+
+    if threshold is None:
+        out = np.zeros([n * (n - 1) // 2], dtype=c_double)
+        pout = _data(out)
+        if len(out):
+            with nogil:
+                ret = codonwlib.dist_condensed(cmetric, n, pf, pw, pout, max(threads, 1))
+        if ret < 0:
+            raise MemoryError()
+        return out
+
+    cthresh = threshold
+    with nogil:
+        ret = codonwlib.dist_within(cmetric, n, pf, pw, cthresh, &pairs, max(threads, 1))
+    if ret < 0:
+        raise MemoryError()
+    try:
+        i = np.array(<long[:pairs.n]>pairs.i) if pairs.n else np.zeros(0, dtype=c_long)
+        j = np.array(<long[:pairs.n]>pairs.j) if pairs.n else np.zeros(0, dtype=c_long)
+        d = np.array(<double[:pairs.n]>pairs.d) if pairs.n else np.zeros(0, dtype=c_double)
+    finally:
+        codonwlib.dist_pairs_free(&pairs)
+    order = np.lexsort((j, i))
+    return pd.DataFrame({'i': i[order], 'j': j[order], 'distance': d[order]})
+
+
+def distance_blocks(counts, other=None, metric="euclidean", on="rscu",
+                    long block=4096, int threads=1):
+    """Yields the distances of `counts` (rows) to `other` (columns, by
+    default `counts` again) one block of rows at a time, as
+    (`slice` of rows, `block` x len(`other`) array), so that matrices too
+    large to hold can be streamed. See `codon_distances` for the metrics.
+    """
+    cdef codonwlib.DIST_METRIC cmetric = _dist_metric(metric)
+    if block < 1:
+        raise ValueError("block must be at least 1")
+    feat, wt = _dist_features(counts, metric, on)
+    if other is None:
+        ofeat, owt = feat, wt
+    else:
+        if not _same_code(other.genetic_code, counts.genetic_code):
+            raise ValueError("Counts were made with different genetic codes")
+        ofeat, owt = _dist_features(other, metric, on)
+
+    cdef long n = len(feat), m = len(ofeat), lo, hi
+    cdef double *pf
+    cdef double *pw
+    cdef double *pof = _data(ofeat)
+    cdef double *pow = _data(owt)
+    cdef double *pout
+    cdef int ret = 0
+    for lo in range(0, n, block):
+        hi = min(lo + block, n)
+        out = np.zeros([hi - lo, m], dtype=c_double)
+        pf = _data(feat) + lo * 64
+        pw = NULL if wt is None else _data(wt) + lo * 64
+        pout = _data(out)
+        if m:
+            with nogil:
+                ret = codonwlib.dist_matrix(cmetric, hi - lo, pf, pw, m, pof, pow,
+                                            pout, m, max(threads, 1))
+        if ret < 0:
+            raise MemoryError()
+        yield slice(lo, hi), out
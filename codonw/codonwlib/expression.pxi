@@ -0,0 +1,124 @@
+"""
+
+Expression level predictors (MILC, MELP, Karlin's B and E) of many
+sequences against per genome references. Included into `codonw.pyx`.
+
+"""
+
+expression_names = ['MILC', 'MILC_HE', 'MELP', 'B', 'B_HE', 'E']
+
+
+def expression_indices(counts, he, indices=None, groups=None, baseline=None,
+                       double pseudocount=1.0, int threads=1):
+    """Scores every sequence of a `CodonCounts` against the codon usage of
+    its genome and of the highly expressed genes of that genome
+
+    `he`: the highly expressed genes (e.g. ribosomal proteins), as a
+        boolean mask or a list of ids
+    `indices`: names from `expression_names` (default all)
+        - MILC: MILC (Supek & Vlahovicek 2005) against the genome
+        - MILC_HE: MILC against the highly expressed genes
+        - MELP: MILC / MILC_HE
+        - B: Karlin's B (Karlin et al. 1998) against the genome
+        - B_HE: B against the highly expressed genes
+        - E: B / B_HE (Karlin & Mrazek 2000)
+    `groups`: genome of each sequence, by default `counts.groups` or one
+        genome "all"
+    `baseline`: codon counts of each genome, as a `CodonCounts` whose ids
+        are the genome keys (e.g. the per file counts of `scan_files`),
+        used instead of the sum of its sequences in `counts`
+    `pseudocount`: added to every codon count of the references, so that
+        codons a reference lacks do not make MILC infinite
+    `threads`: number of threads
+
+    The references are summed in one pass over the counts and the
+    sequences scored in a second. Synonymous families are the amino acids
+    of the genetic code with more than one codon, stop codons left out.
+    Sequences without sense codons, or of genomes without highly expressed
+    genes, are NaN.
+
+    Returns a `pd.DataFrame` with a column per index.
+    """
+    if indices is None:
+        indices = expression_names
+    indices = list(indices)
+    unknown = [i for i in indices if i not in expression_names]
+    if unknown:
+        raise ValueError("Unknown indices: {}".format(", ".join(map(str, unknown))))
+    if pseudocount < 0:
+        raise ValueError("pseudocount must not be negative")
+
+    cdef long n = len(counts)
+    if groups is None:
+        groups = counts.groups if counts.groups is not None else np.full(n, "all", dtype=object)
+    if len(groups) != n:
+        raise ValueError("groups must have one key per sequence")
+    codes, keys = pd.factorize(np.asarray(groups, dtype=object))
+    cdef long ngroups = max(len(keys), 1)
+
+    he = np.asarray(he)
+    if he.dtype == np.bool_:
+        if len(he) != n:
+            raise ValueError("he must have one value per sequence")
+    else:
+        he = np.isin(counts.ids, he)
+    mask = np.ascontiguousarray(he, dtype=np.uint8)
+
+    ncod = counts.ncod
+    if ncod.dtype not in count_dtypes:
+        ncod = ncod.astype(c_long)
+    ncod = np.ascontiguousarray(ncod)
+    group = np.ascontiguousarray(codes, dtype=c_long)
+    which = np.array([expression_names.index(i) for i in indices], dtype=c_int)
+    result = np.empty([n, len(indices)], dtype=c_double)
+
+    tot = np.zeros([ngroups, 65], dtype=c_long)
+    tot_he = np.zeros([ngroups, 65], dtype=c_long)
+    if baseline is not None:
+        rows = pd.Series(np.arange(len(baseline)), index=baseline.ids)
+        missing = [k for k in keys if k not in rows.index]
+        if missing:
+            raise ValueError("baseline lacks genomes {}".format(", ".join(map(str, missing[:5]))))
+        if not _same_code(baseline.genetic_code, counts.genetic_code):
+            raise ValueError("baseline was counted with a different genetic code")
+        tot[:len(keys)] = baseline.ncod[rows[keys].values]
+    if n and len(indices):
+        _expression_into(ncod, group, mask, ngroups, tot, tot_he, baseline is None,
+                         pseudocount, which, result, counts.genetic_code, threads)
+
+    return pd.DataFrame(result, index=counts.ids, columns=indices)
+
+
+cdef _expression_into(np.ndarray ncod, long[::1] group, unsigned char[::1] mask,
+                      long ngroups, np.ndarray tot, np.ndarray tot_he, bool sum_tot,
+                      double pseudocount, int[::1] which, double[:, ::1] result,
+                      genetic_code, int threads):
+    """Runs both passes of the expression predictors over all rows
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT plan
+    cdef codonwlib.EXPR_PLAN_STRUCT pe
+    cdef long n = ncod.shape[0]
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(ncod.dtype)
+    cdef void *pcod = np.PyArray_DATA(ncod)
+    cdef void *ptot = np.PyArray_DATA(tot) if sum_tot else NULL
+    cdef void *ptot_he = np.PyArray_DATA(tot_he)
+    cdef int ret
+
+    codonwlib.code_plan_init(&plan, &code)
+    with nogil:
+        ret = codonwlib.expr_totals(n, pcod, ctype, &group[0], &mask[0], ngroups,
+                                    <long (*)[65]>ptot, <long (*)[65]>ptot_he,
+                                    max(threads, 1))
+    if ret < 0:
+        raise MemoryError()
+
+    if codonwlib.expr_plan_init(&pe, &plan, ngroups, <long (*)[65]>np.PyArray_DATA(tot),
+                                <long (*)[65]>ptot_he, pseudocount):
+        raise MemoryError()
+    try:
+        with nogil:
+            codonwlib.expr_scores(n, pcod, ctype, &group[0], &pe, &which[0], which.shape[0],
+                                  &result[0, 0], result.shape[1], max(threads, 1))
+    finally:
+        codonwlib.expr_plan_free(&pe)
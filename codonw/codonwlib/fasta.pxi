@@ -0,0 +1,215 @@
+"""
+
+Native readers of sequence files. Included into `codonw.pyx`.
+
+"""
+
+import os
+
+
+def read_fai(filename):
+    """Reads a samtools style FASTA index (`.fai`) as a `pd.DataFrame`
+    """
+    return pd.read_csv(filename, sep='\t', header=None, usecols=range(5),
+                       names=['name', 'length', 'offset', 'linebases', 'linewidth'])
+
+
+def shard_ranges(filename, int n, fai=None):
+    """Splits an uncompressed FASTA file into `n` byte ranges to be given
+    to `count_fasta(byte_range=...)`, returning a list of (start, end)
+
+    `fai`: a `.fai` index of the file (`True` for `filename + ".fai"`). If
+        given, shards are split at record boundaries so that each holds a
+        similar number of bases. Otherwise the file is split into equal
+        numbers of bytes and each range starts at the next record.
+    """
+    size = os.path.getsize(filename)
+    if n < 1:
+        raise ValueError("n must be at least 1")
+    if fai is None:
+        return [(size * k // n, size * (k + 1) // n) for k in range(n)]
+
+    if fai is True:
+        fai = filename + ".fai"
+    idx = read_fai(fai)
+    length = idx['length'].values
+    if len(length) == 0:
+        return [(0, size)] + [(size, size)] * (n - 1)
+
+    # any byte after the last base of a record and up to the next '>'
+    # separates two records
+    seq_end = (idx['offset'].values + (length // idx['linebases'].values) *
+               idx['linewidth'].values + length % idx['linebases'].values)
+    record_start = np.concatenate([[0], seq_end[:-1]])
+
+    before = np.cumsum(length) - length
+    bounds = [0]
+    for k in range(1, n):
+        r = np.searchsorted(before, length.sum() * k / n)
+        bounds.append(record_start[r] if r < len(length) else size)
+    bounds.append(size)
+    return list(zip(bounds[:-1], bounds[1:]))
+
+
+def count_fasta(filename, genetic_code=0, int threads=1, shard=None,
+                byte_range=None, fai=None, dtype=None, bool hash=False):
+    """Reads a FASTA file and counts the codon and amino acid usage of
+    each record, returning a `CodonCounts`
+
+    `filename`: a plain or gzip compressed FASTA file
+    `genetic_code`: as for `CodonSeq`
+    `threads`: number of threads used to decompress BGZF files (as
+        written by `bgzip`), which consist of independently compressed
+        blocks. Other gzip files are decompressed on a single thread.
+    `shard`: (k, n) to only count the k-th of n shards of the file, see
+        `shard_ranges`. `fai` is passed on to `shard_ranges`.
+    `byte_range`: (start, end) to only count the records whose title line
+        starts within these bytes of the file
+    `dtype`: element type of the count matrices, see `CodonCounts.astype`.
+        Records are counted straight into it; "auto" starts from uint16
+        and widens the rows read so far when a count does not fit.
+    `hash`: also hash each record as it is read, see `count_sequences`
+
+    Sequences are counted as they are read and never held in memory.
+    Sharding needs an uncompressed file. Every record belongs to exactly
+    one shard, so the shards of a file can be counted by separate
+    processes or nodes and combined in order with `merge_counts`.
+    """
+    cdef long long start = 0, end = -1
+
+    if shard is not None:
+        k, n = shard
+        byte_range = shard_ranges(filename, n, fai)[k]
+    if byte_range is not None:
+        start, end = byte_range
+
+    return _FastaCounter(genetic_code).count(filename, threads, start, end, hash, dtype)
+
+
+cdef class _FastaCounter:
+    """Counts FASTA files with a genetic code resolved once, so that it can
+    be shared by the threads of `scan_files`
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code
+    cdef object genetic_code
+
+    def __init__(self, genetic_code):
+        self.code = _resolve_code(genetic_code)
+        self.genetic_code = genetic_code
+
+    def count(self, filename, int threads=1, long long start=0, long long end=-1,
+              bool hash=False, dtype=None):
+        cdef codonwlib.COUNT_TABLE_STRUCT table
+        cdef int ret
+
+        fn = os.fsencode(filename)
+        cdef const char *cfn = fn
+
+        # "auto" starts from the narrowest type and is widened as needed
+        widen = isinstance(dtype, str) and dtype == "auto"
+        dtype = _count_dtype(count_dtypes[0] if widen else dtype, 0)
+
+        codonwlib.count_table_init(&table)
+        table.type = _count_type(dtype)
+        table.widen = widen
+        table.hash = hash
+        try:
+            with nogil:
+                ret = codonwlib.fasta_count_range(cfn, start, end, max(threads, 1),
+                                                  &self.code, &table)
+
+            if ret == 1:
+                raise IOError("Could not read {}".format(filename))
+            elif ret == 2:
+                raise ValueError("{} is not a valid compressed file".format(filename))
+            elif ret == 3:
+                raise ValueError("Only uncompressed files can be read in shards")
+            elif ret == 4:
+                raise OverflowError("Counts of {} do not fit {}".format(filename, dtype))
+
+            return _counts_from_table(&table, self.genetic_code)
+        finally:
+            codonwlib.count_table_free(&table)
+
+
+def scan_files(paths, genetic_code=0, aggregate="per_file", genes=False,
+               threads=None, backend="threads", bool hash=False, summary=None):
+    """Counts many (plain or gzip compressed) FASTA files, e.g. one per
+    genome, returning `CodonCounts`
+
+    `paths`: the files to read
+    `genetic_code`: as for `CodonSeq`, used for every file
+    `aggregate`: "per_file" to sum the counts of all records of each file
+        into one row (with the file as its id), or None for no aggregation
+    `genes`: also return the counts of each record, with the file it came
+        from as its group
+    `threads`: number of files read at once, by default as many as
+        `concurrent.futures.ThreadPoolExecutor` would use
+    `backend`: "threads" reads files on a pool of threads, which overlaps
+        opening and reading files with counting. It is the only backend.
+    `hash`: also hash each record, see `count_sequences`
+    `summary`: index names (or True for all) whose distribution over the
+        records of each file is folded into an `IndexSummary`, grouped by
+        file, as each file is read (see `summarize_indices`)
+
+    Returns the per file counts, the per record counts if `aggregate` is
+    None, or both as a tuple if `genes` is also requested. Rows are in the
+    order of `paths`. If `summary` is given, the result is a tuple that
+    ends with the summary.
+    """
+    import concurrent.futures
+
+    if aggregate not in ("per_file", None):
+        raise ValueError("aggregate must be 'per_file' or None")
+    if backend != "threads":
+        raise ValueError("Unknown backend {}".format(backend))
+
+    paths = list(paths)
+    keep_genes = genes or aggregate is None
+    counter = _FastaCounter(genetic_code)
+    if summary is True:
+        summary = index_names
+
+    def scan(path):
+        counts = counter.count(path, hash=hash)
+        total = (counts.ncod.sum(axis=0), counts.naa.sum(axis=0),
+                 counts.codon_tot.sum(), counts.valid_stops.sum())
+        counts.groups = np.full(len(counts), str(path), dtype=object)
+        part = None
+        if summary is not None:
+            part = summarize_indices(counts, summary)
+            if not len(counts):
+                part = part.merge(IndexSummary([str(path)], part.indices,
+                                               part.lo, part.hi, part.bins))
+        return total, counts if keep_genes else None, part
+
+    with concurrent.futures.ThreadPoolExecutor(threads) as pool:
+        results = list(pool.map(scan, paths))
+
+    per_file = None
+    if aggregate == "per_file":
+        ids = [str(p) for p in paths]
+        per_file = CodonCounts(ids,
+            np.array([r[0][0] for r in results], dtype=c_long).reshape([-1, 65]),
+            np.array([r[0][1] for r in results], dtype=c_long).reshape([-1, 22]),
+            np.array([r[0][2] for r in results], dtype=c_long),
+            np.array([r[0][3] for r in results], dtype=c_int),
+            genetic_code)
+
+    per_gene = None
+    if keep_genes:
+        per_gene = (merge_counts([r[1] for r in results]) if results else
+                    CodonCounts([], np.zeros([0, 65], dtype=c_long),
+                                np.zeros([0, 22], dtype=c_long),
+                                genetic_code=genetic_code, groups=[],
+                                digests=np.zeros([0, 2], dtype=np.uint64) if hash else None))
+
+    result = (per_gene,) if per_file is None else (
+        (per_file, per_gene) if genes else (per_file,))
+    if summary is not None:
+        parts = [r[2] for r in results]
+        if not parts:
+            parts = [summarize_indices(CodonCounts([], np.zeros([0, 65], dtype=c_long),
+                                                   np.zeros([0, 22], dtype=c_long)), summary)]
+        result += (parts[0].merge(*parts[1:]),)
+    return result if len(result) > 1 else result[0]
@@ -0,0 +1,240 @@
+"""
+
+Coding sequences counted straight from a genome FASTA file and a GFF3 or
+BED12 annotation. Included into `codonw.pyx`.
+
+"""
+
+import gzip
+
+cds_columns = ['id', 'chrom', 'start', 'end', 'strand', 'phase']
+
+
+def _open_text(filename):
+    with open(filename, 'rb') as fh:
+        magic = fh.read(2)
+    if magic == b'\x1f\x8b':
+        return gzip.open(filename, 'rt')
+    return open(filename)
+
+
+def read_gff3(filename):
+    """Reads the CDS features of a GFF3 file as a `pd.DataFrame` of
+    segments (columns `cds_columns`, 0 based and end exclusive), one coding
+    sequence per `Parent` (or `ID` if there is no parent)
+    """
+    rows = []
+    with _open_text(filename) as fh:
+        for line in fh:
+            if line.startswith('##FASTA'):
+                break
+            if line.startswith('#') or not line.strip():
+                continue
+            f = line.rstrip('\n\r').split('\t')
+            if len(f) < 9 or f[2] != 'CDS':
+                continue
+            attrs = dict(a.split('=', 1) for a in f[8].split(';') if '=' in a)
+            parents = attrs.get('Parent', attrs.get('ID', ''))
+            phase = int(f[7]) if f[7] in ('0', '1', '2') else 0
+            for parent in parents.split(','):
+                rows.append((parent, f[0], int(f[3]) - 1, int(f[4]), f[6], phase))
+    return pd.DataFrame(rows, columns=cds_columns)
+
+
+def read_bed12(filename):
+    """Reads the coding part (thickStart..thickEnd) of the blocks of each
+    line of a BED12 file as a `pd.DataFrame` of segments (see `read_gff3`).
+    Lines without blocks are a single block, lines without a coding part
+    are skipped.
+    """
+    rows = []
+    with _open_text(filename) as fh:
+        for n, line in enumerate(fh):
+            if line.startswith(('#', 'track', 'browser')) or not line.strip():
+                continue
+            f = line.rstrip('\n\r').split('\t')
+            start, end = int(f[1]), int(f[2])
+            name = f[3] if len(f) > 3 else "{}:{}-{}".format(f[0], start, end)
+            strand = f[5] if len(f) > 5 else '+'
+            thick = (int(f[6]), int(f[7])) if len(f) > 7 else (start, end)
+            if len(f) > 11:
+                sizes = [int(x) for x in f[10].split(',') if x]
+                offsets = [int(x) for x in f[11].split(',') if x]
+                blocks = [(start + o, start + o + s) for o, s in zip(offsets, sizes)]
+            else:
+                blocks = [(start, end)]
+            for b_start, b_end in blocks:
+                b_start, b_end = max(b_start, thick[0]), min(b_end, thick[1])
+                if b_start < b_end:
+                    rows.append((name, f[0], b_start, b_end, strand, 0))
+    return pd.DataFrame(rows, columns=cds_columns)
+
+
+cdef class Genome:
+    """An uncompressed genome FASTA or UCSC `.2bit` file mapped into
+    memory, from which annotated coding sequences are counted in place
+
+    The lines of each FASTA record must be of equal length (as needed for
+    a samtools `.fai` index). `.2bit` files are recognised by their
+    signature, and their packed bases are counted without being decoded
+    to text. Their runs of N count as non-standard bases.
+    """
+    cdef codonwlib.GENOME_STRUCT genome
+    cdef object filename
+    cdef dict lookup
+
+    def __init__(self, filename):
+        fn = os.fsencode(filename)
+        cdef const char *cfn = fn
+        cdef int ret
+        with nogil:
+            ret = codonwlib.genome_open(&self.genome, cfn)
+        if ret == 1:
+            raise IOError("Could not read {}".format(filename))
+        elif ret == 2:
+            raise ValueError("The lines of each record of {} must be of equal "
+                             "length".format(filename))
+        elif ret == 3:
+            raise ValueError("{} is not a readable .2bit file".format(filename))
+        self.filename = filename
+        self.lookup = {name: i for i, name in enumerate(self.names)}
+
+    def __dealloc__(self):
+        codonwlib.genome_close(&self.genome)
+
+    @property
+    def names(self):
+        return [self.genome.rec[i].name.decode('UTF-8', 'replace')
+                for i in range(self.genome.n)]
+
+    @property
+    def lengths(self):
+        return pd.Series([self.genome.rec[i].length for i in range(self.genome.n)],
+                         index=self.names)
+
+    @property
+    def twobit(self):
+        """Whether the file is a `.2bit` file rather than FASTA"""
+        return self.genome.twobit != 0
+
+    def fetch(self, name, long long start=0, end=None, strand='+'):
+        """Bases `start` to `end` (0 based, end exclusive, by default the
+        end of the sequence) of sequence `name` as a `str`, reverse
+        complemented if `strand` is "-"
+
+        Bases of `.2bit` files are lower case in their soft masked runs and
+        N in their runs of N, as when converted to FASTA by `twoBitToFa`.
+        """
+        if name not in self.lookup:
+            raise KeyError(name)
+        cdef long rec = self.lookup[name]
+        cdef long long cend = self.genome.rec[rec].length if end is None else end
+        cdef char cstrand = ord(strand)
+        if start < 0 or start > cend or cend > self.genome.rec[rec].length:
+            raise ValueError("{}..{} is not within {}".format(start, cend, name))
+
+        out = bytearray(cend - start)
+        cdef char *pout
+        if cend > start:
+            pout = out
+            with nogil:
+                codonwlib.genome_fetch(&self.genome, rec, start, cend, cstrand, pout)
+        return out.decode('ascii')
+
+    def count_cds(self, annotation, format=None, genetic_code=0, int threads=1):
+        """Counts the coding sequences of an annotation, returning a
+        `CodonCounts` with one row per coding sequence (its chromosome as
+        the group), in order of first appearance
+
+        `annotation`: a GFF3 or BED12 file (optionally gzip compressed), or
+            a `pd.DataFrame` of segments as from `read_gff3`
+        `format`: "gff3" or "bed", by default from the file name
+        `genetic_code`: as for `CodonSeq`
+        `threads`: number of threads to count on
+
+        Segments are joined in the order they are transcribed: by start on
+        the plus strand, and reverse complemented by decreasing start on the
+        minus strand. The phase of the first segment gives the bases skipped
+        before the first codon.
+        """
+        cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+
+        segs = annotation
+        if not isinstance(annotation, pd.DataFrame):
+            if format is None:
+                name = str(annotation).lower()
+                name = name[:-3] if name.endswith('.gz') else name
+                format = 'bed' if name.endswith('.bed') else 'gff3'
+            if format == 'gff3':
+                segs = read_gff3(annotation)
+            elif format == 'bed':
+                segs = read_bed12(annotation)
+            else:
+                raise ValueError("Unknown annotation format {}".format(format))
+
+        # order of the segments of each coding sequence as transcribed
+        segs = segs.reset_index(drop=True)
+        ids = pd.unique(segs['id'])
+        rank = pd.Series(np.arange(len(ids)), index=ids)
+        minus = (segs['strand'] == '-').values
+        segs = segs.assign(_cds=rank[segs['id']].values,
+                           _key=np.where(minus, -segs['start'].values, segs['start'].values))
+        segs = segs.sort_values(['_cds', '_key'], kind='stable')
+
+        first = segs.groupby('_cds').head(1)
+        chroms = first['chrom'].values
+        unknown = sorted(set(chroms) - set(self.lookup))
+        if unknown:
+            raise ValueError("Sequences not in {}: {}".format(self.filename, ", ".join(unknown)))
+
+        starts = segs['start'].values.astype(np.longlong)
+        ends = segs['end'].values.astype(np.longlong)
+        phase = first['phase'].values
+        first_row = np.searchsorted(segs['_cds'].values, np.arange(len(ids)))
+        first_minus = first['strand'].values == '-'
+        starts[first_row[~first_minus]] += phase[~first_minus]
+        ends[first_row[first_minus]] -= phase[first_minus]
+
+        cdef long n = len(ids)
+        rec = np.array([self.lookup[c] for c in chroms], dtype=c_long)
+        strand = np.frombuffer(''.join(first['strand'].values).encode() or b'', dtype=np.int8).copy()
+        seg_ptr = np.append(first_row, len(segs)).astype(c_long)
+
+        ncod = np.zeros([n, 65], dtype=c_long)
+        naa = np.zeros([n, 22], dtype=c_long)
+        codon_tot = np.zeros([n], dtype=c_long)
+        valid_stops = np.zeros([n], dtype=c_int)
+        if n == 0:
+            return CodonCounts(ids, ncod, naa, codon_tot, valid_stops, genetic_code, groups=chroms)
+
+        cdef long[::1] rec_v = rec
+        cdef signed char[::1] strand_v = strand
+        cdef long[::1] ptr_v = seg_ptr
+        cdef long long[::1] starts_v = starts
+        cdef long long[::1] ends_v = ends
+        cdef long[:, ::1] ncod_v = ncod
+        cdef long[:, ::1] naa_v = naa
+        cdef long[::1] tot_v = codon_tot
+        cdef int[::1] stops_v = valid_stops
+        cdef int nbad
+        with nogil:
+            nbad = codonwlib.genome_count_cds(&self.genome, n, &rec_v[0], <char *>&strand_v[0],
+                &ptr_v[0], &starts_v[0], &ends_v[0], &code,
+                <long (*)[65]>&ncod_v[0, 0], <long (*)[22]>&naa_v[0, 0],
+                &tot_v[0], &stops_v[0], max(threads, 1))
+        if nbad < 0:
+            raise MemoryError()
+        elif nbad:
+            raise ValueError("{} coding sequences extend beyond their sequence".format(nbad))
+
+        return CodonCounts(ids, ncod, naa, codon_tot, valid_stops, genetic_code,
+                           groups=chroms)
+
+
+def count_cds(genome, annotation, format=None, genetic_code=0, int threads=1):
+    """Counts the coding sequences of a GFF3 or BED12 annotation straight
+    from an uncompressed genome FASTA or `.2bit` file, see `Genome.count_cds`
+    """
+    if not isinstance(genome, Genome):
+        genome = Genome(genome)
+    return genome.count_cds(annotation, format, genetic_code, threads)
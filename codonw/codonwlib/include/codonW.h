@@ -27,6 +27,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 #include <errno.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #define GARG_EXACT 0x800             /* used in function gargs  */
 #define GARG_NEXT 0x1000             /* used in function gargs  */
@@ -61,6 +62,18 @@ typedef struct
   int aromo[22];   /* aromaticity values       */
 } AMINO_PROP_STRUCT;
 
+typedef struct
+{
+  double mass[22];      /* average mass of the free amino acid */
+  double water;         /* lost by each peptide bond          */
+  double pk[22];        /* pK of ionisable side chains        */
+  int charge[22];       /* their charge, +1 basic, -1 acidic  */
+  double pk_nterm;      /* pK of the amino terminus           */
+  double pk_cterm;      /*       the carboxyl terminus        */
+  double extinct[22];   /* molar extinction at 280 nm         */
+  double aliphatic[22]; /* weight in the aliphatic index      */
+} PROTEIN_PROP_STRUCT;
+
 typedef struct
 {
   char *des;        /* store a description      */
@@ -120,6 +133,269 @@ typedef struct
   int *ds;
 } MENU_STRUCT;
 
+typedef struct
+{
+  GENETIC_CODE_STRUCT *pcu; /* the genetic code                   */
+  int ds[65];               /* how synonymous each codon is       */
+  int da[23];               /* No. of codons for each amino acid  */
+} CODE_PLAN_STRUCT;         /* a genetic code prepared for use    */
+
+/* indices calculated by batch_indices, in the order of the output      */
+enum
+{
+  INDEX_CAI, INDEX_FOP, INDEX_CBI, INDEX_ENC, INDEX_GRAVY, INDEX_AROMO,
+  INDEX_GC, INDEX_GC3S, INDEX_L_SYM, INDEX_L_AA,
+  INDEX_T3S, INDEX_C3S, INDEX_A3S, INDEX_G3S,
+  NUM_INDICES
+};
+
+typedef struct
+{
+  CODE_PLAN_STRUCT *plan;  /* genetic code                       */
+  CAI_STRUCT cai;          /* CAI w values (a private copy)      */
+  FOP_STRUCT *pfop;        /* optimal codons for Fop             */
+  FOP_STRUCT *pcbi;        /*                    CBI             */
+  AMINO_PROP_STRUCT *pap;  /* amino acid properties              */
+  bool factor_in_rare;     /* Fop = (opt-rare)/total ?           */
+} INDEX_PLAN_STRUCT;       /* what batch_indices needs           */
+
+typedef struct
+{
+  uint64_t h1, h2;          /* MurmurHash3 x64 128 bit state      */
+  unsigned char tail[16];   /* bytes short of a whole block       */
+  int ntail;                /* No. of bytes held in tail          */
+  unsigned long long len;   /* No. of bytes hashed                */
+} SEQ_HASH_STRUCT;          /* hash of a sequence fed in pieces   */
+
+typedef struct
+{
+  long long len;      /* No. of bases                       */
+  long long nwords;   /* No. of words allocated             */
+  uint64_t *words;    /* 2 bits per base, 32 to a word      */
+  long nexc, exc_cap; /* runs of non-standard characters,   */
+  long long (*exc)[2]; /* start and length of each          */
+  char *exc_chars;    /* their characters, in order         */
+  long long nexc_chars, exc_chars_cap;
+  long nlow, low_cap; /* runs of lower case bases           */
+  long long (*low)[2];
+  long nrna, rna_cap; /* runs of U                          */
+  long long (*rna)[2];
+} PACKED_SEQ_STRUCT;  /* a sequence at 2 bits per base      */
+
+typedef struct
+{
+  GENETIC_CODE_STRUCT *pcu; /* genetic code used to translate      */
+  char dinuc;               /* also count dinucleotides ?        */
+  char hash;                /* also hash the sequence ?           */
+
+  long long seqlen;    /* No. of bases fed so far            */
+  long codon_tot;      /* No. of complete codons             */
+  int valid_stops;     /* set by finish if last codon is stop */
+  long ncod[65];       /* codon usage                        */
+  long naa[22];        /* amino acid usage                   */
+
+  char codon[3];       /* bases of a codon split by a chunk  */
+  int ncodon;          /* No. of bases held in codon         */
+  int last_icode;      /* last complete codon counted        */
+
+  long din[3][16];     /* dinucleotide usage by frame        */
+  int fram;            /* frame of the next dinucleotide     */
+  int last_base;       /* code of previous base, 0 if none   */
+
+  SEQ_HASH_STRUCT hstate; /* hash of the bases fed so far     */
+  uint64_t digest[2];  /* set by finish if hash is set       */
+
+  char *prot;          /* if set, the translation is written */
+  long long nprot;     /* here, one letter per codon         */
+  PACKED_SEQ_STRUCT *pack; /* if set, the bases are packed here */
+} CODON_STREAM_STRUCT; /* state carried between chunks       */
+
+typedef enum
+{
+  COUNT_LONG,        /* long, as used everywhere else      */
+  COUNT_U32,         /* uint32_t                           */
+  COUNT_U16          /* uint16_t                           */
+} COUNT_TYPE;        /* element type of batch count matrices */
+
+typedef struct
+{
+  long n;            /* No. of records                     */
+  long cap;          /* No. of records allocated           */
+  char **title;      /* record titles                      */
+  void *ncod;        /* codon usage of each record [n][65] */
+  void *naa;         /* amino acid usage of each record [n][22] */
+  COUNT_TYPE type;   /* element type of ncod and naa       */
+  char widen;        /* widen type when a count overflows ? */
+  long *codon_tot;   /* No. of codons in each record       */
+  int *valid_stops;  /* record ends with a stop codon ?    */
+  char hash;         /* also hash each record ?            */
+  uint64_t (*digest)[2]; /* hash of each record if hash is set */
+} COUNT_TABLE_STRUCT; /* counts of many records           */
+
+typedef struct
+{
+  long long len;      /* No. of bases indexed               */
+  int step;           /* codons between checkpoints         */
+  unsigned char *codes; /* code of the codon at each base    */
+  long nchk;          /* No. of checkpoints in each frame   */
+  long (*cum[3])[65]; /* codon usage before each checkpoint */
+} CODON_INDEX_STRUCT; /* prefix sums of codons of a sequence */
+
+typedef struct
+{
+  char *name;         /* title up to the first white space  */
+  long long offset;   /* file offset of the first base      */
+  long long length;   /* No. of bases                       */
+  long linebases;     /* bases in each full line            */
+  long linewidth;     /* bytes in each full line            */
+  long nblocks;       /* .2bit: No. of runs of N            */
+  long long nblock;   /* .2bit: file offset of their starts, sizes follow */
+  long nmasks;        /* .2bit: No. of lower case runs      */
+  long long mask;     /* .2bit: file offset of their starts, sizes follow */
+} GENOME_RECORD;
+
+typedef struct
+{
+  const char *map;    /* the whole file, mapped into memory */
+  size_t size;        /* bytes mapped                       */
+  long n;             /* No. of records                     */
+  long cap;           /* No. of records allocated           */
+  GENOME_RECORD *rec; /* layout of each record              */
+  char twobit;        /* a .2bit file rather than FASTA     */
+  char swap;          /* its words are of the other byte order */
+} GENOME_STRUCT;      /* a FASTA or .2bit file read in place */
+
+#define KMER_MAX_K 32 /* longest k-mer held in a word        */
+
+typedef struct
+{
+  long cap;           /* No. of slots, a power of two       */
+  long n;             /* No. of slots used                  */
+  uint64_t *key;      /* k-mer of each slot                 */
+  unsigned char *used; /* 1 where a slot holds a k-mer, as   */
+                       /* every key is valid when k is 32    */
+  long (*count)[3];   /* its count in each frame            */
+} KMER_TABLE_STRUCT;  /* k-mers of a sequence, hashed       */
+
+typedef struct
+{
+  long n;             /* No. of (row, k-mer) entries        */
+  long *row;          /* row of each entry                  */
+  uint64_t *kmer;     /* its k-mer, 2 bits per base         */
+  long (*count)[3];   /* its count in each frame            */
+} KMER_COO_STRUCT;    /* k-mer counts of many rows, sparse  */
+
+typedef struct
+{
+  long ngroups;       /* No. of group keys                  */
+  int nwhich;         /* No. of indices summarised          */
+  int nbins;          /* histogram bins of each index       */
+  const double *lo;   /* histogram range of each index      */
+  const double *hi;
+  long *count;        /* ngroups x nwhich values folded     */
+  long *nan;          /* ngroups x nwhich NaNs skipped      */
+  double *mean;       /* ngroups x nwhich running mean      */
+  double *m2;         /* sum of squared deviations (Welford) */
+  double *min;
+  double *max;
+  long *hist;         /* ngroups x nwhich x (nbins + 2), under- and */
+                      /* overflow in the first and last bins        */
+} SUMMARY_STRUCT;     /* distributions of indices by group  */
+
+typedef enum
+{
+  DIST_EUCLIDEAN,     /* sqrt(sum (a - b)^2)                */
+  DIST_MANHATTAN,     /* sum |a - b|                        */
+  DIST_CHI2,          /* sum (a - b)^2 / (a + b)            */
+  DIST_KARLIN         /* sum (wa + wb) |a - b|              */
+} DIST_METRIC;        /* distances between feature rows     */
+
+typedef struct
+{
+  long n;             /* No. of pairs                       */
+  long cap;           /* No. of pairs allocated             */
+  long *i;            /* rows of each pair, i < j           */
+  long *j;
+  double *d;          /* distance of each pair              */
+} DIST_PAIRS_STRUCT;  /* pairs closer than a threshold      */
+
+typedef enum
+{
+  COA_CA,             /* correspondence analysis of counts  */
+  COA_PCA_RSCU,       /* principal components of RSCU       */
+  COA_PCA_FREQ        /*                      of frequencies */
+} COA_METHOD;         /* ordinations of codon usage         */
+
+/* protein properties calculated by protein_props                       */
+enum
+{
+  PROT_MW, PROT_PI, PROT_CHARGE, PROT_ALIPHATIC, PROT_EXTINCT,
+  PROT_GRAVY, PROT_AROMO,
+  NUM_PROT
+};
+
+typedef struct
+{
+  PROTEIN_PROP_STRUCT *ppp; /* masses, pK ...                     */
+  AMINO_PROP_STRUCT *pap;   /* hydropathicity and aromaticity     */
+  double ph;                /* pH of PROT_CHARGE                  */
+  int nscale;               /* No. of further scales              */
+  const double *scale;      /* nscale x 22 values averaged over   */
+                            /* the residues                       */
+} PROTEIN_PLAN_STRUCT;      /* what protein_props needs           */
+
+typedef enum
+{
+  PROFILE_START,      /* codons counted from the first      */
+  PROFILE_END,        /* codons counted from the last       */
+  PROFILE_RELATIVE    /* fractions of the gene              */
+} PROFILE_MODE;       /* bins of codon_profile              */
+
+/* expression level predictors calculated by expr_scores              */
+enum
+{
+  EXPR_MILC, EXPR_MILC_HE, EXPR_MELP, EXPR_B, EXPR_B_HE, EXPR_E,
+  NUM_EXPR
+};
+
+typedef struct
+{
+  CODE_PLAN_STRUCT *plan;  /* genetic code                       */
+  long ngroups;       /* No. of genomes                     */
+  double *f;          /* ngroups x 2 x 65 frequency of each codon */
+                      /* in its amino acid, in the genome and in  */
+                      /* its highly expressed genes               */
+} EXPR_PLAN_STRUCT;   /* per genome references of expr_scores */
+
+typedef struct
+{
+  DIST_METRIC metric; /* DIST_EUCLIDEAN or DIST_MANHATTAN    */
+  int rscu;           /* features are RSCU (else frequency) */
+  long n;             /* No. of points                      */
+  long long *order;   /* row of the point at each position  */
+  double *mu;         /* radius of the node at each position */
+  float *feat;        /* n x 64 features in tree order      */
+  const char *extra;  /* caller data saved with the tree    */
+  size_t nextra;
+  void *map;          /* the file, if loaded                */
+  size_t size;
+} VPTREE_STRUCT;      /* vantage point tree of feature rows */
+
+typedef enum
+{
+  SCORE_CAI,          /* exp(num / den)                     */
+  SCORE_FOP           /* num / den                          */
+} SCORE_KIND;
+
+typedef struct
+{
+  SCORE_KIND kind;
+  long nref;          /* No. of references                  */
+  double *num;        /* 64 x nref weights of each codon    */
+  double *den;        /* 64 x nref, NULL if den1 is shared  */
+  double den1[64];    /* weights shared by every reference  */
+} SCORE_PLAN_STRUCT;  /* many references of one index       */
+
 typedef struct {
   GENETIC_CODE_STRUCT *cu;
   FOP_STRUCT *fop;
@@ -129,16 +405,23 @@ typedef struct {
   AMINO_PROP_STRUCT *amino_prop;
 } REF_STRUCT;
 
+/* CODONW_NO_STDIO leaves out the menu globals and the text output of the */
+/* original program, as for the embeddable library (see libcodonw.h)      */
+#ifndef CODONW_NO_STDIO
 extern REF_STRUCT Z_ref;
 extern MENU_STRUCT Z_menu;
+#endif
 extern GENETIC_CODE_STRUCT cu_ref[];
 extern FOP_STRUCT fop_ref[];
 extern CAI_STRUCT cai_ref[];
 extern AMINO_STRUCT amino_acids;
 extern AMINO_PROP_STRUCT amino_prop;
+extern PROTEIN_PROP_STRUCT protein_prop;
+extern const unsigned char base_code[256];
 
 /****************** Function type declarations *****************************/
 
+#ifndef CODONW_NO_STDIO
 // defined in commline.c
 int proc_comm_line(int *argc, char ***arg_list, MENU_STRUCT *pm);
 
@@ -146,17 +429,23 @@ int proc_comm_line(int *argc, char ***arg_list, MENU_STRUCT *pm);
 int tidy(FILE *finput, FILE *foutput, FILE *fblkout);
 int my_exit(int exit_value, char *message);
 FILE *open_file(char *filename, char *mode);
+#endif
 
 // defined in codon_us.c
 int clean_up(long *ncod, long *naa, int *valid_stops);
+#ifndef CODONW_NO_STDIO
 int initialize_point(char code, char fop_type, char cai_type, MENU_STRUCT *pm, REF_STRUCT *ref);
+#endif
 int ident_codon(char *codon);
 int how_synon(int dds[], GENETIC_CODE_STRUCT *pcu);
 int how_synon_aa(int dda[], GENETIC_CODE_STRUCT *pcu);
+int code_plan_init(CODE_PLAN_STRUCT *pp, GENETIC_CODE_STRUCT *pcu);
 
 int count_codons(long* ncod, long *loc_cod_tot);
 
 int codon_usage_tot(char *seq, long *codon_tot, int *valid_stops, long ncod[], long naa[], GENETIC_CODE_STRUCT *pcu);
+int tally_codons(const char *seq, long long n, long ncod[], long naa[], GENETIC_CODE_STRUCT *pcu, char *prot);
+#ifndef CODONW_NO_STDIO
 int codon_usage_out(FILE *fblkout, long *ncod, char *info, MENU_STRUCT *pm);
 int rscu_usage_out(FILE *fblkout, long *ncod, long *naa, char* title, MENU_STRUCT *pm);
 int raau_usage_out(FILE *fblkout, long *naa, char* title, MENU_STRUCT *pm);
@@ -171,6 +460,7 @@ int dinuc_out(char *seq, FILE *fblkout, char *ttitle, char sp);
 int enc_out(FILE *foutput, long *ncod, long *naa, MENU_STRUCT *pm);
 int gc_out(FILE *foutput, FILE *fblkout, long *ncod, int which, char* title, MENU_STRUCT *pm);
 int base_sil_us_out(FILE *foutput, long *ncod, long *naa, MENU_STRUCT *pm);
+#endif
 
 
 int rscu_usage(long *nncod, long *nnaa, float rscu[], int *ds, GENETIC_CODE_STRUCT *pcu);
@@ -182,5 +472,120 @@ int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STR
 int enc(long *nncod, long *nnaa, float *enc_tot, int *da, GENETIC_CODE_STRUCT *pcu);
 int gc(int *ds, long *ncod, long bases[5], long base_tot[5], long base_1[5], long base_2[5], long base_3[5], long *tot_s, long *totalaa, double gc_metrics[], GENETIC_CODE_STRUCT *pcu);
 int dinuc_count(char *seq, long din[3][16], long dinuc_tot[4], int *fram);
+int dinuc_feed(const char *seq, long long len, long din[3][16], int *fram, int *last);
 int hydro(long *nnaa, float *hydro, float hydro_ref[22]);
 int aromo(long *nnaa, float *aromo, int aromo_ref[22]);
+
+// defined in codon_stream.c
+int codon_stream_init(CODON_STREAM_STRUCT *ps, GENETIC_CODE_STRUCT *pcu, char dinuc);
+int codon_stream_feed(CODON_STREAM_STRUCT *ps, const char *chunk, long long len);
+int codon_stream_feed_codes(CODON_STREAM_STRUCT *ps, const unsigned char *codes, long long len);
+int codon_stream_finish(CODON_STREAM_STRUCT *ps);
+
+// defined in codon_fasta.c
+int count_table_init(COUNT_TABLE_STRUCT *pt);
+int count_table_add(COUNT_TABLE_STRUCT *pt, const char *title, long title_len, CODON_STREAM_STRUCT *ps);
+int count_table_free(COUNT_TABLE_STRUCT *pt);
+int fasta_count(const char *filename, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt);
+int fasta_count_range(const char *filename, long long start, long long end, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt);
+
+// defined in codon_hash.c
+void seq_hash_init(SEQ_HASH_STRUCT *ph);
+void seq_hash_feed(SEQ_HASH_STRUCT *ph, const char *buf, long long len);
+void seq_hash_final(SEQ_HASH_STRUCT *ph, uint64_t digest[2]);
+
+// defined in codon_genome.c
+int genome_open(GENOME_STRUCT *pg, const char *filename);
+void genome_close(GENOME_STRUCT *pg);
+int genome_feed(GENOME_STRUCT *pg, long rec, long long start, long long end, char strand, CODON_STREAM_STRUCT *ps);
+int genome_fetch(GENOME_STRUCT *pg, long rec, long long start, long long end, char strand, char *out);
+int genome_count_cds(GENOME_STRUCT *pg, long n, const long *rec, const char *strand, const long *seg_ptr, const long long *seg_start, const long long *seg_end, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads);
+
+// defined in codon_ranges.c
+int codon_index_build(CODON_INDEX_STRUCT *px, const char *seq, long long len, int step);
+int codon_index_query(CODON_INDEX_STRUCT *px, long long start, long long end, GENETIC_CODE_STRUCT *pcu, long ncod[65], long naa[22], long *codon_tot, int *valid_stops);
+int codon_index_ranges(CODON_INDEX_STRUCT *px, long n, const long long *starts, const long long *ends, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads);
+void codon_index_free(CODON_INDEX_STRUCT *px);
+
+// defined in codon_simd.c
+void base_codes(const char *seq, long n, unsigned char *codes);
+void codon_codes(const char *seq, long n, unsigned char *codes);
+void widen_counts(const void *m, COUNT_TYPE type, long n, long *out);
+void score_block(const double *c, long nc, const double *w, long ldw, long nw, double *acc);
+void dist_block(DIST_METRIC metric, const double *a, const double *wa, long na, const double *bt, const double *wbt, long ldb, long nb, double *out, long ldo);
+const char *simd_variant(int i);
+int simd_supported(const char *name);
+const char *simd_isa(void);
+int simd_select(const char *name);
+
+// defined in codon_batch.c
+typedef void (*ROWS_FUNC)(long lo, long hi, void *ctx);
+int parallel_rows(long n, int threads, ROWS_FUNC fn, void *ctx);
+int index_plan_init(INDEX_PLAN_STRUCT *pi, CODE_PLAN_STRUCT *plan, CAI_STRUCT *pcai, FOP_STRUCT *pfop, FOP_STRUCT *pcbi, AMINO_PROP_STRUCT *pap, bool factor_in_rare);
+void count_row_get(const void *m, COUNT_TYPE type, int ncols, long i, long *row);
+void count_row_set(void *m, COUNT_TYPE type, int ncols, long i, const long *row);
+int count_seqs(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, void *ncod, void *naa, COUNT_TYPE type, long *codon_tot, int *valid_stops, uint64_t (*digest)[2], char *prot, const long long *prot_off, int threads);
+int batch_indices(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, double *out, long out_stride, INDEX_PLAN_STRUCT *pi, int threads);
+int batch_summary(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, const long *group, INDEX_PLAN_STRUCT *pi, SUMMARY_STRUCT *ps, int threads);
+
+// defined in codon_vptree.c
+int vptree_build(VPTREE_STRUCT *pt, DIST_METRIC metric, long n, const double *feat, int threads);
+int vptree_query(const VPTREE_STRUCT *pt, long nq, const double *q, int k, double eps, long budget, long *nbr, double *dist, int threads);
+int vptree_save(const VPTREE_STRUCT *pt, const char *filename);
+int vptree_load(VPTREE_STRUCT *pt, const char *filename);
+void vptree_free(VPTREE_STRUCT *pt);
+
+// defined in codon_coa.c
+int coa_accumulate(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, double *weight, double *mean, double *gram, int threads);
+int coa_project(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, const double *center, const double *axes, int k, double *out, int threads);
+
+// defined in codon_packed.c
+void packed_init(PACKED_SEQ_STRUCT *pp);
+void packed_free(PACKED_SEQ_STRUCT *pp);
+int packed_feed(PACKED_SEQ_STRUCT *pp, const char *chunk, long long len);
+void packed_unpack(const PACKED_SEQ_STRUCT *pp, long long start, long long end, char *out);
+int packed_tally(const PACKED_SEQ_STRUCT *pp, long long start, long long end, long ncod[65], long naa[22], GENETIC_CODE_STRUCT *pcu);
+void packed_dinuc(const PACKED_SEQ_STRUCT *pp, long din[3][16]);
+void packed_windows(const PACKED_SEQ_STRUCT *pp, long long width, long long step, long nwin, long long *gc, long long *valid);
+
+// defined in codon_kmer.c
+int kmer_table_init(KMER_TABLE_STRUCT *pt, long cap);
+void kmer_table_clear(KMER_TABLE_STRUCT *pt);
+void kmer_table_free(KMER_TABLE_STRUCT *pt);
+int kmer_feed(const char *seq, long long len, int k, int by_count, long *dense, KMER_TABLE_STRUCT *pt);
+int kmer_seqs(long n, const char **seqs, const long long *lens, int k, int by_count, long *dense, int threads);
+int kmer_seqs_sparse(long n, const char **seqs, const long long *lens, int k, int by_count, KMER_COO_STRUCT *pc, int threads);
+void kmer_coo_free(KMER_COO_STRUCT *pc);
+
+// defined in codon_protein.c
+void protein_row(const long naa[22], PROTEIN_PLAN_STRUCT *pp, const int *which, int nwhich, double *out);
+int protein_props(long n, const void *naa, COUNT_TYPE type, PROTEIN_PLAN_STRUCT *pp, const int *which, int nwhich, double *out, long out_stride, int threads);
+
+// defined in codon_expr.c
+int expr_totals(long n, const void *ncod, COUNT_TYPE type, const long *group, const unsigned char *he, long ngroups, long (*tot)[65], long (*tot_he)[65], int threads);
+int expr_plan_init(EXPR_PLAN_STRUCT *pe, CODE_PLAN_STRUCT *plan, long ngroups, long (*tot)[65], long (*tot_he)[65], double pseudo);
+void expr_plan_free(EXPR_PLAN_STRUCT *pe);
+int expr_scores(long n, const void *ncod, COUNT_TYPE type, const long *group, EXPR_PLAN_STRUCT *pe, const int *which, int nwhich, double *out, long out_stride, int threads);
+
+// defined in codon_profile.c
+int codon_profile(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, PROFILE_MODE mode, long nbins, long width, long (*ncod)[65], long (*naa)[22], long *genes, int threads);
+
+// defined in codon_score.c
+int score_plan_cai(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const double *w);
+int score_plan_fop(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const char *fop_cod, bool factor_in_rare);
+void score_plan_free(SCORE_PLAN_STRUCT *ps);
+int score_matrix(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, double *out, long out_stride, int threads);
+int score_topk(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, int k, long *top, double *score, int threads);
+
+// defined in codon_dist.c
+int dist_features(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, DIST_METRIC metric, bool rscu, double *feat, double *wt);
+int dist_matrix(DIST_METRIC metric, long na, const double *fa, const double *wa, long nb, const double *fb, const double *wb, double *out, long out_stride, int threads);
+int dist_condensed(DIST_METRIC metric, long n, const double *f, const double *w, double *out, int threads);
+int dist_within(DIST_METRIC metric, long n, const double *f, const double *w, double threshold, DIST_PAIRS_STRUCT *pp, int threads);
+void dist_pairs_free(DIST_PAIRS_STRUCT *pp);
+
+// defined in codon_summary.c
+int summary_alloc(SUMMARY_STRUCT *ps, long ngroups, int nwhich, int nbins, const double *lo, const double *hi);
+void summary_free(SUMMARY_STRUCT *ps);
+void summary_reset(SUMMARY_STRUCT *ps);
+void summary_add(SUMMARY_STRUCT *ps, long group, const double *values);
@@ -0,0 +1,511 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+Header only C++17 kernels of codon usage indices (CAI, Fop, Nc, G+C and
+RSCU) specialised at compile time for each genetic code of cu_ref. The
+tables of a code (amino acid and family size of each codon, the codons of
+each family, which are stops or synonymous, the G+C of each codon) are
+constexpr, and the loops over codons and families are expanded for the
+code, so that the built in codes use constant indices and masks instead of
+looking up pcu->ca[x] and ds[x] at run time. User defined codes use the
+same kernels with run time tables (codonw::Dynamic). The results are those
+of the C functions of the same name, to the last bit.
+
+   codonw::with_code(0, [&](auto code) {
+      double w = codonw::cai(code, ncod, cai_w);
+      double nc = codonw::enc(code, ncod, naa);
+   });
+
+Codons are indexed as in codonW (1 to 64, see Recoding.md), amino acids as
+amino_acids.aa1 (11 for stops).
+
+************************************************************************/
+
+#ifndef CODONW_HPP
+#define CODONW_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace codonw
+{
+
+constexpr int num_builtin_codes = 8;
+
+/* one letter amino acids of the 64 codons in the NCBI order (TTT, TTC,  */
+/* TTA, TTG, TCT, ... GGG) for each genetic code of cu_ref               */
+inline constexpr const char *builtin_translation[num_builtin_codes] = {
+    "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSS**VVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCWWTTTTPPPPHHQQRRRRIIMMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSSSSVVVVAAAADDEEGGGG",
+    "FFLLSSSSYYQQCC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCCWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+    "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNNKSSSSVVVVAAAADDEEGGGG"};
+
+inline constexpr char aa1[] = "XFLIMVSPTAY*HQNKDECWRG"; /* as amino_acids.aa1 */
+constexpr int stop_aa = 11;
+constexpr int max_family = 8; /* largest family Nc can handle */
+
+/* codonW index of the k-th codon of the NCBI order                     */
+constexpr int ncbi_icode(int k)
+{
+   return (k >> 4) * 16 + ((k >> 2) & 3) + 1 + (k & 3) * 4;
+}
+
+struct CodeTables
+{
+   int ca[65];                 /* amino acid of each codon           */
+   int ds[65];                 /* size of its family                 */
+   int da[23];                 /* No. of codons of each amino acid   */
+   int fold[max_family + 1];   /* No. of amino acids of each size    */
+   int nsense;                 /* codons that are not stops          */
+   unsigned char sense[64];
+   int nsyn;                   /* of those, in families of two or more */
+   unsigned char syn[64];
+   int fam_start[23];          /* codons of amino acid a are          */
+   unsigned char fam[64];      /* fam[fam_start[a]..fam_start[a+1]-1] */
+   unsigned char gcn[65];      /* G or C bases of each codon          */
+   bool gc3[65];               /* third base G or C                   */
+   bool valid;                 /* every codon has an amino acid and   */
+                               /* no family is larger than max_family */
+};
+
+/* tables of a code given as the amino acid of each codon               */
+constexpr CodeTables tables_from_ca(const int *ca)
+{
+   CodeTables t{};
+   int x = 0, i = 0, a = 0, p = 0;
+
+   t.valid = true;
+   for (x = 1; x < 65; x++)
+   {
+      t.ca[x] = ca[x];
+      if (ca[x] < 1 || ca[x] > 21)
+         t.valid = false;
+   }
+   if (!t.valid)
+      return t;
+
+   for (x = 1; x < 65; x++)
+   {
+      for (i = 1; i < 65; i++)
+         t.ds[x] += t.ca[i] == t.ca[x];
+      t.da[t.ca[x]]++;
+   }
+   for (a = 1; a < 22; a++)
+      if (a != stop_aa)
+      {
+         if (t.da[a] > max_family)
+            t.valid = false;
+         else
+            t.fold[t.da[a]]++;
+      }
+
+   for (x = 1; x < 65; x++)
+   {
+      int b1 = (x - 1) / 16 + 1, b2 = (x - 1) % 4 + 1, b3 = (x - 1) / 4 % 4 + 1;
+
+      t.gcn[x] = (unsigned char)((b1 % 2 == 0) + (b2 % 2 == 0) + (b3 % 2 == 0));
+      t.gc3[x] = b3 % 2 == 0; /* C = 2, G = 4 */
+      if (t.ca[x] == stop_aa)
+         continue;
+      t.sense[t.nsense++] = (unsigned char)x;
+      if (t.ds[x] != 1)
+         t.syn[t.nsyn++] = (unsigned char)x;
+   }
+
+   for (a = 0; a < 22; a++)
+   {
+      t.fam_start[a] = p;
+      for (x = 1; x < 65; x++)
+         if (t.ca[x] == a)
+            t.fam[p++] = (unsigned char)x;
+   }
+   t.fam_start[22] = p;
+   return t;
+}
+
+/* tables of a code given as 64 one letter amino acids in NCBI order    */
+constexpr CodeTables tables_from_translation(const char *translation)
+{
+   int ca[65] = {0};
+   int k = 0, a = 0;
+
+   for (k = 0; k < 64 && translation[k]; k++)
+   {
+      for (a = 1; a < 22 && aa1[a] != translation[k]; a++)
+         ;
+      ca[ncbi_icode(k)] = a < 22 ? a : 0;
+   }
+   return tables_from_ca(ca);
+}
+
+template <int Id>
+inline constexpr CodeTables builtin_tables = tables_from_translation(builtin_translation[Id]);
+
+/******************  Codes                  *******************************/
+/* Builtin<Id> is a code of cu_ref, whose tables are known at compile    */
+/* time. Dynamic holds the tables of any other code                      */
+/**************************************************************************/
+template <int Id>
+struct Builtin
+{
+   static_assert(Id >= 0 && Id < num_builtin_codes, "no such built in code");
+   static_assert(builtin_tables<Id>.valid, "invalid built in code");
+   static constexpr int id = Id;
+   static constexpr const CodeTables &tables = builtin_tables<Id>;
+};
+
+struct Dynamic
+{
+   CodeTables tables;
+
+   explicit Dynamic(const int ca[65]) : tables(tables_from_ca(ca))
+   {
+      if (!tables.valid)
+         throw std::invalid_argument("codonw: invalid genetic code");
+   }
+   explicit Dynamic(const char *translation)
+       : tables(tables_from_translation(translation))
+   {
+      if (!tables.valid)
+         throw std::invalid_argument("codonw: invalid genetic code");
+   }
+};
+
+namespace detail
+{
+/* the loops of the kernels. For a built in code they are expanded, one  */
+/* call of the body per codon, with the codon (and so its amino acid,    */
+/* family size and bases) a constant                                     */
+template <const CodeTables &T, class Body, std::size_t... I>
+inline void expand_sense(Body &body, std::index_sequence<I...>)
+{
+   (body(int(T.sense[I])), ...);
+}
+
+template <const CodeTables &T, class Body, std::size_t... I>
+inline void expand_syn(Body &body, std::index_sequence<I...>)
+{
+   (body(int(T.syn[I])), ...);
+}
+
+template <class Body, std::size_t... I>
+inline void expand_all(Body &body, std::index_sequence<I...>)
+{
+   (body(int(I) + 1), ...);
+}
+
+template <const CodeTables &T, int A, class Body, std::size_t... I>
+inline void expand_family(Body &body, std::index_sequence<I...>)
+{
+   (body(int(T.fam[T.fam_start[A] + I])), ...);
+}
+
+template <const CodeTables &T, class Body, std::size_t... A>
+inline void expand_families(Body &body, std::index_sequence<A...>)
+{
+   (body(int(A), [](auto &&f) {
+       expand_family<T, int(A)>(
+           f, std::make_index_sequence<T.fam_start[A + 1] - T.fam_start[A]>{});
+    }),
+    ...);
+}
+} // namespace detail
+
+inline const CodeTables &tables(const Dynamic &code) { return code.tables; }
+
+template <int Id>
+constexpr const CodeTables &tables(Builtin<Id>) { return builtin_tables<Id>; }
+
+/* body(x) for each codon x that is not a stop                           */
+template <int Id, class Body>
+inline void each_sense(Builtin<Id>, Body &&body)
+{
+   detail::expand_sense<builtin_tables<Id>>(
+       body, std::make_index_sequence<builtin_tables<Id>.nsense>{});
+}
+
+template <class Body>
+inline void each_sense(const Dynamic &code, Body &&body)
+{
+   for (int k = 0; k < code.tables.nsense; k++)
+      body(int(code.tables.sense[k]));
+}
+
+/* body(x) for each codon x that is not a stop and has synonyms          */
+template <int Id, class Body>
+inline void each_syn(Builtin<Id>, Body &&body)
+{
+   detail::expand_syn<builtin_tables<Id>>(
+       body, std::make_index_sequence<builtin_tables<Id>.nsyn>{});
+}
+
+template <class Body>
+inline void each_syn(const Dynamic &code, Body &&body)
+{
+   for (int k = 0; k < code.tables.nsyn; k++)
+      body(int(code.tables.syn[k]));
+}
+
+/* body(x) for x = 1 to 64                                               */
+template <int Id, class Body>
+inline void each_codon(Builtin<Id>, Body &&body)
+{
+   detail::expand_all(body, std::make_index_sequence<64>{});
+}
+
+template <class Body>
+inline void each_codon(const Dynamic &, Body &&body)
+{
+   for (int x = 1; x < 65; x++)
+      body(x);
+}
+
+/* body(a, codons) for each amino acid a = 0 to 21, where codons(f)     */
+/* calls f(x) for each codon x of a in increasing order                  */
+template <int Id, class Body>
+inline void each_family(Builtin<Id>, Body &&body)
+{
+   detail::expand_families<builtin_tables<Id>>(body, std::make_index_sequence<22>{});
+}
+
+template <class Body>
+inline void each_family(const Dynamic &code, Body &&body)
+{
+   const CodeTables &t = code.tables;
+   for (int a = 0; a < 22; a++)
+      body(a, [&t, a](auto &&f) {
+         for (int k = t.fam_start[a]; k < t.fam_start[a + 1]; k++)
+            f(int(t.fam[k]));
+      });
+}
+
+/******************  Dispatch               *******************************/
+/* Calls f(code) with code the Builtin of a cu_ref code id. f is         */
+/* instantiated for every built in code, so must return the same type    */
+/* for each, which with_code returns                                     */
+/**************************************************************************/
+template <class F>
+inline decltype(auto) with_code(int id, F &&f)
+{
+   switch (id)
+   {
+   case 0: return f(Builtin<0>{});
+   case 1: return f(Builtin<1>{});
+   case 2: return f(Builtin<2>{});
+   case 3: return f(Builtin<3>{});
+   case 4: return f(Builtin<4>{});
+   case 5: return f(Builtin<5>{});
+   case 6: return f(Builtin<6>{});
+   case 7: return f(Builtin<7>{});
+   }
+   throw std::out_of_range("codonw: genetic code must be between 0 and 7");
+}
+
+/* the cu_ref code with the amino acids ca[1..64], or -1                 */
+inline int builtin_id(const int ca[65])
+{
+   static const CodeTables *const all[num_builtin_codes] = {
+       &builtin_tables<0>, &builtin_tables<1>, &builtin_tables<2>,
+       &builtin_tables<3>, &builtin_tables<4>, &builtin_tables<5>,
+       &builtin_tables<6>, &builtin_tables<7>};
+   int id, x;
+
+   for (id = 0; id < num_builtin_codes; id++)
+   {
+      for (x = 1; x < 65 && all[id]->ca[x] == ca[x]; x++)
+         ;
+      if (x == 65)
+         return id;
+   }
+   return -1;
+}
+
+/* as above for a code given by the amino acid of each codon: the        */
+/* Builtin when it is one of cu_ref, otherwise a Dynamic                 */
+template <class F>
+inline decltype(auto) with_code(const int ca[65], F &&f)
+{
+   int id = builtin_id(ca);
+
+   if (id < 0)
+      return f(Dynamic(ca));
+   return with_code(id, std::forward<F>(f));
+}
+
+/******************  Kernels                *******************************/
+/* Each takes the code (a Builtin or a Dynamic) and the counts of one    */
+/* sequence, ncod[65] by codon and naa[22] by amino acid, as made by     */
+/* codon_usage_tot. They sum in the same order as the C functions        */
+/**************************************************************************/
+
+/* Codon Adaptation Index, with w[65] the relative adaptiveness of each  */
+/* codon (cai_val of CAI_STRUCT)                                         */
+template <class Code>
+inline double cai(const Code &code, const long *ncod, const float *w)
+{
+   double sigma = 0;
+   long totaa = 0;
+
+   each_syn(code, [&](int x) {
+      float wx = w[x] < 0.0001 ? 0.01F : w[x]; /* as cai() */
+      sigma += (double)ncod[x] * std::log((double)wx);
+      totaa += ncod[x];
+   });
+   return totaa ? std::exp(sigma / totaa) : 0;
+}
+
+/* Frequency of OPtimal codons, with fop_cod[65] the class of each codon */
+/* (3 optimal, 2 common, 1 rare, fop_cod of FOP_STRUCT). NaN if a codon  */
+/* of an amino acid with optimal codons has no class                     */
+template <class Code>
+inline double fop(const Code &code, const long *ncod, const char *fop_cod,
+                  bool factor_in_rare = false)
+{
+   const CodeTables &t = tables(code);
+   bool has_opt_info[22] = {false};
+   long nonopt = 0, common = 0, opt = 0, total;
+   bool bad = false;
+
+   each_syn(code, [&](int x) {
+      if (fop_cod[x] == 3 || (factor_in_rare && fop_cod[x] == 1))
+         has_opt_info[t.ca[x]] = true;
+   });
+   each_syn(code, [&](int x) {
+      if (!has_opt_info[t.ca[x]])
+         return;
+      switch (fop_cod[x])
+      {
+      case 3: opt += ncod[x]; break;
+      case 2: common += ncod[x]; break;
+      case 1: nonopt += ncod[x]; break;
+      default: bad = true;
+      }
+   });
+   if (bad)
+      return std::numeric_limits<double>::quiet_NaN();
+
+   total = opt + common + nonopt;
+   if (factor_in_rare && total)
+      return (float)(opt - nonopt) / (float)total;
+   if (!factor_in_rare && total)
+      return (float)opt / (float)total;
+   return 0;
+}
+
+/* Effective Number of Codons. NaN when an amino acid family size class  */
+/* has no amino acid with a homozygosity, as for enc()                   */
+template <class Code>
+inline double enc(const Code &code, const long *ncod, const long *naa)
+{
+   const CodeTables &t = tables(code);
+   double totb[max_family + 1] = {0}, averb = 0;
+   int numaa[max_family + 1] = {0};
+   float enc_tot;
+
+   each_family(code, [&](int i, auto codons) {
+      double bb = 0, s2 = 0;
+
+      if (i == 0 || i == stop_aa)
+         return;
+      if (naa[i] > 1)
+      {
+         codons([&](int x) {
+            if (ncod[x])
+               s2 += std::pow((double)ncod[x] / (double)naa[i], 2.0);
+         });
+         bb = ((double)naa[i] * s2 - 1.0) / (double)(naa[i] - 1.0);
+      }
+      if (bb > 0.0000001)
+      {
+         totb[t.da[i]] += bb;
+         numaa[t.da[i]]++;
+      }
+   });
+
+   enc_tot = (float)t.fold[1];
+   for (int z = 2; z <= max_family; z++)
+   {
+      if (!t.fold[z])
+         continue;
+      if (numaa[z] && totb[z] > 0)
+         averb = totb[z] / numaa[z];
+      else if (z == 3 && numaa[2] && numaa[4] && t.fold[z] == 1)
+         averb = (totb[2] / numaa[2] + totb[4] / numaa[4]) * 0.5;
+      else
+         return std::numeric_limits<double>::quiet_NaN();
+      enc_tot += (float)t.fold[z] / (float)averb;
+      if (enc_tot > 61)
+         enc_tot = 61;
+   }
+   return enc_tot;
+}
+
+struct BaseComposition
+{
+   double gc;   /* G+C of all codons but stops         */
+   double gc3s; /* G+C of the third base of synonymous codons */
+   long l_sym;  /* synonymous codons                   */
+   long l_aa;   /* codons that are not stops           */
+};
+
+/* G+C content, as the GC, GC3s, L_sym and L_aa of bases2()              */
+template <class Code>
+inline BaseComposition gc(const Code &code, const long *ncod)
+{
+   const CodeTables &t = tables(code);
+   long gc = 0, gc3 = 0, l_sym = 0, l_aa = 0;
+
+   each_sense(code, [&](int x) {
+      gc += ncod[x] * t.gcn[x];
+      l_aa += ncod[x];
+   });
+   each_syn(code, [&](int x) {
+      if (t.gc3[x])
+         gc3 += ncod[x];
+      l_sym += ncod[x];
+   });
+   return {(double)gc / (double)(l_aa * 3), (double)gc3 / (double)l_sym, l_sym, l_aa};
+}
+
+/* Relative Synonymous Codon Usage of each codon into rscu[65], 0 for    */
+/* amino acids not used, as rscu_usage()                                 */
+template <class Code>
+inline void rscu(const Code &code, const long *ncod, const long *naa, float *rscu)
+{
+   const CodeTables &t = tables(code);
+
+   rscu[0] = 0;
+   each_codon(code, [&](int x) {
+      rscu[x] = naa[t.ca[x]] ? (float)ncod[x] / (float)naa[t.ca[x]] * (float)t.ds[x] : 0;
+   });
+}
+
+} // namespace codonw
+
+#endif /* CODONW_HPP */
@@ -0,0 +1,130 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+The embeddable interface of the codonW library (libcodonw), for programs
+that count and score sequences in process. A context holds a genetic code
+and the reference values of the indices; it is made once, is read only
+afterwards and may be shared between threads. Results are written into
+caller structs and nothing is printed. Functions return CODONW_OK (0) or
+a negative CODONW_E* error code.
+
+   codonw_options opt;
+   codonw_ctx *ctx;
+   codonw_metrics m;
+
+   codonw_options_default(&opt);
+   if (codonw_create(&opt, &ctx) == CODONW_OK &&
+       codonw_score(ctx, seq, len, NULL, &m) == CODONW_OK)
+      use(m.cai, m.nc, m.gc3s);
+   codonw_destroy(ctx);
+
+************************************************************************/
+
+#ifndef LIBCODONW_H
+#define LIBCODONW_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define CODONW_API __attribute__((visibility("default")))
+#else
+#define CODONW_API
+#endif
+
+#define CODONW_VERSION "1.5.0"
+
+enum
+{
+  CODONW_OK = 0,
+  CODONW_EINVAL = -1,       /* an argument is out of range        */
+  CODONW_ENOMEM = -2        /* memory ran out                     */
+};
+
+typedef struct codonw_ctx codonw_ctx; /* opaque                 */
+
+typedef struct
+{
+  int genetic_code;         /* built in genetic code, 0 to 7      */
+  const char *translation;  /* or, unless NULL, the one letter    */
+                            /* amino acid ('*' for stops) of the  */
+                            /* 64 codons in the NCBI order TTT,   */
+                            /* TTC, TTA, TTG, TCT, ... GGG        */
+  int cai_ref;              /* built in CAI w values, 0 to 2      */
+  const double *cai_w;      /* or, unless NULL, the w values of   */
+                            /* the 64 codons in the same order    */
+  int fop_ref;              /* optimal codons for Fop, 0 to 7     */
+  int cbi_ref;              /*                    CBI, 0 to 7     */
+  int factor_in_rare;       /* Fop = (opt - rare) / total         */
+} codonw_options;
+
+typedef struct
+{
+  long ncod[65];            /* codon counts, codonW order, 0 for  */
+                            /* codons with other bases or partial */
+  long naa[22];             /* amino acid counts, 11 for stops    */
+  long codon_tot;           /* No. of complete codons             */
+  int valid_stops;          /* 1 if the last codon is a stop      */
+} codonw_counts;
+
+typedef struct
+{
+  double cai;               /* codon adaptation index             */
+  double fop;               /* frequency of optimal codons        */
+  double cbi;               /* codon bias index                   */
+  double nc;                /* effective No. of codons, NaN if it */
+                            /* can not be calculated              */
+  double gravy;             /* hydropathicity of the protein      */
+  double aromo;             /* its aromaticity                    */
+  double gc;                /* G+C content                        */
+  double gc3s;              /* G+C at synonymous third positions  */
+  double l_sym;             /* No. of synonymous codons           */
+  double l_aa;              /* No. of amino acids                 */
+  double t3s, c3s, a3s, g3s; /* base at synonymous third positions */
+} codonw_metrics;
+
+/* fills in the universal code and the first reference of each index    */
+CODONW_API void codonw_options_default(codonw_options *opt);
+CODONW_API int codonw_create(const codonw_options *opt, codonw_ctx **ctx);
+CODONW_API void codonw_destroy(codonw_ctx *ctx);
+
+/* counts the codons of len bases of seq (any case, T or U)             */
+CODONW_API int codonw_count(const codonw_ctx *ctx, const char *seq, size_t len, codonw_counts *counts);
+/* calculates every index from counts                                   */
+CODONW_API int codonw_metrics_of(const codonw_ctx *ctx, const codonw_counts *counts, codonw_metrics *metrics);
+/* both of the above, either output may be NULL                         */
+CODONW_API int codonw_score(const codonw_ctx *ctx, const char *seq, size_t len, codonw_counts *counts, codonw_metrics *metrics);
+/* scores seqs[0..n-1] on threads threads into counts[i] and metrics[i] */
+/* (either may be NULL)                                                 */
+CODONW_API int codonw_score_batch(const codonw_ctx *ctx, size_t n, const char *const *seqs, const size_t *lens, codonw_counts *counts, codonw_metrics *metrics, int threads);
+
+CODONW_API const char *codonw_strerror(int err);
+CODONW_API const char *codonw_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCODONW_H */
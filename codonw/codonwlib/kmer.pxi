@@ -0,0 +1,109 @@
+"""
+
+Counts of k-mers by frame of many sequences, generalising `CodonSeq.dinuc`.
+Included into `codonw.pyx`.
+
+"""
+
+kmer_frames = ['counted', 'position']
+
+
+def kmer_names(int k):
+    """The k-mers of `k` bases in the order of the columns of
+    `kmer_counts`, i.e. as `CodonSeq.dinuc` for k = 2
+    """
+    codes = np.arange(1 << (2 * k), dtype=np.uint64)
+    return list(_kmer_strings(codes, k))
+
+
+def _kmer_strings(codes, int k):
+    """Turns k-mers held as 2 bits per base into `str`"""
+    shifts = np.arange(2 * (k - 1), -1, -2, dtype=np.uint64)
+    digits = (codes[:, None] >> shifts[None, :]) & np.uint64(3)
+    chars = np.frombuffer(b"TCAG", dtype=np.uint8)[digits.astype(np.intp)]
+    return np.ascontiguousarray(chars).view('S{}'.format(k)).ravel().astype(str)
+
+
+def kmer_counts(seqs, int k, frame="position", sparse=None, ids=None, int threads=1):
+    """Counts the k-mers of many sequences in each of three frames
+
+    `seqs`: sequences as `str` or `bytes`, or a `pd.Series` of them (whose
+        index is used as `ids`)
+    `k`: bases in each k-mer, 1 to 32
+    `frame`: how the frame of a k-mer is set
+        - position: by the codon position (1, 2, 3) of its first base
+        - counted: by the number of k-mers counted before it, as
+          `CodonSeq.dinuc` does, so that k = 2 gives its counts exactly
+    `sparse`: return only the k-mers each sequence has, by default for
+        k > 6
+    `ids`: identifiers of the sequences, by default their position
+    `threads`: number of threads to count on
+
+    k-mers with a base other than T/U, C, A or G are skipped.
+
+    Returns an N x 3 x 4^k array of counts, frames along the second axis
+    and k-mers along the last as `kmer_names(k)`, or if `sparse` a
+    `pd.DataFrame` with a row per sequence and k-mer it has (columns "id",
+    "kmer" and the counts in frames "1", "2", "3").
+    """
+    if not 1 <= k <= codonwlib.KMER_MAX_K:
+        raise ValueError("k must be between 1 and {}".format(codonwlib.KMER_MAX_K))
+    if frame not in kmer_frames:
+        raise ValueError("frame must be one of {}".format(", ".join(kmer_frames)))
+    if sparse is None:
+        sparse = k > 6
+    if not sparse and k > 8:
+        raise ValueError("Dense counts are limited to k <= 8")
+    cdef int by_count = frame == 'counted'
+
+    if isinstance(seqs, pd.Series):
+        if ids is None:
+            ids = seqs.index
+        seqs = seqs.values
+    data = [s.encode('ascii') if isinstance(s, str) else bytes(s) for s in seqs]
+    cdef long n = len(data)
+    if ids is None:
+        ids = np.arange(n)
+    lens = np.array([len(s) for s in data], dtype=np.longlong)
+    cdef long long[::1] lens_v = lens
+    cdef long long *plens = &lens_v[0] if n else NULL
+    cdef bint is_sparse = sparse
+
+    dense = None if sparse else np.zeros([n, 3, 1 << (2 * k)], dtype=c_long)
+    cdef codonwlib.KMER_COO_STRUCT coo
+    coo.n = 0
+    cdef int ret = 0
+    cdef void *pdense = NULL if sparse else np.PyArray_DATA(dense)
+    cdef const char **ptrs = <const char **>malloc(n * sizeof(char *) + 1)
+    if ptrs == NULL:
+        raise MemoryError()
+    cdef long i
+    try:
+        for i in range(n):
+            ptrs[i] = <bytes>data[i]
+        with nogil:
+            if not is_sparse:
+                ret = codonwlib.kmer_seqs(n, ptrs, plens, k, by_count, <long *>pdense,
+                                          max(threads, 1))
+            else:
+                ret = codonwlib.kmer_seqs_sparse(n, ptrs, plens, k, by_count, &coo,
+                                                 max(threads, 1))
+    finally:
+        free(ptrs)
+    if ret < 0:
+        raise MemoryError()
+    if not sparse:
+        return dense
+
+    try:
+        m = coo.n
+        rows = np.array(<long[:m]>coo.row if m else [], dtype=c_long)
+        codes = np.array(<uint64_t[:m]>coo.kmer if m else [], dtype=np.uint64)
+        frames = np.array(<long[:m, :3]>&coo.count[0][0] if m else np.zeros([0, 3]),
+                          dtype=c_long).reshape(m, 3)
+    finally:
+        codonwlib.kmer_coo_free(&coo)
+
+    return pd.DataFrame({'id': np.asarray(ids, dtype=object)[rows],
+                         'kmer': _kmer_strings(codes, k),
+                         '1': frames[:, 0], '2': frames[:, 1], '3': frames[:, 2]})
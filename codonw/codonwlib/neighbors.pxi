@@ -0,0 +1,153 @@
+"""
+
+Nearest neighbour searches over the codon usage of many sequences.
+Included into `codonw.pyx`.
+
+"""
+
+import json
+
+
+cdef class NeighborIndex:
+    """A vantage point tree over the codon usage (RSCU or codon
+    frequencies) of many sequences, for finding the most similar ones
+
+    Built with `NeighborIndex.build`, saved with `save` and loaded with
+    `NeighborIndex.load`, which maps the file into memory rather than
+    reading it so that large indices open at once and are shared between
+    processes. Searches are exact, or approximate with `eps` > 0 or a
+    `budget` of comparisons.
+    """
+    cdef codonwlib.VPTREE_STRUCT tree
+    cdef readonly object ids
+    cdef readonly object metric
+    cdef readonly object on
+    cdef readonly object genetic_code
+    cdef bytes extra
+
+    def __dealloc__(self):
+        codonwlib.vptree_free(&self.tree)
+
+    def __len__(self):
+        return self.tree.n
+
+    def __repr__(self):
+        return "<NeighborIndex of {} sequences ({} on {})>".format(
+            len(self), self.metric, self.on)
+
+    @staticmethod
+    def build(counts, metric="euclidean", on="rscu", int threads=1):
+        """Builds the index of a `CodonCounts`
+
+        `metric`: "euclidean" or "manhattan" (see `codon_distances`)
+        `on`: "rscu" or "freq", the features compared
+        `threads`: number of threads to build on
+        """
+        if metric not in ("euclidean", "manhattan"):
+            raise ValueError("metric must be 'euclidean' or 'manhattan'")
+        feat, _ = _dist_features(counts, metric, on)
+        cdef NeighborIndex index = NeighborIndex.__new__(NeighborIndex)
+        cdef long n = len(feat)
+        cdef double *pf = _data(feat)
+        cdef codonwlib.DIST_METRIC cmetric = _dist_metric(metric)
+        cdef int ret
+        with nogil:
+            ret = codonwlib.vptree_build(&index.tree, cmetric, n, pf, max(threads, 1))
+        if ret:
+            raise MemoryError()
+        index.tree.rscu = on == "rscu"
+        index._describe(counts.ids, metric, on, counts.genetic_code)
+        return index
+
+    def _describe(self, ids, metric, on, genetic_code):
+        ids = np.asarray(ids)
+        if ids.dtype == object and len(ids) and len({type(i) for i in ids}) == 1:
+            # ids of one type, e.g. from CodonCounts, as an array of it
+            typed = np.array(ids.tolist())
+            if typed.dtype.kind in "biufU" and typed.shape == ids.shape:
+                ids = typed
+        self.ids = ids
+        self.metric, self.on, self.genetic_code = metric, on, genetic_code
+
+    def save(self, filename):
+        """Writes the index to a file, with the ids and genetic code. Ids
+        of one type (e.g. all `int` or all `str`) are kept as they are,
+        ids of mixed types are saved as `str`
+        """
+        code = self.genetic_code
+        if not isinstance(code, int):
+            code = dict(code)
+        ids = self.ids.astype(str) if self.ids.dtype == object else self.ids
+        ids = np.ascontiguousarray(ids)
+        # a line of JSON, then the raw ids read back with np.frombuffer
+        meta = json.dumps({'genetic_code': code, 'ids_dtype': ids.dtype.str})
+        self.extra = meta.encode() + b"\n" + ids.tobytes()
+        self.tree.extra = self.extra
+        self.tree.nextra = len(self.extra)
+        fn = os.fsencode(filename)
+        cdef const char *cfn = fn
+        cdef int ret
+        with nogil:
+            ret = codonwlib.vptree_save(&self.tree, cfn)
+        if ret:
+            raise IOError("Could not write {}".format(filename))
+
+    @staticmethod
+    def load(filename):
+        """Maps an index written by `save`"""
+        cdef NeighborIndex index = NeighborIndex.__new__(NeighborIndex)
+        fn = os.fsencode(filename)
+        cdef const char *cfn = fn
+        cdef int ret
+        with nogil:
+            ret = codonwlib.vptree_load(&index.tree, cfn)
+        if ret == 1:
+            raise IOError("Could not read {}".format(filename))
+        elif ret == 2:
+            raise ValueError("{} is not a codonw neighbour index".format(filename))
+        extra = index.tree.extra[:index.tree.nextra]
+        end = extra.index(b"\n")
+        meta = json.loads(extra[:end].decode())
+        ids = np.frombuffer(extra, dtype=np.dtype(meta['ids_dtype']), offset=end + 1)
+        code = meta['genetic_code']
+        if not isinstance(code, int):
+            code = pd.Series(code)
+        metric = "euclidean" if index.tree.metric == codonwlib.DIST_EUCLIDEAN else "manhattan"
+        index._describe(ids, metric, "rscu" if index.tree.rscu else "freq", code)
+        return index
+
+    def query(self, counts, int k=10, double eps=0, long budget=0, int threads=1):
+        """Finds the `k` nearest indexed sequences to each sequence of a
+        `CodonCounts`
+
+        `eps`: skip parts of the tree that can not hold a sequence closer
+            than the k-th found so far divided by 1 + `eps`; faster, and
+            each neighbour returned is at most 1 + `eps` times further
+            than the true one
+        `budget`: compare each sequence with at most this many indexed
+            ones (0 for no limit), nearer parts of the tree first. Codon
+            usage has many dimensions, in which trees prune poorly, so
+            this bounds the time of a search at the cost of some recall.
+        `threads`: number of threads to search on
+
+        Returns `pd.DataFrame`s of the ids of the neighbours of each
+        sequence (nearest first) and of their distances. Sequences
+        counted with a different genetic code are compared all the same.
+        """
+        if k < 1:
+            raise ValueError("k must be at least 1")
+        feat, _ = _dist_features(counts, self.metric, self.on)
+        cdef long nq = len(feat)
+        nbr = np.zeros([nq, k], dtype=c_long)
+        dist = np.zeros([nq, k], dtype=c_double)
+        cdef double *pf = _data(feat)
+        cdef long *pn = <long *>np.PyArray_DATA(nbr)
+        cdef double *pdist = _data(dist)
+        if nq:
+            with nogil:
+                codonwlib.vptree_query(&self.tree, nq, pf, k, eps, budget, pn, pdist,
+                                       max(threads, 1))
+
+        ids = np.append(self.ids, None)[nbr]  # -1 for fewer than k indexed
+        return (pd.DataFrame(ids, index=counts.ids),
+                pd.DataFrame(dist, index=counts.ids))
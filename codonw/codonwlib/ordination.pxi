@@ -0,0 +1,230 @@
+"""
+
+Correspondence analysis and principal component analysis of the codon
+usage of many sequences, in two passes over their counts. Included into
+`codonw.pyx`.
+
+"""
+
+
+def _count_parts(counts):
+    """Yields the `CodonCounts` of `counts`, a `CodonCounts` or a list of
+    them or of files saved with `CodonCounts.save`, one at a time
+    """
+    if isinstance(counts, CodonCounts):
+        yield counts
+        return
+    for part in counts:
+        yield CodonCounts.load(part) if not isinstance(part, CodonCounts) else part
+
+
+def _coa_columns(genetic_code, codons):
+    """Codons (as columns of `ncod`) an ordination uses: "synonymous" leaves
+    out stops and amino acids of one codon (59 codons in the standard code,
+    as CodonW), "sense" only stops, "all" none
+    """
+    cseq = CodonSeq("", genetic_code=genetic_code)
+    aa = cseq.genetic_code[ref_codons[1:65]].values
+    counts = pd.Series(aa).value_counts()
+    if codons == "synonymous":
+        keep = [a != '*' and counts[a] > 1 for a in aa]
+    elif codons == "sense":
+        keep = [a != '*' for a in aa]
+    elif codons == "all":
+        keep = [True] * 64
+    else:
+        raise ValueError("codons must be 'synonymous', 'sense' or 'all'")
+    return np.flatnonzero(keep).astype(c_int) + 1
+
+
+class Ordination:
+    """Axes of codon usage found by `codon_ca` or `codon_pca`
+
+    `method`: "ca" or "pca" (on "rscu" or "freq")
+    `inertia`: the principal inertia (CA) or variance (PCA) of every axis
+    `explained`: fraction of the total of the first `n_axes` axes
+    `codon_coords`: principal coordinates of the codons (CA) or loadings
+        (PCA) on the first `n_axes` axes
+    `gene_coords`: principal coordinates (CA) or scores (PCA) of each
+        sequence, NaN for those without any of the codons
+    """
+
+    def __init__(self, method, on, columns, genetic_code, inertia, axes, center):
+        self.method, self.on = method, on
+        self.columns = columns
+        self.genetic_code = genetic_code
+        self.inertia = inertia
+        self.axes = axes
+        self.center = center
+        self.n_axes = axes.shape[1]
+        self.gene_coords = None
+
+    def __repr__(self):
+        return "<Ordination ({}) of {} codons on {} axes>".format(
+            self.method, len(self.columns), self.n_axes)
+
+    @property
+    def explained(self):
+        total = self.inertia.sum()
+        return self.inertia[:self.n_axes] / total if total else self.inertia[:self.n_axes] * 0
+
+    @property
+    def codon_coords(self):
+        coords = self.axes
+        if self.method == "ca":
+            coords = self.axes * np.sqrt(self.inertia[:self.n_axes])
+        return pd.DataFrame(coords, index=[ref_codons[c] for c in self.columns],
+                            columns=["Axis{}".format(a + 1) for a in range(self.n_axes)])
+
+    def transform(self, counts, int threads=1):
+        """Places the sequences of `counts` (as for `codon_ca`) on the axes,
+        returning a `pd.DataFrame`
+        """
+        frames = []
+        for part in _count_parts(counts):
+            if not _same_code(part.genetic_code, self.genetic_code):
+                raise ValueError("Counts were made with different genetic codes")
+            frames.append(pd.DataFrame(_coa_pass(part, self, threads),
+                index=part.ids, columns=["Axis{}".format(a + 1) for a in range(self.n_axes)]))
+        return pd.concat(frames) if frames else None
+
+
+cdef codonwlib.COA_METHOD _coa_method(method, on) except *:
+    if method == "ca":
+        return codonwlib.COA_CA
+    elif on == "rscu":
+        return codonwlib.COA_PCA_RSCU
+    elif on == "freq":
+        return codonwlib.COA_PCA_FREQ
+    raise ValueError("on must be 'rscu' or 'freq'")
+
+
+def _coa_pass(part, plan, int threads, sums=None):
+    """Runs `coa_accumulate` over `part` into `sums` (weight, mean, gram)
+    if given, otherwise `coa_project` on the axes of the `Ordination` plan
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(part.genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT cplan
+    codonwlib.code_plan_init(&cplan, &code)
+    cdef codonwlib.COA_METHOD method = _coa_method(plan.method, plan.on)
+
+    ncod = part.ncod
+    if ncod.dtype not in count_dtypes:
+        ncod = ncod.astype(c_long)
+    ncod = np.ascontiguousarray(ncod)
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(ncod.dtype)
+    cdef long n = len(ncod)
+    cdef void *pncod = np.PyArray_DATA(ncod)
+    cols = np.ascontiguousarray(plan.columns, dtype=c_int)
+    cdef int ncol = len(cols)
+    cdef int *pcols = <int *>np.PyArray_DATA(cols)
+    cdef double *pw
+    cdef double *pm
+    cdef double *pg
+    cdef double *pc
+    cdef double *pa
+    cdef double *po
+    cdef int k, ret = 0
+
+    if sums is not None:
+        pw, pm, pg = _data(sums[0]), _data(sums[1]), _data(sums[2])
+        if n:
+            with nogil:
+                ret = codonwlib.coa_accumulate(n, pncod, ctype, &cplan, method, ncol, pcols,
+                                               pw, pm, pg, max(threads, 1))
+        if ret < 0:
+            raise MemoryError()
+        return
+
+    axes = np.ascontiguousarray(plan.axes, dtype=c_double)
+    center = np.ascontiguousarray(plan.center, dtype=c_double)
+    out = np.zeros([n, axes.shape[1]], dtype=c_double)
+    k = axes.shape[1]
+    pc, pa, po = _data(center), _data(axes), _data(out)
+    if n and k:
+        with nogil:
+            codonwlib.coa_project(n, pncod, ctype, &cplan, method, ncol, pcols, pc, pa, k,
+                                  po, max(threads, 1))
+    return out
+
+
+def _ordination(counts, method, on, n_axes, codons, gene_coords, threads):
+    parts = counts if isinstance(counts, CodonCounts) else list(counts)
+
+    # first pass: the ncol x ncol summary of all sequences, whose columns
+    # follow from the genetic code of the first part
+    plan = None
+    for part in _count_parts(parts):
+        if plan is None:
+            code = part.genetic_code
+            cols = _coa_columns(code, codons)
+            ncol = len(cols)
+            plan = Ordination(method, on, cols, code, np.zeros(0), np.zeros([ncol, 0]),
+                              np.zeros(ncol))
+            sums = (np.zeros(1), np.zeros(ncol), np.zeros([ncol, ncol]))
+        elif not _same_code(part.genetic_code, code):
+            raise ValueError("Counts were made with different genetic codes")
+        _coa_pass(part, plan, threads, sums)
+    if plan is None:
+        raise ValueError("Nothing to analyse")
+    weight, mean, gram = sums[0][0], sums[1], sums[2]
+
+    if method == "ca":
+        if not weight:
+            raise ValueError("No codons to analyse")
+        # codons never used have no mass and are left out
+        used = mean > 0
+        cols, mean, gram = cols[used], mean[used], gram[np.ix_(used, used)]
+        mass = mean / weight
+        scale = 1 / np.sqrt(mass)
+        cross = (gram / weight - np.outer(mass, mass)) * np.outer(scale, scale)
+    else:
+        if weight < 2:
+            raise ValueError("At least two sequences are needed")
+        cross = gram / (weight - 1)
+
+    values, vectors = np.linalg.eigh((cross + cross.T) / 2)
+    order = np.argsort(values)[::-1]
+    values, vectors = np.clip(values[order], 0, None), vectors[:, order]
+    # the sign of each axis is that of its largest loading
+    big = np.abs(vectors).argmax(axis=0)
+    vectors = vectors * np.sign(vectors[big, np.arange(len(big))])
+    if method == "ca":
+        values = values[:len(values) - 1]  # the trivial axis of the masses
+        vectors = scale[:, None] * vectors[:, :len(values)]  # standard coordinates
+        mean = np.zeros(len(cols))
+
+    k = min(n_axes, len(values))
+    result = Ordination(method, on, cols, code, values, vectors[:, :k], mean)
+    if gene_coords:
+        result.gene_coords = result.transform(parts, threads)
+    return result
+
+
+def codon_ca(counts, int n_axes=4, codons="synonymous", bool gene_coords=True,
+             int threads=1):
+    """Correspondence analysis of codon usage (the COA of CodonW)
+
+    `counts`: a `CodonCounts`, or a list of them or of files saved with
+        `CodonCounts.save` that are read one at a time (twice), so that
+        data sets larger than memory can be analysed
+    `n_axes`: number of axes to keep
+    `codons`: "synonymous" (no stops or amino acids of one codon, as
+        CodonW), "sense" or "all"
+    `gene_coords`: also place every sequence on the axes (a second pass)
+    `threads`: number of threads
+
+    Everything the analysis needs from the sequences is a codons x codons
+    matrix summed in one pass, so memory does not grow with their number.
+    Returns an `Ordination`.
+    """
+    return _ordination(counts, "ca", None, n_axes, codons, gene_coords, threads)
+
+
+def codon_pca(counts, int n_axes=4, on="rscu", codons="synonymous",
+              bool gene_coords=True, int threads=1):
+    """Principal component analysis of the RSCU (`on`="rscu") or codon
+    frequencies ("freq") of many sequences, see `codon_ca`
+    """
+    _coa_method("pca", on)
+    return _ordination(counts, "pca", on, n_axes, codons, gene_coords, threads)
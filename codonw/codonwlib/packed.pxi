@@ -0,0 +1,160 @@
+"""
+
+Sequences packed at 2 bits per base, with codons, dinucleotides and G+C
+of windows calculated from the packed words. Included into `codonw.pyx`.
+
+"""
+
+cdef long long PACK_CHUNK = 1 << 16  # bases counted and packed at a time
+
+
+cdef class PackedSeq:
+    """A nucleotide sequence held at 2 bits per base, a quarter of the
+    memory of `str` or `bytes`
+
+    Lower case, U and any other characters are kept in lists of runs, so
+    that `str(packed)` gives back the sequence exactly. Usually made as a
+    sequence is counted, by `CodonSeq(seq, pack=True)` or
+    `CodonStream(pack=True)`, but `PackedSeq(seq)` packs one directly.
+    """
+    cdef codonwlib.PACKED_SEQ_STRUCT pk
+
+    def __cinit__(self):
+        codonwlib.packed_init(&self.pk)
+
+    def __init__(self, seq=None):
+        if seq is not None:
+            self.feed(seq)
+
+    def __dealloc__(self):
+        codonwlib.packed_free(&self.pk)
+
+    cdef codonwlib.PACKED_SEQ_STRUCT *_struct(self):
+        return &self.pk
+
+    def feed(self, chunk):
+        """Appends a chunk (`str` or `bytes`) of sequence
+        """
+        if isinstance(chunk, str):
+            chunk = chunk.encode()
+        cdef const char *buf = chunk
+        cdef long long n = len(chunk)
+        cdef int ret
+        with nogil:
+            ret = codonwlib.packed_feed(&self.pk, buf, n)
+        if ret:
+            raise MemoryError()
+
+    def _pack_counting(self, seq, CodonSeq cseq):
+        """Counts `seq` into `cseq` and packs it in the same pass, a block
+        of bases at a time
+        """
+        if isinstance(seq, str):
+            seq = seq.encode()
+        cdef const char *buf = seq
+        cdef long long n = len(seq), i = 0
+        cdef codonwlib.CODON_STREAM_STRUCT state
+        cdef int ret = 0
+
+        codonwlib.codon_stream_init(&state, &cseq.ref_code, False)
+        state.pack = &self.pk
+        with nogil:
+            while i < n and not ret:
+                ret = codonwlib.codon_stream_feed(&state, buf + i, min(PACK_CHUNK, n - i))
+                i += PACK_CHUNK
+        if ret:
+            raise MemoryError()
+        codonwlib.codon_stream_finish(&state)
+
+        cseq.ncod = np.array(state.ncod, dtype=c_long)
+        cseq.naa = np.array(state.naa, dtype=c_long)
+        cseq.codon_tot = state.codon_tot
+        cseq.valid_stops = state.valid_stops
+
+    def __len__(self):
+        return self.pk.len
+
+    def __repr__(self):
+        return "<PackedSeq of {} bases>".format(self.pk.len)
+
+    @property
+    def nbytes(self):
+        """Bytes held, i.e. the packed words and the runs"""
+        return (self.pk.nwords * 8 + (self.pk.nexc + self.pk.nlow + self.pk.nrna) * 16
+                + self.pk.nexc_chars)
+
+    def decode(self, long long start=0, end=None):
+        """The bases `start` to `end` as `str`, as they were packed"""
+        cdef long long stop = self.pk.len if end is None else min(end, self.pk.len)
+        start = max(start, 0)
+        if stop <= start:
+            return ""
+        out = bytearray(stop - start)
+        cdef char *pout = out
+        with nogil:
+            codonwlib.packed_unpack(&self.pk, start, stop, pout)
+        return out.decode('ascii', 'replace')
+
+    def __str__(self):
+        return self.decode()
+
+    def __getitem__(self, s):
+        if not isinstance(s, slice) or s.step not in (None, 1):
+            raise TypeError("PackedSeq only supports slices of consecutive bases")
+        start, stop, _ = s.indices(self.pk.len)
+        return self.decode(start, stop)
+
+    def codon_usage(self, long long start=0, end=None, genetic_code=0):
+        """Counts the codons of bases `start` to `end` from the packed words,
+        returning a `CodonSeq`, the same as `CodonSeq(str(packed)[start:end])`
+        """
+        cdef long long stop = self.pk.len if end is None else min(end, self.pk.len)
+        cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+        start = max(start, 0)
+        ncod = np.zeros([65], dtype=c_long)
+        naa = np.zeros([22], dtype=c_long)
+        cdef long[::1] ncod_v = ncod
+        cdef long[::1] naa_v = naa
+        cdef int icode = 0
+        cdef long long n = max(stop - start, 0)
+        with nogil:
+            icode = codonwlib.packed_tally(&self.pk, start, start + n, &ncod_v[0], &naa_v[0], &code)
+        if n % 3:
+            icode = 0
+            ncod[0] += 1
+        stops = 1 if (n >= 3 and code.ca[icode] == 11) else 0
+        return CodonSeq.from_counts(ncod, naa, n // 3, stops, genetic_code)
+
+    def dinuc(self):
+        """Dinucleotide counts by frame (3 x 16), as `CodonSeq.dinuc` counts
+        them from the unpacked sequence
+        """
+        din = np.zeros([3, 16], dtype=c_long)
+        cdef long[:, ::1] din_v = din
+        with nogil:
+            codonwlib.packed_dinuc(&self.pk, <long (*)[16]>&din_v[0, 0])
+        return din
+
+    def gc_windows(self, long long width, step=None):
+        """G+C content of windows of `width` bases every `step` (default
+        `width`) bases, counted from the packed words
+
+        Returns a `pd.DataFrame` with the `start` and `end` of each window,
+        its No. of `GC` and standard (`valid`) bases and their ratio `GC_frac`.
+        """
+        cdef long long st = width if step is None else step
+        if width < 1 or st < 1:
+            raise ValueError("width and step must be positive")
+        cdef long nwin = 0 if self.pk.len == 0 else (max(self.pk.len - width, 0) + st - 1) // st + 1
+        gc = np.zeros([nwin], dtype=np.longlong)
+        valid = np.zeros([nwin], dtype=np.longlong)
+        cdef long long[::1] gc_v = gc
+        cdef long long[::1] valid_v = valid
+        if nwin:
+            with nogil:
+                codonwlib.packed_windows(&self.pk, width, st, nwin, &gc_v[0], &valid_v[0])
+        start = np.arange(nwin, dtype=np.longlong) * st
+        with np.errstate(invalid='ignore', divide='ignore'):
+            frac = gc / valid
+        return pd.DataFrame({'start': start, 'end': np.minimum(start + width, self.pk.len),
+                             'GC': gc, 'valid': valid, 'GC_frac': frac})
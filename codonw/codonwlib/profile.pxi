@@ -0,0 +1,83 @@
+"""
+
+Codon usage by position along the gene, summed over many sequences.
+Included into `codonw.pyx`.
+
+"""
+
+profile_modes = ['start', 'end', 'relative']
+
+
+def codon_profile(seqs, mode="start", long bins=30, long width=1, genetic_code=0,
+                  int threads=1, bool genes=False):
+    """Sums the codon usage of many sequences by codon position, returning
+    a `CodonCounts` with one row per bin
+
+    `seqs`: sequences as `str` or `bytes`, or a `pd.Series` of them
+    `mode`: how codons are binned
+        - start: codon i (0 for the first) into bin i // `width`
+        - end: as start, but codons counted back from the last (0 for the
+          last complete codon, usually the stop)
+        - relative: `bins` bins of equal fractions of each sequence
+    `bins`: number of bins. Codons beyond the last bin are left out.
+    `width`: codons in each bin, for start and end
+    `genetic_code`: as for `CodonSeq`
+    `threads`: number of threads to count on
+    `genes`: also return the number of sequences with a codon in each bin
+        (a `pd.Series`), e.g. to tell where few long genes remain
+
+    Sequences are read once, each thread summing its own table of bins.
+    The ids of the rows are the first codon of each bin (start and end) or
+    the fraction of the sequence where it starts (relative). Indices of
+    each bin are calculated from its summed codons as for a single
+    sequence, e.g. the CAI and GC3s ramp from the start codon:
+
+        codon_profile(seqs, bins=50, width=10).indices(['CAI', 'GC3s'])
+    """
+    if mode not in profile_modes:
+        raise ValueError("mode must be one of {}".format(", ".join(profile_modes)))
+    if bins < 1 or width < 1:
+        raise ValueError("bins and width must be positive")
+    cdef codonwlib.PROFILE_MODE cmode = [codonwlib.PROFILE_START, codonwlib.PROFILE_END,
+                                         codonwlib.PROFILE_RELATIVE][profile_modes.index(mode)]
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+
+    if isinstance(seqs, pd.Series):
+        seqs = seqs.values
+    data = [s.encode('ascii') if isinstance(s, str) else bytes(s) for s in seqs]
+    cdef long n = len(data)
+    lens = np.array([len(s) for s in data], dtype=np.longlong)
+    cdef long long[::1] lens_v = lens
+    cdef long long *plens = &lens_v[0] if n else NULL
+
+    ncod = np.zeros([bins, 65], dtype=c_long)
+    naa = np.zeros([bins, 22], dtype=c_long)
+    ngenes = np.zeros([bins], dtype=c_long)
+    cdef long[:, ::1] ncod_v = ncod
+    cdef long[:, ::1] naa_v = naa
+    cdef long[::1] genes_v = ngenes
+    cdef int ret
+    cdef const char **ptrs = <const char **>malloc(n * sizeof(char *) + 1)
+    if ptrs == NULL:
+        raise MemoryError()
+    cdef long i
+    try:
+        for i in range(n):
+            ptrs[i] = <bytes>data[i]
+        with nogil:
+            ret = codonwlib.codon_profile(n, ptrs, plens, &code, cmode, bins, width,
+                                          <long (*)[65]>&ncod_v[0, 0], <long (*)[22]>&naa_v[0, 0],
+                                          &genes_v[0], max(threads, 1))
+    finally:
+        free(ptrs)
+    if ret < 0:
+        raise MemoryError()
+
+    if mode == 'relative':
+        ids = np.arange(bins) / bins
+    else:
+        ids = np.arange(bins) * width
+    counts = CodonCounts(ids, ncod, naa, genetic_code=genetic_code)
+    if genes:
+        return counts, pd.Series(ngenes, index=counts.ids)
+    return counts
@@ -0,0 +1,95 @@
+"""
+
+Properties of the translated gene products of many sequences, calculated
+from their amino acid counts. Included into `codonw.pyx`.
+
+"""
+
+protein_names = ['MW', 'pI', 'Charge', 'Aliphatic', 'Extinction', 'Gravy', 'Aromo']
+
+
+def protein_properties(counts, properties=None, scales=None, double ph=7.0,
+                       int threads=1):
+    """Composition based properties of the hypothetical translated product
+    of every sequence of a `CodonCounts` (or of a `CodonSeq`), calculated
+    from the amino acid counts without translating
+
+    `properties`: names from `protein_names` and of `scales` (default all)
+        - MW: average molecular weight (Da)
+        - pI: isoelectric point
+        - Charge: net charge at `ph`
+        - Aliphatic: aliphatic index (Ikai 1980)
+        - Extinction: molar extinction coefficient at 280 nm, assuming
+          reduced cysteines
+        - Gravy, Aromo: as `CodonSeq.hydropathy` and `CodonSeq.aromaticity`
+    `scales`: further per amino acid scales, as a dict of name to a
+        `pd.Series` (or dict) of a value per one letter amino acid, each
+        averaged over the residues
+    `ph`: pH of Charge
+    `threads`: number of threads
+
+    Masses and pK values are those of ExPASy ProtParam (and
+    `Bio.SeqUtils.ProtParam`). Stop codons are not residues, and as the
+    terminal residues are not known the pK of the termini are those of
+    the default. Properties of sequences without residues are NaN.
+
+    Returns a `pd.DataFrame` with a column per property, or a `pd.Series`
+    for a `CodonSeq`.
+    """
+    scales = dict(scales or {})
+    clash = [k for k in scales if k in protein_names]
+    if clash:
+        raise ValueError("Scales can not be named {}".format(", ".join(clash)))
+    if properties is None:
+        properties = protein_names + list(scales)
+    properties = list(properties)
+    unknown = [p for p in properties if p not in protein_names and p not in scales]
+    if unknown:
+        raise ValueError("Unknown properties: {}".format(", ".join(map(str, unknown))))
+
+    names = list(scales)
+    table = np.zeros([max(len(names), 1), 22], dtype=c_double)
+    residues = [a for a in ref_aa1 if a not in ('X', '*')]
+    for k, name in enumerate(names):
+        scale = pd.Series(scales[name], dtype=c_double)
+        missing = [a for a in residues if a not in scale.index]
+        if missing:
+            raise ValueError("Scale {} lacks {}".format(name, ", ".join(missing)))
+        table[k] = [scale[a] if a in residues else 0.0 for a in ref_aa1]
+    which = np.array([protein_names.index(p) if p in protein_names
+                      else codonwlib.NUM_PROT + names.index(p)
+                      for p in properties], dtype=c_int)
+
+    if isinstance(counts, CodonSeq):
+        naa = np.asarray(counts.naa, dtype=c_long).reshape(1, 22)
+    else:
+        naa = counts.naa
+        if naa.dtype not in count_dtypes:
+            naa = naa.astype(c_long)
+    naa = np.ascontiguousarray(naa)
+    result = np.empty([len(naa), len(properties)], dtype=c_double)
+    if len(naa) and len(properties):
+        _protein_into(naa, which, table, ph, result, threads)
+
+    if isinstance(counts, CodonSeq):
+        return pd.Series(result[0], index=properties)
+    return pd.DataFrame(result, index=counts.ids, columns=properties)
+
+
+cdef _protein_into(np.ndarray naa, int[::1] which, double[:, ::1] table, double ph,
+                   double[:, ::1] result, int threads):
+    """Runs `protein_props` over all rows
+    """
+    cdef codonwlib.PROTEIN_PLAN_STRUCT pp
+    cdef long n = naa.shape[0]
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(naa.dtype)
+    cdef void *paa = np.PyArray_DATA(naa)
+
+    pp.ppp = &codonwlib.protein_prop
+    pp.pap = &codonwlib.amino_prop
+    pp.ph = ph
+    pp.nscale = table.shape[0]
+    pp.scale = &table[0, 0]
+    with nogil:
+        codonwlib.protein_props(n, paa, ctype, &pp, &which[0], which.shape[0],
+                                &result[0, 0], result.shape[1], max(threads, 1))
@@ -0,0 +1,93 @@
+"""
+
+Codon usage of many ranges of one long sequence. Included into `codonw.pyx`.
+
+"""
+
+cdef class CodonIndex:
+    """Index of a long sequence (e.g. a chromosome) that gives the codon
+    usage of any range of it, for annotations with thousands of exons or
+    domains, without slicing and counting each range
+
+    The code of the codon at every base is kept (1 byte per base) along
+    with the cumulative codon usage of each reading frame every `step`
+    codons. Each range is then two checkpoints and fewer than `2 * step`
+    codons. Smaller steps answer faster and take more memory
+    (`3 * 65 * 8 / step` bytes per codon).
+    """
+    cdef codonwlib.CODON_INDEX_STRUCT index
+    cdef codonwlib.GENETIC_CODE_STRUCT ref_code
+    cdef object code_arg
+
+    def __init__(self, seq, int step=64, genetic_code=0):
+        """`seq`: the sequence (`str` or `bytes`)
+        `step`: codons between checkpoints
+        `genetic_code`: as for `CodonSeq`
+        """
+        self.ref_code = _resolve_code(genetic_code)
+        self.code_arg = genetic_code
+        if isinstance(seq, str):
+            seq = seq.encode()
+
+        cdef const char *buf = seq
+        cdef long long n = len(seq)
+        cdef int ret
+        with nogil:
+            ret = codonwlib.codon_index_build(&self.index, buf, n, step)
+        if ret:
+            raise MemoryError()
+
+    def __dealloc__(self):
+        codonwlib.codon_index_free(&self.index)
+
+    def __len__(self):
+        return self.index.len
+
+    @property
+    def step(self):
+        return self.index.step
+
+    def counts(self, ranges, ids=None, int threads=1):
+        """Codon and amino acid usage of each range as a `CodonCounts`, the
+        same as counting `seq[start:end]` with `CodonSeq`
+
+        `ranges`: N x 2 (start, end) base positions, 0 based and end
+            exclusive. The reading frame of each range starts at `start`.
+        `ids`: identifiers of the ranges, by default their position
+        """
+        ranges = np.asarray(ranges, dtype=np.longlong).reshape([-1, 2])
+        starts = np.ascontiguousarray(ranges[:, 0])
+        ends = np.ascontiguousarray(ranges[:, 1])
+        cdef long n = len(ranges)
+        if ids is None:
+            ids = np.arange(n)
+
+        ncod = np.zeros([n, 65], dtype=c_long)
+        naa = np.zeros([n, 22], dtype=c_long)
+        codon_tot = np.zeros([n], dtype=c_long)
+        valid_stops = np.zeros([n], dtype=c_int)
+        cdef long long[::1] starts_v = starts
+        cdef long long[::1] ends_v = ends
+        cdef long[:, ::1] ncod_v = ncod
+        cdef long[:, ::1] naa_v = naa
+        cdef long[::1] tot_v = codon_tot
+        cdef int[::1] stops_v = valid_stops
+        cdef int nbad = 0
+
+        if n:
+            with nogil:
+                nbad = codonwlib.codon_index_ranges(&self.index, n, &starts_v[0], &ends_v[0],
+                    &self.ref_code, <long (*)[65]>&ncod_v[0, 0], <long (*)[22]>&naa_v[0, 0],
+                    &tot_v[0], &stops_v[0], max(threads, 1))
+        if nbad < 0:
+            raise MemoryError()
+        elif nbad:
+            raise ValueError("{} ranges are not within the sequence".format(nbad))
+
+        return CodonCounts(ids, ncod, naa, codon_tot, valid_stops, self.code_arg)
+
+    def indices(self, ranges, indices=None, ids=None, int threads=1, **kwargs):
+        """Indices of each range as a `pd.DataFrame`, see `compute_indices`
+        """
+        return compute_indices(self.counts(ranges, ids, threads), indices,
+                               threads=threads, **kwargs)
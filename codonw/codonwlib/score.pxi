@@ -0,0 +1,130 @@
+"""
+
+CAI and Fop of many sequences against many references at once. Included
+into `codonw.pyx`.
+
+"""
+
+
+def _reference_matrix(refs, builtin, dtype):
+    """Turns `refs` into R x 65 values (column 0 unused) ordered as
+    `ref_codons` and their names. `builtin(i)` gives the 65 values of a
+    built-in reference.
+    """
+    if isinstance(refs, pd.DataFrame):
+        cols = [str(c).upper().replace('T', 'U') for c in refs.columns]
+        frame = pd.DataFrame(refs.values, index=refs.index, columns=cols)
+        missing = [c for c in ref_codons[1:65] if c not in cols]
+        if missing:
+            raise ValueError("References lack codons {}".format(", ".join(missing)))
+        values = frame[ref_codons[1:65]].values
+        names = list(refs.index)
+    elif np.ndim(refs) == 1:
+        values = np.array([builtin(int(i))[1:65] for i in refs])
+        names = list(refs)
+    else:
+        values = np.asarray(refs)
+        names = list(range(len(values)))
+    if values.ndim != 2 or values.shape[1] != 64:
+        raise ValueError("References must be R x 64, one column per codon")
+
+    out = np.zeros([len(values), 65], dtype=dtype)
+    out[:, 1:] = values
+    return out, names
+
+
+def score_references(counts, refs, index="CAI", bool factor_in_rare=False,
+                     top=None, int threads=1):
+    """Scores every sequence of a `CodonCounts` against many references
+    of CAI or Fop, e.g. the codon usage of many candidate hosts
+
+    `refs`: for CAI, w values and for Fop, optimal codon classes (3
+        optimal, 2 common, 1 rare), as a `pd.DataFrame` with a column per
+        codon and a row per reference, an R x 64 array ordered as
+        `ref_codons[1:65]`, or a list of built-in references (as `cai_ref`
+        or `fop_ref` of `CodonSeq`)
+    `index`: "CAI" or "Fop"
+    `factor_in_rare`: as for `CodonSeq.fop`
+    `top`: keep only the best `top` references of each sequence instead of
+        the full N x R matrix
+    `threads`: number of threads to score on
+
+    Each reference is reduced once to a weight per codon and blocks of
+    sequences are scored against blocks of references, which gives the
+    same values as `CodonSeq.cai` and `CodonSeq.fop` (Fop in double
+    precision).
+
+    Returns an N x R `pd.DataFrame`, or if `top` is given, N x `top`
+    `pd.DataFrame`s of the best references (best first) and their scores.
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(counts.genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT plan
+    cdef codonwlib.SCORE_PLAN_STRUCT sp
+    codonwlib.code_plan_init(&plan, &code)
+
+    cdef int ret
+    if index == "CAI":
+        def builtin(i):
+            if not 0 <= i < codonwlib.NUM_CAI_SPECIES:
+                raise ValueError("cai_ref must be between 0 and {}".format(codonwlib.NUM_CAI_SPECIES - 1))
+            return [codonwlib.cai_ref[i].cai_val[x] for x in range(65)]
+        w, names = _reference_matrix(refs, builtin, c_double)
+        ret = codonwlib.score_plan_cai(&sp, &plan, len(w), <double *>np.PyArray_DATA(w))
+    elif index == "Fop":
+        def builtin(i):
+            if not 0 <= i < codonwlib.NUM_FOP_SPECIES:
+                raise ValueError("fop_ref must be between 0 and {}".format(codonwlib.NUM_FOP_SPECIES - 1))
+            return [codonwlib.fop_ref[i].fop_cod[x] for x in range(65)]
+        w, names = _reference_matrix(refs, builtin, np.int8)
+        if np.ndim(refs) != 1 and not np.isin(w[:, 1:], [1, 2, 3]).all():
+            raise ValueError("Optimal codon classes must be 1, 2 or 3")
+        ret = codonwlib.score_plan_fop(&sp, &plan, len(w), <char *>np.PyArray_DATA(w),
+                                       factor_in_rare)
+    else:
+        raise ValueError("index must be 'CAI' or 'Fop'")
+    if ret == 1:
+        raise MemoryError()
+    elif ret == 2:
+        raise ValueError("Optimal codon classes must be 1, 2 or 3")
+
+    ncod = counts.ncod
+    if ncod.dtype not in count_dtypes:
+        ncod = ncod.astype(c_long)
+    ncod = np.ascontiguousarray(ncod)
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(ncod.dtype)
+    cdef long n = len(ncod)
+    cdef long nref = len(names)
+    cdef void *pncod = np.PyArray_DATA(ncod)
+    cdef np.ndarray result
+    cdef np.ndarray best
+    cdef int k
+
+    try:
+        if top is None:
+            result = np.zeros([n, nref], dtype=c_double)
+            if n and nref:
+                with nogil:
+                    ret = codonwlib.score_matrix(n, pncod, ctype, &sp,
+                                                 <double *>np.PyArray_DATA(result), nref,
+                                                 max(threads, 1))
+        else:
+            k = min(int(top), nref)
+            if k < 1:
+                raise ValueError("top must be at least 1")
+            best = np.zeros([n, k], dtype=c_long)
+            result = np.zeros([n, k], dtype=c_double)
+            if n:
+                with nogil:
+                    ret = codonwlib.score_topk(n, pncod, ctype, &sp, k,
+                                               <long *>np.PyArray_DATA(best),
+                                               <double *>np.PyArray_DATA(result),
+                                               max(threads, 1))
+    finally:
+        codonwlib.score_plan_free(&sp)
+    if ret < 0:
+        raise MemoryError()
+
+    if top is None:
+        return pd.DataFrame(result, index=counts.ids, columns=names)
+    return (pd.DataFrame(np.asarray(names, dtype=object)[best], index=counts.ids),
+            pd.DataFrame(result, index=counts.ids))
@@ -36,6 +36,7 @@ genetic code or across the calculation of various codon indicies.
 
 #include "../include/codonW.h"
 
+#ifndef CODONW_NO_STDIO
 /********************* Initilize Pointers**********************************/
 /* Various pointers to structures are assigned here dependent on the      */
 /* genetic code chosen.                                                   */
@@ -70,6 +71,7 @@ int initialize_point(char code, char fop_species, char cai_species, MENU_STRUCT
 
    return 0;
 }
+#endif
 
 /*******************How Synonymous is this codon  *************************/
 /* Calculate how synonymous a codon is by comparing with all other codons */
@@ -106,6 +108,20 @@ int how_synon_aa(int dda[], GENETIC_CODE_STRUCT *pcu)
    return 0;
 }
 
+/*******************Code plan                    *************************/
+/* Bundles a genetic code with its synonymous codon and amino acid family */
+/* sizes, so these are worked out once rather than for every sequence     */
+/**************************************************************************/
+int code_plan_init(CODE_PLAN_STRUCT *pp, GENETIC_CODE_STRUCT *pcu)
+{
+   pp->pcu = pcu;
+   how_synon(pp->ds, pcu);
+   how_synon_aa(pp->da, pcu);
+   pp->da[22] = 0;
+
+   return 0;
+}
+
 /****************** Codon Usage Counting      *****************************/
 /* Counts the frequency of usage of each codon and amino acid this data   */
 /* is used throughout CodonW                                              */
@@ -114,18 +130,13 @@ int how_synon_aa(int dda[], GENETIC_CODE_STRUCT *pcu)
 /**************************************************************************/
 int codon_usage_tot(char *seq, long *codon_tot, int *valid_stops, long ncod[], long naa[], GENETIC_CODE_STRUCT *pcu)
 {
-   char codon[4];
-   int icode;
-   unsigned int i;
-   unsigned int seqlen = (int)strlen(seq);
+   int icode = 0;
+   size_t seqlen = strlen(seq);
 
-   for (i = 0; i < seqlen - 2; i += 3)
+   if (seqlen >= 3)
    {
-      strncpy(codon, (seq + i), 3);
-      icode = ident_codon(codon);
-      ncod[icode]++;             /*increment the codon count */
-      naa[pcu->ca[icode]]++; /*increment the AA count    */
-      (*codon_tot)++;
+      icode = tally_codons(seq, seqlen / 3, ncod, naa, pcu, NULL);
+      *codon_tot += seqlen / 3;
    }
 
    if (seqlen % 3)
@@ -140,6 +151,62 @@ int codon_usage_tot(char *seq, long *codon_tot, int *valid_stops, long ncod[], l
    return icode;
 }
 
+/****************** Tally codons              *****************************/
+/* Adds the n complete codons of seq to ncod and naa and returns the code */
+/* of the last one. Codons are identified a block at a time (see          */
+/* codon_codes) and amino acids are counted from the codon totals. Unless */
+/* prot is NULL the one letter code (amino_acids.aa1) of each codon is    */
+/* also written to prot[0..n-1], from the same codes                      */
+/**************************************************************************/
+#define COUNT_BLOCK 4096
+
+int tally_codons(const char *seq, long long n, long ncod[], long naa[], GENETIC_CODE_STRUCT *pcu, char *prot)
+{
+   unsigned char codes[COUNT_BLOCK];
+   char aa1[65];
+   long block[65];
+   long long i;
+   long k, m;
+   int x, icode = 0;
+
+   if (prot)
+      for (x = 0; x < 65; x++)
+         aa1[x] = amino_acids.aa1[pcu->ca[x]][0];
+
+   for (i = 0; i < n; i += m)
+   {
+      m = (long)(n - i < COUNT_BLOCK ? n - i : COUNT_BLOCK);
+      codon_codes(seq + 3 * i, m, codes);
+
+      memset(block, 0, sizeof(block));
+      for (k = 0; k < m; k++)
+         block[codes[k]]++;
+      icode = codes[m - 1];
+      if (prot)
+         for (k = 0; k < m; k++)
+            prot[i + k] = aa1[codes[k]];
+
+      for (x = 0; x < 65; x++)
+      {
+         ncod[x] += block[x];            /*increment the codon count */
+         naa[pcu->ca[x]] += block[x];    /*increment the AA count    */
+      }
+   }
+
+   return icode;
+}
+
+/****************** Base codes                *****************************/
+/* Maps a character onto the numerical base used by ident_codon, i.e.     */
+/* T/U=1, C=2, A=3, G=4. Any other character is mapped to 0               */
+/**************************************************************************/
+const unsigned char base_code[256] = {
+   ['T'] = 1, ['t'] = 1, ['U'] = 1, ['u'] = 1,
+   ['C'] = 2, ['c'] = 2,
+   ['A'] = 3, ['a'] = 3,
+   ['G'] = 4, ['g'] = 4
+};
+
 /****************** Ident codon               *****************************/
 /* Converts each codon into a numerical array (codon) and converts this   */
 /* array into a numerical value in the range 0-64, zero is reserved for   */
@@ -0,0 +1,398 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains functions that count many sequences or calculate
+indices for many rows of counts at once, i.e. count matrices with one
+row per sequence. Rows are split between threads, and results are
+written straight into caller provided arrays. Count matrices may hold
+narrow (uint16 or uint32) counts to save memory; each row is widened to
+long before anything is summed.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+/******************  Parallel rows          *******************************/
+/* Calls fn on contiguous ranges of the rows 0..n-1 using up to threads   */
+/* threads. fn must only write to the rows it is given                    */
+/**************************************************************************/
+typedef struct
+{
+   long lo;
+   long hi;
+   ROWS_FUNC fn;
+   void *ctx;
+   char started;
+} ROWS_JOB;
+
+static void *rows_worker(void *arg)
+{
+   ROWS_JOB *pj = arg;
+   pj->fn(pj->lo, pj->hi, pj->ctx);
+   return NULL;
+}
+
+int parallel_rows(long n, int threads, ROWS_FUNC fn, void *ctx)
+{
+   int t;
+
+   if (threads > n)
+      threads = (int)n;
+   if (threads <= 1)
+   {
+      if (n > 0)
+         fn(0, n, ctx);
+      return 0;
+   }
+
+   ROWS_JOB *jobs = malloc(threads * sizeof(ROWS_JOB));
+   pthread_t *tids = malloc(threads * sizeof(pthread_t));
+   if (!jobs || !tids)
+   { /* run on this thread alone          */
+      free(jobs);
+      free(tids);
+      fn(0, n, ctx);
+      return 0;
+   }
+
+   for (t = 0; t < threads; t++)
+   {
+      jobs[t].lo = n * t / threads;
+      jobs[t].hi = n * (t + 1) / threads;
+      jobs[t].fn = fn;
+      jobs[t].ctx = ctx;
+      jobs[t].started = t && !pthread_create(&tids[t], NULL, rows_worker, &jobs[t]);
+   }
+   for (t = 0; t < threads; t++) /* this thread takes the first range */
+      if (!jobs[t].started)      /* and any that did not get a thread */
+         rows_worker(&jobs[t]);
+   for (t = 1; t < threads; t++)
+      if (jobs[t].started)
+         pthread_join(tids[t], NULL);
+
+   free(jobs);
+   free(tids);
+   return 0;
+}
+
+/******************  Count rows             *******************************/
+/* Reads row i of a count matrix of ncols columns into longs, or writes   */
+/* it from longs. Callers make sure that the counts fit the element type  */
+/**************************************************************************/
+void count_row_get(const void *m, COUNT_TYPE type, int ncols, long i, long *row)
+{
+   static const size_t size[] = {sizeof(long), sizeof(uint32_t), sizeof(uint16_t)};
+
+   widen_counts((const char *)m + i * ncols * size[type], type, ncols, row);
+}
+
+void count_row_set(void *m, COUNT_TYPE type, int ncols, long i, const long *row)
+{
+   int x;
+
+   switch (type)
+   {
+   case COUNT_U16:
+      for (x = 0; x < ncols; x++)
+         ((uint16_t *)m)[i * ncols + x] = (uint16_t)row[x];
+      break;
+   case COUNT_U32:
+      for (x = 0; x < ncols; x++)
+         ((uint32_t *)m)[i * ncols + x] = (uint32_t)row[x];
+      break;
+   default:
+      memcpy((long *)m + i * ncols, row, ncols * sizeof(long));
+      break;
+   }
+}
+
+/******************  Count sequences        *******************************/
+/* Counts n sequences given as pointers and lengths into count matrices   */
+/* of the given element type. Each sequence is also hashed into digest   */
+/* unless it is NULL, and translated (one char per complete codon) into  */
+/* prot + prot_off[i] unless prot is NULL                                 */
+/**************************************************************************/
+typedef struct
+{
+   const char **seqs;
+   const long long *lens;
+   GENETIC_CODE_STRUCT *pcu;
+   void *ncod;
+   void *naa;
+   COUNT_TYPE type;
+   long *codon_tot;
+   int *valid_stops;
+   uint64_t (*digest)[2];
+   char *prot;
+   const long long *prot_off;
+} COUNT_JOB;
+
+static void count_rows(long lo, long hi, void *ctx)
+{
+   COUNT_JOB *pj = ctx;
+   CODON_STREAM_STRUCT stream;
+   long i;
+
+   for (i = lo; i < hi; i++)
+   {
+      codon_stream_init(&stream, pj->pcu, false);
+      stream.hash = pj->digest != NULL;
+      if (pj->prot)
+         stream.prot = pj->prot + pj->prot_off[i];
+      codon_stream_feed(&stream, pj->seqs[i], pj->lens[i]);
+      codon_stream_finish(&stream);
+
+      count_row_set(pj->ncod, pj->type, 65, i, stream.ncod);
+      count_row_set(pj->naa, pj->type, 22, i, stream.naa);
+      pj->codon_tot[i] = stream.codon_tot;
+      pj->valid_stops[i] = stream.valid_stops;
+      if (pj->digest)
+         memcpy(pj->digest[i], stream.digest, sizeof(uint64_t[2]));
+   }
+}
+
+int count_seqs(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, void *ncod, void *naa, COUNT_TYPE type, long *codon_tot, int *valid_stops, uint64_t (*digest)[2], char *prot, const long long *prot_off, int threads)
+{
+   COUNT_JOB job = {seqs, lens, pcu, ncod, naa, type, codon_tot, valid_stops, digest, prot, prot_off};
+   return parallel_rows(n, threads, count_rows, &job);
+}
+
+/******************  Index plan             *******************************/
+/* Collects the reference values used by batch_indices. The CAI w values */
+/* are copied and near zero values raised to 0.01 up front (as cai does) */
+/* so that threads only ever read them                                    */
+/**************************************************************************/
+int index_plan_init(INDEX_PLAN_STRUCT *pi, CODE_PLAN_STRUCT *plan, CAI_STRUCT *pcai, FOP_STRUCT *pfop, FOP_STRUCT *pcbi, AMINO_PROP_STRUCT *pap, bool factor_in_rare)
+{
+   int x;
+
+   pi->plan = plan;
+   pi->cai = *pcai;
+   pi->pfop = pfop;
+   pi->pcbi = pcbi;
+   pi->pap = pap;
+   pi->factor_in_rare = factor_in_rare;
+
+   for (x = 1; x < 65; x++)
+      if (pi->cai.cai_val[x] < 0.0001)
+         pi->cai.cai_val[x] = 0.01F;
+
+   return 0;
+}
+
+/******************  Batch indices          *******************************/
+/* Calculates the indices listed in which (INDEX_* values) for each row   */
+/* of the count matrices. Row i of the results is written to              */
+/* out + i * out_stride. Nc is NaN where it can not be calculated         */
+/**************************************************************************/
+typedef struct
+{
+   const void *ncod;
+   const void *naa;
+   COUNT_TYPE type;
+   const int *which;
+   int nwhich;
+   double *out;
+   long out_stride;
+   INDEX_PLAN_STRUCT *pi;
+   long row0; /* row written to out                 */
+} INDEX_JOB;
+
+static void index_rows(long lo, long hi, void *ctx)
+{
+   INDEX_JOB *pj = ctx;
+   INDEX_PLAN_STRUCT *pi = pj->pi;
+   CODE_PLAN_STRUCT *plan = pi->plan;
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+
+   long nc[65], na[23];
+   long bases[5], base_tot[5], base_1[5], base_2[5], base_3[5];
+   long tot_s, totalaa;
+   double gc_metrics[18], base_sil[4];
+   double sigma;
+   float val;
+   bool have_gc, have_sil;
+   long i;
+   int k;
+
+   for (i = lo; i < hi; i++)
+   {
+      double *out = pj->out + (i - pj->row0) * pj->out_stride;
+
+      count_row_get(pj->ncod, pj->type, 65, i, nc);
+      count_row_get(pj->naa, pj->type, 22, i, na);
+      na[22] = 0;
+      have_gc = have_sil = false;
+
+      for (k = 0; k < pj->nwhich; k++)
+      {
+         switch (pj->which[k])
+         {
+         case INDEX_CAI:
+            cai(nc, &sigma, plan->ds, &pi->cai, pcu);
+            out[k] = sigma;
+            break;
+         case INDEX_FOP:
+            if (fop(nc, &val, plan->ds, pi->factor_in_rare, pcu, pi->pfop))
+               out[k] = NAN;
+            else
+               out[k] = val;
+            break;
+         case INDEX_CBI:
+            if (cbi(nc, na, &val, plan->ds, plan->da, pcu, pi->pcbi))
+               out[k] = NAN;
+            else
+               out[k] = val;
+            break;
+         case INDEX_ENC:
+            if (enc(nc, na, &val, plan->da, pcu))
+               out[k] = NAN;
+            else
+               out[k] = val;
+            break;
+         case INDEX_GRAVY:
+            hydro(na, &val, pi->pap->hydro);
+            out[k] = val;
+            break;
+         case INDEX_AROMO:
+            aromo(na, &val, pi->pap->aromo);
+            out[k] = val;
+            break;
+         case INDEX_GC:
+         case INDEX_GC3S:
+         case INDEX_L_SYM:
+         case INDEX_L_AA:
+            if (!have_gc)
+            {
+               gc(plan->ds, nc, bases, base_tot, base_1, base_2, base_3,
+                  &tot_s, &totalaa, gc_metrics, pcu);
+               have_gc = true;
+            }
+            if (pj->which[k] == INDEX_GC)
+               out[k] = gc_metrics[0];
+            else if (pj->which[k] == INDEX_GC3S)
+               out[k] = gc_metrics[1];
+            else if (pj->which[k] == INDEX_L_SYM)
+               out[k] = (double)tot_s;
+            else
+               out[k] = (double)totalaa;
+            break;
+         case INDEX_T3S:
+         case INDEX_C3S:
+         case INDEX_A3S:
+         case INDEX_G3S:
+            if (!have_sil)
+            {
+               base_sil_us(nc, na, base_sil, plan->ds, plan->da, pcu);
+               have_sil = true;
+            }
+            out[k] = base_sil[pj->which[k] - INDEX_T3S];
+            break;
+         default:
+            out[k] = NAN;
+            break;
+         }
+      }
+   }
+}
+
+int batch_indices(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, double *out, long out_stride, INDEX_PLAN_STRUCT *pi, int threads)
+{
+   INDEX_JOB job = {ncod, naa, type, which, nwhich, out, out_stride, pi, 0};
+   return parallel_rows(n, threads, index_rows, &job);
+}
+
+/******************  Batch summary          *******************************/
+/* Calculates indices as batch_indices does, but folds each row into the  */
+/* summary of its group (all group 0 if group is NULL) instead of keeping */
+/* it. Each thread calculates a block of rows at a time and folds it into */
+/* ps under the lock, so memory is that of ps and one block per thread.   */
+/* Returns -1 if memory ran out                                           */
+/**************************************************************************/
+#define SUMMARY_BLOCK 256 /* rows calculated at a time           */
+
+typedef struct
+{
+   INDEX_JOB ix;
+   const long *group;
+   SUMMARY_STRUCT *ps;
+   pthread_mutex_t lock;
+   int failed;
+} SUMMARY_JOB;
+
+static void summary_rows(long lo, long hi, void *ctx)
+{
+   SUMMARY_JOB *pj = ctx;
+   INDEX_JOB ix = pj->ix;
+   long i, r, m;
+
+   double *buf = malloc(SUMMARY_BLOCK * ix.nwhich * sizeof(double));
+   if (!buf)
+   {
+      pthread_mutex_lock(&pj->lock);
+      pj->failed = 1;
+      pthread_mutex_unlock(&pj->lock);
+      return;
+   }
+   ix.out = buf;
+   ix.out_stride = ix.nwhich;
+
+   for (i = lo; i < hi; i += m)
+   {
+      m = hi - i < SUMMARY_BLOCK ? hi - i : SUMMARY_BLOCK;
+      ix.row0 = i;
+      index_rows(i, i + m, &ix);
+
+      pthread_mutex_lock(&pj->lock);
+      for (r = 0; r < m; r++)
+         summary_add(pj->ps, pj->group ? pj->group[i + r] : 0, buf + r * ix.nwhich);
+      pthread_mutex_unlock(&pj->lock);
+   }
+
+   free(buf);
+}
+
+int batch_summary(long n, const void *ncod, const void *naa, COUNT_TYPE type, const int *which, int nwhich, const long *group, INDEX_PLAN_STRUCT *pi, SUMMARY_STRUCT *ps, int threads)
+{
+   SUMMARY_JOB job = {.ix = {.ncod = ncod, .naa = naa, .type = type, .which = which,
+                             .nwhich = nwhich, .pi = pi},
+                      .group = group, .ps = ps};
+   int ret;
+
+   pthread_mutex_init(&job.lock, NULL);
+   job.failed = 0;
+   parallel_rows(n, threads, summary_rows, &job);
+   ret = job.failed ? -1 : 0;
+   pthread_mutex_destroy(&job.lock);
+   return ret;
+}
@@ -37,6 +37,7 @@ and may be removed in the future.
 
 #include "../include/codonW.h"
 
+#ifndef CODONW_NO_STDIO
 /****************** Codon Usage Out           *****************************/
 /* Writes codon usage output to file. Note this subroutine is only called */
 /* when machine readable output is selected, otherwise cutab_out is used  */
@@ -82,6 +83,7 @@ int codon_usage_out(FILE *fblkout, long *nncod, char *ttitle, MENU_STRUCT *pm)
    }
    return 0;
 }
+#endif
 /******************  Relative Synonymous Codon Usage **********************/
 int rscu_usage(long *nncod, long *nnaa, float rscu[], int *ds, GENETIC_CODE_STRUCT *pcu)
 {
@@ -99,6 +101,7 @@ int rscu_usage(long *nncod, long *nnaa, float rscu[], int *ds, GENETIC_CODE_STRU
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int rscu_usage_out(FILE *fblkout, long *nncod, long *nnaa, char* title, MENU_STRUCT *pm)
 {
    float rscu[65];
@@ -121,6 +124,7 @@ int rscu_usage_out(FILE *fblkout, long *nncod, long *nnaa, char* title, MENU_STR
 
    return 0;
 }
+#endif
 
 /****************** Relative amino acid usage output ********************/
 int raau_usage(long nnaa[], double raau[])
@@ -145,6 +149,7 @@ int raau_usage(long nnaa[], double raau[])
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int raau_usage_out(FILE *fblkout, long *nnaa, char* title, MENU_STRUCT *pm)
 {
    AMINO_STRUCT *paa = pm->paa;
@@ -204,6 +209,7 @@ int aa_usage_out(FILE *fblkout, long *nnaa, char* title, MENU_STRUCT *pm)
    fprintf(fblkout, "\n");
    return 0;
 }
+#endif
 
 /*******************   G+C output          *******************************/
 int gc(int *ds, long *ncod, long bases[5], long base_tot[5], long base_1[5], long base_2[5], long base_3[5], long *tot_s, long *totalaa, double gc_metrics[], GENETIC_CODE_STRUCT *pcu)
@@ -279,6 +285,7 @@ int gc(int *ds, long *ncod, long bases[5], long base_tot[5], long base_1[5], lon
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int gc_out(FILE *foutput, FILE *fblkout, long *nncod, int which, char* title, MENU_STRUCT *pm)
 {
    long bases[5]; /* base that are synonymous GCAT     */
@@ -388,50 +395,52 @@ int cutab_out(FILE *fblkout, long *nncod, long *nnaa, char* title, MENU_STRUCT *
            (long)codon_tot, title, pcu->des);
    return 0;
 }
+#endif
 
 /********************  Dinucleotide Count ****************************/
-int dinuc_count(char *seq, long din[3][16], long dinuc_tot[4], int *fram)
+/* dinuc_feed counts the dinucleotides in len bases of seq. The frame    */
+/* and the previous base are carried in fram and last, so a sequence     */
+/* can be fed in chunks. Pairs with a non-standard base are skipped      */
+/**************************************************************************/
+#define DINUC_BLOCK 4096
+
+int dinuc_feed(const char *seq, long long len, long din[3][16], int *fram, int *last)
 {
-   int last, cur = 0;
-   int i, x;
+   unsigned char codes[DINUC_BLOCK];
+   int cur;
+   long long i;
+   long k, m;
 
-   long ttot = (long)strlen(seq);
-   for (i = 0; i < ttot; i++)
+   for (i = 0; i < len; i += m)
    {
-      last = cur;
-      switch (seq[i])
+      m = (long)(len - i < DINUC_BLOCK ? len - i : DINUC_BLOCK);
+      base_codes(seq + i, m, codes);
+
+      for (k = 0; k < m; k++)
       {
-      case 't':
-      case 'T':
-      case 'u':
-      case 'U':
-         cur = 1;
-         break;
-      case 'c':
-      case 'C':
-         cur = 2;
-         break;
-      case 'a':
-      case 'A':
-         cur = 3;
-         break;
-      case 'g':
-      case 'G':
-         cur = 4;
-         break;
-      default:
-         cur = 0;
-         break;
+         cur = codes[k];
+         if (cur == 0 || *last == 0)
+         {               /* true if either of the base is not  */
+            *last = cur; /* a standard UTCG, or the current bas*/
+            continue;    /* is the start of the sequence       */
+         }
+         din[*fram][((*last - 1) * 4 + cur) - 1]++;
+         if (++(*fram) == 3)
+            *fram = 0; /* resets the frame to zero           */
+         *last = cur;
       }
-      if (cur == 0 || i == 0)
-         continue; /* true if either of the base is not  */
-                   /* a standard UTCG, or the current bas*/
-                   /* is the start of the sequence       */
-      din[*fram][((last - 1) * 4 + cur) - 1]++;
-      if (++(*fram) == 3)
-         *fram = 0; /* resets the frame to zero           */
    }
-   
+
+   return 0;
+}
+
+int dinuc_count(char *seq, long din[3][16], long dinuc_tot[4], int *fram)
+{
+   int last = 0;
+   int i, x;
+
+   dinuc_feed(seq, (long long)strlen(seq), din, fram, &last);
+
    for (x = 0; x < 4; x++)
       dinuc_tot[x] = 0;
 
@@ -445,6 +454,7 @@ int dinuc_count(char *seq, long din[3][16], long dinuc_tot[4], int *fram)
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int dinuc_out(char *seq, FILE *fblkout, char *ttitle, char sp) {
    static char called = false;
    char bases[5] = {'T', 'C', 'A', 'G'};
@@ -533,4 +543,5 @@ int dinuc_out(char *seq, FILE *fblkout, char *ttitle, char sp) {
    }
    return 0;
 }
+#endif
 
@@ -0,0 +1,252 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains the two passes over count matrices of correspondence
+analysis (the COA of the original CodonW) and principal component
+analysis of codon usage. With at most 64 codons as columns, everything
+the ordination needs from the genes fits in a ncol x ncol matrix, which
+coa_accumulate sums up one block of genes at a time (so that any number
+of genes, held in any number of parts, can be analysed). The axes are
+then found from that small matrix by the caller, and coa_project places
+each gene on them in a second pass.
+
+  COA_CA        gram = sum over genes of n_i n_i' / n_i.  (n_i the counts)
+                mean = column sums, weight = grand total
+  COA_PCA_*     gram = sum of (x_i - mean)(x_i - mean)'   (x_i the RSCU
+                or frequencies), mean = mean, weight = No. of genes
+
+Genes without any of the codons are left out, and placed at NaN.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#define COA_BLOCK 256 /* genes accumulated at a time         */
+
+/* Reads the columns of row i as counts (COA_CA) or features into x and   */
+/* returns the total count of the columns                                 */
+static long coa_row(const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, long i, double *x)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   long row[65], aa[22], tot = 0;
+   int c;
+
+   count_row_get(ncod, type, 65, i, row);
+   for (c = 0; c < ncol; c++)
+      tot += row[cols[c]];
+
+   switch (method)
+   {
+   case COA_CA:
+      for (c = 0; c < ncol; c++)
+         x[c] = (double)row[cols[c]];
+      break;
+   case COA_PCA_FREQ:
+      for (c = 0; c < ncol; c++)
+         x[c] = tot ? (double)row[cols[c]] / tot : 0.0;
+      break;
+   case COA_PCA_RSCU: /* as rscu_usage                       */
+      memset(aa, 0, sizeof(aa));
+      for (c = 1; c < 65; c++)
+         aa[pcu->ca[c]] += row[c];
+      for (c = 0; c < ncol; c++)
+      {
+         long na = aa[pcu->ca[cols[c]]];
+         x[c] = na ? (double)row[cols[c]] / na * plan->ds[cols[c]] : 0.0;
+      }
+      break;
+   }
+   return tot;
+}
+
+/******************  Accumulate             *******************************/
+/* Adds rows 0..n-1 to weight, mean and gram (see above). Each thread     */
+/* sums its own and they are added (COA_CA) or merged (Chan et al.)       */
+/**************************************************************************/
+typedef struct
+{
+   const void *ncod;
+   COUNT_TYPE type;
+   CODE_PLAN_STRUCT *plan;
+   COA_METHOD method;
+   int ncol;
+   const int *cols;
+   double *weight, *mean, *gram;   /* coa_accumulate        */
+   const double *center, *axes;    /* coa_project           */
+   int k;
+   double *out;
+   pthread_mutex_t lock;
+   int failed;
+} COA_JOB;
+
+/* merges (wb, mb, gb) into (wa, ma, ga)                                  */
+static void coa_merge(COA_METHOD method, int ncol, double *wa, double *ma, double *ga, double wb, const double *mb, const double *gb)
+{
+   double w = *wa + wb;
+   int a, b;
+
+   if (wb == 0)
+      return;
+   if (method == COA_CA)
+   {
+      for (a = 0; a < ncol; a++)
+         ma[a] += mb[a];
+      for (a = 0; a < ncol * ncol; a++)
+         ga[a] += gb[a];
+   }
+   else
+   {
+      double f = *wa * wb / w;
+      for (a = 0; a < ncol; a++)
+         for (b = 0; b < ncol; b++)
+            ga[a * ncol + b] += gb[a * ncol + b] + (mb[a] - ma[a]) * (mb[b] - ma[b]) * f;
+      for (a = 0; a < ncol; a++)
+         ma[a] += (mb[a] - ma[a]) * wb / w;
+   }
+   *wa = w;
+}
+
+static void accumulate_rows(long lo, long hi, void *ctx)
+{
+   COA_JOB *pj = ctx;
+   int ncol = pj->ncol, a, b;
+   double x[64], w = 0.0, bw;
+   long i, m, r;
+
+   double *mean = calloc(2 * ncol + 2 * ncol * ncol + 1, sizeof(double));
+   if (!mean)
+   {
+      pthread_mutex_lock(&pj->lock);
+      pj->failed = 1;
+      pthread_mutex_unlock(&pj->lock);
+      return;
+   }
+   double *gram = mean + ncol;
+   double *bmean = gram + ncol * ncol; /* of the current block        */
+   double *bgram = bmean + ncol;
+
+   for (i = lo; i < hi; i += m)
+   {
+      m = hi - i < COA_BLOCK ? hi - i : COA_BLOCK;
+      memset(bmean, 0, (ncol + ncol * ncol) * sizeof(double));
+      bw = 0.0;
+
+      if (pj->method == COA_CA)
+         for (r = i; r < i + m; r++)
+         {
+            long tot = coa_row(pj->ncod, pj->type, pj->plan, pj->method, ncol, pj->cols, r, x);
+            if (!tot)
+               continue;
+            bw += tot;
+            for (a = 0; a < ncol; a++)
+            {
+               double xa = x[a] / tot;
+               bmean[a] += x[a];
+               if (xa != 0.0)
+                  for (b = 0; b < ncol; b++)
+                     bgram[a * ncol + b] += xa * x[b];
+            }
+         }
+      else
+      { /* Welford within the block          */
+         for (r = i; r < i + m; r++)
+         {
+            double d[64];
+            if (!coa_row(pj->ncod, pj->type, pj->plan, pj->method, ncol, pj->cols, r, x))
+               continue;
+            bw += 1.0;
+            for (a = 0; a < ncol; a++)
+            {
+               d[a] = x[a] - bmean[a];
+               bmean[a] += d[a] / bw;
+            }
+            for (a = 0; a < ncol; a++)
+               for (b = 0; b < ncol; b++)
+                  bgram[a * ncol + b] += d[a] * (x[b] - bmean[b]);
+         }
+      }
+      coa_merge(pj->method, ncol, &w, mean, gram, bw, bmean, bgram);
+   }
+
+   pthread_mutex_lock(&pj->lock);
+   coa_merge(pj->method, ncol, pj->weight, pj->mean, pj->gram, w, mean, gram);
+   pthread_mutex_unlock(&pj->lock);
+   free(mean);
+}
+
+/* Returns -1 if memory ran out                                           */
+int coa_accumulate(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, double *weight, double *mean, double *gram, int threads)
+{
+   COA_JOB job = {.ncod = ncod, .type = type, .plan = plan, .method = method, .ncol = ncol,
+                  .cols = cols, .weight = weight, .mean = mean, .gram = gram};
+
+   pthread_mutex_init(&job.lock, NULL);
+   job.failed = 0;
+   parallel_rows(n, threads, accumulate_rows, &job);
+   pthread_mutex_destroy(&job.lock);
+   return job.failed ? -1 : 0;
+}
+
+/******************  Project                *******************************/
+/* Places rows 0..n-1 on the k axes (ncol x k): COA_CA the profile of     */
+/* each row (counts / total) times axes, COA_PCA_* the features less      */
+/* center times axes. Row i is written to out[i * k ..]                   */
+/**************************************************************************/
+static void project_rows(long lo, long hi, void *ctx)
+{
+   COA_JOB *pj = ctx;
+   double x[64];
+   long i;
+   int a, j;
+
+   for (i = lo; i < hi; i++)
+   {
+      double *o = pj->out + i * pj->k;
+      long tot = coa_row(pj->ncod, pj->type, pj->plan, pj->method, pj->ncol, pj->cols, i, x);
+
+      for (j = 0; j < pj->k; j++)
+         o[j] = tot ? 0.0 : NAN;
+      if (!tot)
+         continue;
+      for (a = 0; a < pj->ncol; a++)
+      {
+         double xa = pj->method == COA_CA ? x[a] / tot : x[a] - pj->center[a];
+         for (j = 0; j < pj->k; j++)
+            o[j] += xa * pj->axes[a * pj->k + j];
+      }
+   }
+}
+
+int coa_project(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, COA_METHOD method, int ncol, const int *cols, const double *center, const double *axes, int k, double *out, int threads)
+{
+   COA_JOB job = {.ncod = ncod, .type = type, .plan = plan, .method = method, .ncol = ncol,
+                  .cols = cols, .center = center, .axes = axes, .k = k, .out = out};
+   parallel_rows(n, threads, project_rows, &job);
+   return 0;
+}
@@ -0,0 +1,307 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains distances between the codon usage of sequences. Each
+sequence is first reduced to 64 features (RSCU, codon frequencies or
+codon frequencies within amino acids, see dist_features) and distances
+are then calculated between tiles of rows, the columns of each tile
+transposed so that dist_block runs along contiguous memory. Rows are
+shared between threads so that each gets a similar part of the triangle
+of pairs.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#define DIST_ROWS 64  /* rows of a tile                      */
+#define DIST_COLS 256 /* columns of a tile                   */
+
+/******************  Features               *******************************/
+/* Reduces each row of codon counts to 64 features (codons 1..64):        */
+/*   DIST_EUCLIDEAN, DIST_MANHATTAN  RSCU as rscu_usage if rscu is set,   */
+/*                                   otherwise codon frequencies          */
+/*   DIST_CHI2                       codon frequencies                    */
+/*   DIST_KARLIN                     frequency of each codon within its   */
+/*                                   amino acid, and in wt half the       */
+/*                                   frequency of that amino acid         */
+/* Stop codons are left out of amino acid frequencies. wt may be NULL     */
+/* for the other metrics                                                  */
+/**************************************************************************/
+int dist_features(long n, const void *ncod, COUNT_TYPE type, CODE_PLAN_STRUCT *plan, DIST_METRIC metric, bool rscu, double *feat, double *wt)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   long row[65], aa[22];
+   long i, tot, tot_aa;
+   int x;
+
+   for (i = 0; i < n; i++)
+   {
+      double *f = feat + i * 64;
+
+      count_row_get(ncod, type, 65, i, row);
+      memset(aa, 0, sizeof(aa));
+      for (x = 1, tot = 0; x < 65; x++)
+      {
+         aa[pcu->ca[x]] += row[x];
+         tot += row[x];
+      }
+      tot_aa = tot - aa[11];
+
+      for (x = 1; x < 65; x++)
+      {
+         long na = aa[pcu->ca[x]];
+         if (metric == DIST_KARLIN)
+         {
+            f[x - 1] = na ? (double)row[x] / na : 0.0;
+            wt[i * 64 + x - 1] = (pcu->ca[x] != 11 && tot_aa) ? 0.5 * na / tot_aa : 0.0;
+         }
+         else if (rscu && metric != DIST_CHI2)
+            f[x - 1] = na ? (double)row[x] / na * plan->ds[x] : 0.0;
+         else
+            f[x - 1] = tot ? (double)row[x] / tot : 0.0;
+      }
+   }
+   return 0;
+}
+
+/******************  Tiles                  *******************************/
+typedef struct
+{
+   DIST_METRIC metric;
+   long na;
+   const double *fa, *wa;
+   long nb;
+   const double *fb, *wb;
+   double *out;             /* dist_matrix and dist_condensed    */
+   long out_stride;
+   double threshold;        /* dist_within                       */
+   DIST_PAIRS_STRUCT *pairs;
+   pthread_mutex_t lock;
+   int failed;
+} DIST_JOB;
+
+typedef struct
+{
+   double *buf;             /* DIST_ROWS x DIST_COLS distances   */
+   double *bt;              /* 64 x DIST_COLS transposed columns */
+   double *wbt;
+} DIST_TILE;
+
+static int tile_alloc(DIST_TILE *pt)
+{
+   pt->buf = malloc((DIST_ROWS + 128) * DIST_COLS * sizeof(double));
+   pt->bt = pt->buf + DIST_ROWS * DIST_COLS;
+   pt->wbt = pt->bt + 64 * DIST_COLS;
+   return pt->buf == NULL;
+}
+
+/* distances of rows i0..i1-1 of a to rows j0..j1-1 of b into pt->buf    */
+static void dist_tile(DIST_JOB *pj, DIST_TILE *pt, long i0, long i1, long j0, long j1)
+{
+   long i, j, nj = j1 - j0;
+   int x;
+
+   for (j = 0; j < nj; j++)
+      for (x = 0; x < 64; x++)
+      {
+         pt->bt[x * DIST_COLS + j] = pj->fb[(j0 + j) * 64 + x];
+         if (pj->wb)
+            pt->wbt[x * DIST_COLS + j] = pj->wb[(j0 + j) * 64 + x];
+      }
+
+   dist_block(pj->metric, pj->fa + i0 * 64, pj->wa ? pj->wa + i0 * 64 : NULL, i1 - i0,
+              pt->bt, pt->wbt, DIST_COLS, nj, pt->buf, DIST_COLS);
+
+   if (pj->metric == DIST_EUCLIDEAN)
+      for (i = 0; i < i1 - i0; i++)
+         for (j = 0; j < nj; j++)
+            pt->buf[i * DIST_COLS + j] = sqrt(pt->buf[i * DIST_COLS + j]);
+}
+
+/* the k-th block of rows of a triangle, taken alternately from the top   */
+/* and the bottom so that contiguous ranges of k have similar work        */
+static long zigzag(long k, long nblk)
+{
+   return k % 2 ? nblk - 1 - k / 2 : k / 2;
+}
+
+/******************  Full matrix            *******************************/
+/* Writes the distance of row i of a to row j of b to                     */
+/* out[i * out_stride + j]. Returns -1 if memory ran out                  */
+/**************************************************************************/
+static void matrix_rows(long lo, long hi, void *ctx)
+{
+   DIST_JOB *pj = ctx;
+   DIST_TILE t;
+   long i0, i1, j0, j1, i;
+
+   if (tile_alloc(&t))
+   {
+      pj->failed = 1;
+      return;
+   }
+   for (i0 = lo; i0 < hi; i0 = i1)
+   {
+      i1 = hi - i0 < DIST_ROWS ? hi : i0 + DIST_ROWS;
+      for (j0 = 0; j0 < pj->nb; j0 = j1)
+      {
+         j1 = pj->nb - j0 < DIST_COLS ? pj->nb : j0 + DIST_COLS;
+         dist_tile(pj, &t, i0, i1, j0, j1);
+         for (i = i0; i < i1; i++)
+            memcpy(pj->out + i * pj->out_stride + j0, t.buf + (i - i0) * DIST_COLS,
+                   (j1 - j0) * sizeof(double));
+      }
+   }
+   free(t.buf);
+}
+
+int dist_matrix(DIST_METRIC metric, long na, const double *fa, const double *wa, long nb, const double *fb, const double *wb, double *out, long out_stride, int threads)
+{
+   DIST_JOB job = {.metric = metric, .na = na, .fa = fa, .wa = wa, .nb = nb, .fb = fb, .wb = wb,
+                   .out = out, .out_stride = out_stride};
+   parallel_rows(na, threads, matrix_rows, &job);
+   return job.failed ? -1 : 0;
+}
+
+/******************  Condensed / within     *******************************/
+/* dist_condensed writes the distances of rows i < j of f in the order of */
+/* scipy's pdist, i.e. to out[n * i - i * (i + 1) / 2 + j - i - 1].       */
+/* dist_within collects the pairs i < j no further apart than threshold   */
+/* (in no particular order). Both return -1 if memory ran out             */
+/**************************************************************************/
+static int pairs_add(DIST_PAIRS_STRUCT *pp, long i, long j, double d)
+{
+   if (pp->n == pp->cap)
+   {
+      long cap = pp->cap ? pp->cap * 2 : 1024;
+      long *pi = realloc(pp->i, cap * sizeof(long));
+      if (pi)
+         pp->i = pi;
+      long *pjj = realloc(pp->j, cap * sizeof(long));
+      if (pjj)
+         pp->j = pjj;
+      double *pd = realloc(pp->d, cap * sizeof(double));
+      if (pd)
+         pp->d = pd;
+      if (!pi || !pjj || !pd)
+         return 1;
+      pp->cap = cap;
+   }
+   pp->i[pp->n] = i;
+   pp->j[pp->n] = j;
+   pp->d[pp->n] = d;
+   pp->n++;
+   return 0;
+}
+
+static void triangle_rows(long lo, long hi, void *ctx)
+{
+   DIST_JOB *pj = ctx;
+   DIST_PAIRS_STRUCT local = {0};
+   DIST_TILE t;
+   long nblk = (pj->na + DIST_ROWS - 1) / DIST_ROWS;
+   long k, i0, i1, j0, j1, i, j;
+   int failed = 0;
+
+   if (tile_alloc(&t))
+   {
+      pj->failed = 1;
+      return;
+   }
+   for (k = lo; k < hi && !failed; k++)
+   {
+      i0 = zigzag(k, nblk) * DIST_ROWS;
+      i1 = pj->na - i0 < DIST_ROWS ? pj->na : i0 + DIST_ROWS;
+      for (j0 = i0 + 1; j0 < pj->na && !failed; j0 = j1)
+      {
+         j1 = pj->na - j0 < DIST_COLS ? pj->na : j0 + DIST_COLS;
+         dist_tile(pj, &t, i0, i1, j0, j1);
+         for (i = i0; i < i1; i++)
+         {
+            const double *d = t.buf + (i - i0) * DIST_COLS; /* column j0 on */
+            j = i + 1 > j0 ? i + 1 : j0;
+            if (pj->out)
+            {
+               if (j < j1)
+                  memcpy(pj->out + pj->na * i - i * (i + 1) / 2 + j - i - 1, d + (j - j0),
+                         (j1 - j) * sizeof(double));
+               continue;
+            }
+            for (; j < j1; j++)
+               if (d[j - j0] <= pj->threshold && pairs_add(&local, i, j, d[j - j0]))
+                  failed = 1;
+         }
+      }
+   }
+   free(t.buf);
+
+   if (pj->out)
+      return;
+   pthread_mutex_lock(&pj->lock);
+   for (k = 0; k < local.n && !failed; k++)
+      failed = pairs_add(pj->pairs, local.i[k], local.j[k], local.d[k]);
+   if (failed)
+      pj->failed = 1;
+   pthread_mutex_unlock(&pj->lock);
+   dist_pairs_free(&local);
+}
+
+int dist_condensed(DIST_METRIC metric, long n, const double *f, const double *w, double *out, int threads)
+{
+   DIST_JOB job = {.metric = metric, .na = n, .fa = f, .wa = w, .nb = n, .fb = f, .wb = w,
+                   .out = out};
+   parallel_rows((n + DIST_ROWS - 1) / DIST_ROWS, threads, triangle_rows, &job);
+   return job.failed ? -1 : 0;
+}
+
+int dist_within(DIST_METRIC metric, long n, const double *f, const double *w, double threshold, DIST_PAIRS_STRUCT *pp, int threads)
+{
+   DIST_JOB job = {.metric = metric, .na = n, .fa = f, .wa = w, .nb = n, .fb = f, .wb = w,
+                   .threshold = threshold, .pairs = pp};
+
+   memset(pp, 0, sizeof(DIST_PAIRS_STRUCT));
+   pthread_mutex_init(&job.lock, NULL);
+   parallel_rows((n + DIST_ROWS - 1) / DIST_ROWS, threads, triangle_rows, &job);
+   pthread_mutex_destroy(&job.lock);
+   if (job.failed)
+   {
+      dist_pairs_free(pp);
+      return -1;
+   }
+   return 0;
+}
+
+void dist_pairs_free(DIST_PAIRS_STRUCT *pp)
+{
+   free(pp->i);
+   free(pp->j);
+   free(pp->d);
+   memset(pp, 0, sizeof(DIST_PAIRS_STRUCT));
+}
@@ -0,0 +1,261 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains predictors of expression level that compare the codon
+usage of each gene with that of its genome and of a set of highly
+expressed genes of the same genome, in two passes over a count matrix.
+expr_totals sums the codons of each genome (and of its highly expressed
+genes), expr_plan_init turns those into the frequency of each codon
+within its amino acid, and expr_scores scores every gene against the
+references of its genome:
+
+  B     Karlin's B (Karlin, Mrazek & Campbell 1998)
+          B(g|r) = sum_a p_a(g) sum_c |f(c|a,g) - f(c|a,r)|
+  MILC  Measure Independent of Length and Composition (Supek &
+        Vlahovicek 2005)
+          MILC(g|r) = sum_a 2 sum_c O_c ln(O_c / E_c) / L - C
+          E_c = n_a f(c|a,r),  C = sum_a (r_a - 1) / L - 0.5
+  E     B(g|genome) / B(g|highly expressed)
+  MELP  MILC(g|genome) / MILC(g|highly expressed)
+
+Families are the amino acids of the genetic code with more than one codon,
+stop codons left out. L is the number of sense codons of the gene and the
+sum of C runs over the families it uses.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+/******************  Pass one               *******************************/
+/* Sums the codon counts of the rows of each group (all group 0 if group  */
+/* is NULL) into tot, and those of the rows where he is set into tot_he   */
+/* (either may be NULL). Each thread sums its own tables, which are added */
+/* up at the end. Returns -1 if memory ran out                            */
+/**************************************************************************/
+typedef struct
+{
+   const void *ncod;
+   COUNT_TYPE type;
+   const long *group;
+   const unsigned char *he;
+   long ngroups;
+   long (*tot)[65], (*tot_he)[65];     /* expr_totals           */
+   EXPR_PLAN_STRUCT *pe;                /* expr_scores           */
+   const int *which;
+   int nwhich;
+   double *out;
+   long out_stride;
+   pthread_mutex_t lock;
+   int failed;
+} EXPR_JOB;
+
+static void total_rows(long lo, long hi, void *ctx)
+{
+   EXPR_JOB *pj = ctx;
+   long ng = pj->ngroups, i, g;
+   long row[65];
+   int x;
+
+   long (*tot)[65] = calloc(2 * ng, sizeof(*tot));
+   if (!tot)
+   {
+      pthread_mutex_lock(&pj->lock);
+      pj->failed = 1;
+      pthread_mutex_unlock(&pj->lock);
+      return;
+   }
+   long (*tot_he)[65] = tot + ng;
+
+   for (i = lo; i < hi; i++)
+   {
+      g = pj->group ? pj->group[i] : 0;
+      count_row_get(pj->ncod, pj->type, 65, i, row);
+      for (x = 1; x < 65; x++)
+         tot[g][x] += row[x];
+      if (pj->he && pj->he[i])
+         for (x = 1; x < 65; x++)
+            tot_he[g][x] += row[x];
+   }
+
+   pthread_mutex_lock(&pj->lock);
+   for (g = 0; g < ng; g++)
+      for (x = 1; x < 65; x++)
+      {
+         if (pj->tot)
+            pj->tot[g][x] += tot[g][x];
+         if (pj->tot_he)
+            pj->tot_he[g][x] += tot_he[g][x];
+      }
+   pthread_mutex_unlock(&pj->lock);
+   free(tot);
+}
+
+int expr_totals(long n, const void *ncod, COUNT_TYPE type, const long *group, const unsigned char *he, long ngroups, long (*tot)[65], long (*tot_he)[65], int threads)
+{
+   EXPR_JOB job = {.ncod = ncod, .type = type, .group = group, .he = he, .ngroups = ngroups,
+                   .tot = tot, .tot_he = tot_he};
+   int ret;
+
+   if (tot)
+      memset(tot, 0, ngroups * sizeof(*tot));
+   if (tot_he)
+      memset(tot_he, 0, ngroups * sizeof(*tot_he));
+
+   pthread_mutex_init(&job.lock, NULL);
+   job.failed = 0;
+   parallel_rows(n, threads, total_rows, &job);
+   ret = job.failed ? -1 : 0;
+   pthread_mutex_destroy(&job.lock);
+   return ret;
+}
+
+/******************  References             *******************************/
+/* Turns the codon totals of each group into the frequency of each codon  */
+/* within its family, after adding pseudo to every count. The frequencies */
+/* of a group whose reference has no sense codons at all are NaN, so that */
+/* its genes score NaN against it. Returns 1 if memory ran out            */
+/**************************************************************************/
+static void family_freq(CODE_PLAN_STRUCT *plan, const long tot[65], double pseudo, double *f)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   double fam[22] = {0}, all = 0.0;
+   int x;
+
+   for (x = 1; x < 65; x++)
+      if (pcu->ca[x] != 11)
+      {
+         fam[pcu->ca[x]] += tot[x] + pseudo;
+         all += tot[x];
+      }
+   f[0] = NAN;
+   for (x = 1; x < 65; x++)
+   {
+      double na = fam[pcu->ca[x]];
+      f[x] = (all > 0 && na > 0) ? (tot[x] + pseudo) / na : NAN;
+   }
+}
+
+int expr_plan_init(EXPR_PLAN_STRUCT *pe, CODE_PLAN_STRUCT *plan, long ngroups, long (*tot)[65], long (*tot_he)[65], double pseudo)
+{
+   long g;
+
+   pe->plan = plan;
+   pe->ngroups = ngroups;
+   pe->f = malloc(2 * ngroups * 65 * sizeof(double) + 1);
+   if (!pe->f)
+      return 1;
+
+   for (g = 0; g < ngroups; g++)
+   {
+      family_freq(plan, tot[g], pseudo, pe->f + (2 * g) * 65);
+      family_freq(plan, tot_he[g], pseudo, pe->f + (2 * g + 1) * 65);
+   }
+   return 0;
+}
+
+void expr_plan_free(EXPR_PLAN_STRUCT *pe)
+{
+   free(pe->f);
+   pe->f = NULL;
+}
+
+/******************  Pass two               *******************************/
+/* Writes the indices listed in which (EXPR_INDEX) of rows 0..n-1 to out, */
+/* with rows out_stride apart, each scored against the references of its  */
+/* group. Indices that can not be calculated (no sense codons, a codon    */
+/* missing from the reference) are NaN or infinite                        */
+/**************************************************************************/
+/* B and MILC of a row against the family frequencies ref                 */
+static void expr_pair(CODE_PLAN_STRUCT *plan, const long row[65], const long aa[22], long len, const double *ref, double *b, double *milc)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   double sb = 0.0, sm = 0.0, corr = 0.0;
+   int x, a;
+
+   for (x = 1; x < 65; x++)
+   {
+      a = pcu->ca[x];
+      if (a == 11 || plan->ds[x] < 2 || !aa[a])
+         continue;
+      sb += fabs((double)row[x] / aa[a] - ref[x]) * aa[a];
+      if (row[x])
+         sm += 2.0 * row[x] * log(row[x] / (aa[a] * ref[x]));
+   }
+   for (a = 0; a < 22; a++)
+      if (a != 11 && aa[a] && plan->da[a] > 1)
+         corr += plan->da[a] - 1;
+
+   *b = sb / len;
+   *milc = sm / len - (corr / len - 0.5);
+}
+
+static void score_rows(long lo, long hi, void *ctx)
+{
+   EXPR_JOB *pj = ctx;
+   EXPR_PLAN_STRUCT *pe = pj->pe;
+   GENETIC_CODE_STRUCT *pcu = pe->plan->pcu;
+   long row[65], aa[22], len, i, g;
+   double v[NUM_EXPR];
+   int x;
+
+   for (i = lo; i < hi; i++)
+   {
+      double *out = pj->out + i * pj->out_stride;
+
+      count_row_get(pj->ncod, pj->type, 65, i, row);
+      memset(aa, 0, sizeof(aa));
+      for (x = 1; x < 65; x++)
+         aa[pcu->ca[x]] += row[x];
+      for (x = 0, len = 0; x < 22; x++)
+         if (x != 11)
+            len += aa[x];
+
+      if (len)
+      {
+         g = pj->group ? pj->group[i] : 0;
+         expr_pair(pe->plan, row, aa, len, pe->f + (2 * g) * 65, &v[EXPR_B], &v[EXPR_MILC]);
+         expr_pair(pe->plan, row, aa, len, pe->f + (2 * g + 1) * 65, &v[EXPR_B_HE], &v[EXPR_MILC_HE]);
+         v[EXPR_E] = v[EXPR_B] / v[EXPR_B_HE];
+         v[EXPR_MELP] = v[EXPR_MILC] / v[EXPR_MILC_HE];
+      }
+      else
+         for (x = 0; x < NUM_EXPR; x++)
+            v[x] = NAN;
+
+      for (x = 0; x < pj->nwhich; x++)
+         out[x] = v[pj->which[x]];
+   }
+}
+
+int expr_scores(long n, const void *ncod, COUNT_TYPE type, const long *group, EXPR_PLAN_STRUCT *pe, const int *which, int nwhich, double *out, long out_stride, int threads)
+{
+   EXPR_JOB job = {.ncod = ncod, .type = type, .group = group, .ngroups = pe->ngroups, .pe = pe,
+                   .which = which, .nwhich = nwhich, .out = out, .out_stride = out_stride};
+   return parallel_rows(n, threads, score_rows, &job);
+}
@@ -0,0 +1,658 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains a FASTA reader that counts each record as it is
+read into a COUNT_TABLE_STRUCT. Plain and gzip compressed files are
+read transparently. The blocks of BGZF files (as written by bgzip) are
+independent, so they are inflated on a pool of threads while the blocks
+before them are parsed.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "../include/codonW.h"
+
+#define FASTA_BUF_LEN 1048576   /* bytes read from a gzFile at once     */
+#define BGZF_MAX_BLOCK 65536    /* maximum size of a BGZF block         */
+#define BGZF_BLOCKS_PER_THREAD 8
+#define FASTA_RANGE_END -1      /* parser reached the end of its range */
+
+/******************  Count table            *******************************/
+/* A growable table with the counts of each record read. The counts are  */
+/* held as pt->type (set after init, long by default). A record whose    */
+/* counts do not fit fails with 4 unless pt->widen is set, in which case */
+/* the table is widened to the next type first. If pt->hash is set the   */
+/* digest of each record's stream is kept too                            */
+/**************************************************************************/
+static const size_t count_size[] = {sizeof(long), sizeof(uint32_t), sizeof(uint16_t)};
+static const long count_max[] = {LONG_MAX, UINT32_MAX, UINT16_MAX};
+
+int count_table_init(COUNT_TABLE_STRUCT *pt)
+{
+   memset(pt, 0, sizeof(COUNT_TABLE_STRUCT));
+   return 0;
+}
+
+/* Converts the rows held to the next wider type, last row first so that */
+/* each is read before a wider row is written over it                     */
+static int count_table_widen(COUNT_TABLE_STRUCT *pt)
+{
+   COUNT_TYPE type = pt->type - 1;
+   long row[65], i;
+
+   void *nncod = realloc(pt->ncod, pt->cap * 65 * count_size[type] + 1);
+   if (nncod)
+      pt->ncod = nncod;
+   void *nnaa = realloc(pt->naa, pt->cap * 22 * count_size[type] + 1);
+   if (nnaa)
+      pt->naa = nnaa;
+   if (!nncod || !nnaa)
+      return 1;
+
+   for (i = pt->n - 1; i >= 0; i--)
+   {
+      count_row_get(pt->ncod, pt->type, 65, i, row);
+      count_row_set(pt->ncod, type, 65, i, row);
+      count_row_get(pt->naa, pt->type, 22, i, row);
+      count_row_set(pt->naa, type, 22, i, row);
+   }
+   pt->type = type;
+   return 0;
+}
+
+int count_table_add(COUNT_TABLE_STRUCT *pt, const char *title, long title_len, CODON_STREAM_STRUCT *ps)
+{
+   long cap, top = 0;
+   int x;
+
+   /* the amino acid counts are sums of codon counts, but check both       */
+   for (x = 0; x < 65; x++)
+      if (ps->ncod[x] > top)
+         top = ps->ncod[x];
+   for (x = 0; x < 22; x++)
+      if (ps->naa[x] > top)
+         top = ps->naa[x];
+   while (top > count_max[pt->type])
+   {
+      if (!pt->widen)
+         return 4;
+      if (count_table_widen(pt))
+         return 1;
+   }
+
+   if (pt->n == pt->cap)
+   { /* double the space allocated        */
+      cap = pt->cap ? pt->cap * 2 : 1024;
+      char **ntitle = realloc(pt->title, cap * sizeof(char *));
+      if (ntitle)
+         pt->title = ntitle;
+      void *nncod = realloc(pt->ncod, cap * 65 * count_size[pt->type]);
+      if (nncod)
+         pt->ncod = nncod;
+      void *nnaa = realloc(pt->naa, cap * 22 * count_size[pt->type]);
+      if (nnaa)
+         pt->naa = nnaa;
+      long *ncodon_tot = realloc(pt->codon_tot, cap * sizeof(long));
+      if (ncodon_tot)
+         pt->codon_tot = ncodon_tot;
+      int *nvalid_stops = realloc(pt->valid_stops, cap * sizeof(int));
+      if (nvalid_stops)
+         pt->valid_stops = nvalid_stops;
+      uint64_t (*ndigest)[2] = pt->digest;
+      if (pt->hash)
+      {
+         ndigest = realloc(pt->digest, cap * sizeof(uint64_t[2]));
+         if (ndigest)
+            pt->digest = ndigest;
+      }
+
+      if (!ntitle || !nncod || !nnaa || !ncodon_tot || !nvalid_stops || (pt->hash && !ndigest))
+         return 1;
+      pt->cap = cap;
+   }
+
+   char *t = malloc(title_len + 1);
+   if (!t)
+      return 1;
+   memcpy(t, title, title_len);
+   t[title_len] = '\0';
+
+   pt->title[pt->n] = t;
+   count_row_set(pt->ncod, pt->type, 65, pt->n, ps->ncod);
+   count_row_set(pt->naa, pt->type, 22, pt->n, ps->naa);
+   pt->codon_tot[pt->n] = ps->codon_tot;
+   pt->valid_stops[pt->n] = ps->valid_stops;
+   if (pt->hash)
+      memcpy(pt->digest[pt->n], ps->digest, sizeof(uint64_t[2]));
+   pt->n++;
+
+   return 0;
+}
+
+int count_table_free(COUNT_TABLE_STRUCT *pt)
+{
+   long i;
+
+   for (i = 0; i < pt->n; i++)
+      free(pt->title[i]);
+   free(pt->title);
+   free(pt->ncod);
+   free(pt->naa);
+   free(pt->codon_tot);
+   free(pt->valid_stops);
+   free(pt->digest);
+   count_table_init(pt);
+
+   return 0;
+}
+
+/******************  FASTA parser           *******************************/
+/* Consumes the decompressed bytes of a FASTA file in pieces of any size. */
+/* Sequence lines are fed straight into a codon stream, and each record  */
+/* is added to the count table when the next title line (or EOF) is met  */
+/* Parsing stops at the first record starting at or beyond byte end      */
+/**************************************************************************/
+typedef struct
+{
+   COUNT_TABLE_STRUCT *pt;
+   GENETIC_CODE_STRUCT *pcu;
+   CODON_STREAM_STRUCT stream;
+
+   char in_record;   /* a title line has been read           */
+   char in_title;    /* currently reading a title line       */
+   char line_start;  /* next byte starts a new line          */
+
+   char *title;
+   long title_len;
+   long title_cap;
+
+   long long offset; /* file offset of the next byte          */
+   long long end;    /* no record starting here is read       */
+} FASTA_PARSER;
+
+static int parser_end_record(FASTA_PARSER *pp)
+{
+   if (!pp->in_record)
+      return 0;
+
+   codon_stream_finish(&pp->stream);
+   pp->in_record = false;
+
+   while (pp->title_len && isspace((unsigned char)pp->title[pp->title_len - 1]))
+      pp->title_len--;
+   return count_table_add(pp->pt, pp->title, pp->title_len, &pp->stream);
+}
+
+static int parser_title_append(FASTA_PARSER *pp, const char *s, long len)
+{
+   if (pp->title_len + len > pp->title_cap)
+   {
+      long cap = (pp->title_len + len) * 2 + 64;
+      char *t = realloc(pp->title, cap);
+      if (!t)
+         return 1;
+      pp->title = t;
+      pp->title_cap = cap;
+   }
+   memcpy(pp->title + pp->title_len, s, len);
+   pp->title_len += len;
+   return 0;
+}
+
+static int parser_feed(FASTA_PARSER *pp, const char *buf, long len)
+{
+   long i = 0, j, line;
+   int ret;
+
+   while (i < len)
+   {
+      if (pp->line_start && buf[i] == '>')
+      { /* a new record starts                */
+         if (pp->offset + i >= pp->end)
+            return FASTA_RANGE_END;
+         if ((ret = parser_end_record(pp)))
+            return ret;
+         codon_stream_init(&pp->stream, pp->pcu, false);
+         pp->stream.hash = pp->pt->hash;
+         pp->in_record = true;
+         pp->in_title = true;
+         pp->line_start = false;
+         pp->title_len = 0;
+         i++;
+      }
+
+      /* find the end of this line (or buffer)                             */
+      const char *nl = memchr(buf + i, '\n', len - i);
+      long end = nl ? nl - buf : len;
+      line = i;
+
+      if (pp->in_title)
+      {
+         if (parser_title_append(pp, buf + i, end - i))
+            return 1;
+      }
+      else if (pp->in_record)
+      { /* feed the runs between white space  */
+         for (j = i; j < end; j++)
+         {
+            if (!isspace((unsigned char)buf[j]))
+               continue;
+            codon_stream_feed(&pp->stream, buf + i, j - i);
+            i = j + 1;
+         }
+         codon_stream_feed(&pp->stream, buf + i, end - i);
+      }
+
+      if (nl)
+      {
+         pp->in_title = false;
+         pp->line_start = true;
+         i = end + 1;
+      }
+      else
+      {
+         if (end > line)
+            pp->line_start = false;
+         i = len;
+      }
+   }
+
+   pp->offset += len;
+   return 0;
+}
+
+/******************  BGZF                   *******************************/
+/* A BGZF file is a series of gzip members of at most 64 KiB, with the   */
+/* size of each member stored in a "BC" extra subfield of its header     */
+/**************************************************************************/
+typedef struct
+{
+   unsigned char cdata[BGZF_MAX_BLOCK]; /* the compressed member      */
+   long clen;                           /* its size                   */
+   unsigned char udata[BGZF_MAX_BLOCK]; /* inflated data              */
+   long ulen;
+   int error;
+} BGZF_BLOCK;
+
+/* Blocks are read in batches into one of two slots. Workers inflate the */
+/* blocks of either slot, the batch being waited for first, while the    */
+/* main thread reads the next batch into the other slot and then parses  */
+/* the batch it waited for                                               */
+typedef struct
+{
+   BGZF_BLOCK *blocks;  /* nslots blocks for each of the two slots     */
+   int nslots;
+   int nblocks[2];      /* blocks read into each slot                  */
+   int next[2];         /* next block of each slot to inflate          */
+   int done[2];         /* blocks of each slot inflated                */
+   int head;            /* the slot the main thread waits for          */
+   char stop;
+   pthread_mutex_t lock;
+   pthread_cond_t work;     /* blocks were added or stop was set       */
+   pthread_cond_t inflated; /* the head slot is inflated               */
+} BGZF_POOL;
+
+static unsigned int read_le16(const unsigned char *p)
+{
+   return p[0] | (p[1] << 8);
+}
+
+static unsigned long read_le32(const unsigned char *p)
+{
+   return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+          ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* Returns the total size of the BGZF member whose header starts at h,   */
+/* or 0 if the header is not a BGZF header                               */
+static long bgzf_block_size(const unsigned char *h, long hlen)
+{
+   unsigned int xlen, slen, x;
+
+   if (hlen < 18 || h[0] != 31 || h[1] != 139 || h[2] != 8 || !(h[3] & 4))
+      return 0;
+
+   xlen = read_le16(h + 10);
+   for (x = 12; x + 4 <= 12 + xlen && x + 4 <= (unsigned int)hlen; x += 4 + slen)
+   {
+      slen = read_le16(h + x + 2);
+      if (h[x] == 'B' && h[x + 1] == 'C' && slen == 2 && x + 6 <= (unsigned int)hlen)
+         return (long)read_le16(h + x + 4) + 1;
+   }
+   return 0;
+}
+
+static int bgzf_inflate(BGZF_BLOCK *pb)
+{
+   z_stream zs;
+   unsigned int xlen = read_le16(pb->cdata + 10);
+   long hlen = 12 + xlen;
+
+   if (pb->clen < hlen + 8)
+      return 1;
+
+   pb->ulen = read_le32(pb->cdata + pb->clen - 4);
+   if (pb->ulen > BGZF_MAX_BLOCK)
+      return 1;
+   if (pb->ulen == 0)
+      return 0;
+
+   memset(&zs, 0, sizeof(zs));
+   if (inflateInit2(&zs, -15) != Z_OK)
+      return 1;
+   zs.next_in = pb->cdata + hlen;
+   zs.avail_in = (uInt)(pb->clen - hlen - 8);
+   zs.next_out = pb->udata;
+   zs.avail_out = (uInt)pb->ulen;
+   int ret = inflate(&zs, Z_FINISH);
+   inflateEnd(&zs);
+
+   if (ret != Z_STREAM_END)
+      return 1;
+   if (crc32(crc32(0L, Z_NULL, 0), pb->udata, (uInt)pb->ulen) !=
+       read_le32(pb->cdata + pb->clen - 8))
+      return 1;
+   return 0;
+}
+
+/* Takes the next block to inflate, from the head slot first, or returns */
+/* NULL if there is none. Called with the lock held                       */
+static BGZF_BLOCK *bgzf_claim(BGZF_POOL *pp, int *slot)
+{
+   int k, s;
+
+   for (k = 0; k < 2; k++)
+   {
+      s = k ? !pp->head : pp->head;
+      if (pp->next[s] < pp->nblocks[s])
+      {
+         *slot = s;
+         return &pp->blocks[s * pp->nslots + pp->next[s]++];
+      }
+   }
+   return NULL;
+}
+
+/* Inflates a claimed block, with the lock held on entry and on return   */
+static void bgzf_inflate_claimed(BGZF_POOL *pp, BGZF_BLOCK *pb, int slot)
+{
+   pthread_mutex_unlock(&pp->lock);
+   pb->error = bgzf_inflate(pb);
+   pthread_mutex_lock(&pp->lock);
+   if (++pp->done[slot] == pp->nblocks[slot] && slot == pp->head)
+      pthread_cond_signal(&pp->inflated);
+}
+
+static void *bgzf_worker(void *arg)
+{
+   BGZF_POOL *pp = arg;
+   BGZF_BLOCK *pb;
+   int slot;
+
+   pthread_mutex_lock(&pp->lock);
+   while (!pp->stop)
+   {
+      if ((pb = bgzf_claim(pp, &slot)))
+         bgzf_inflate_claimed(pp, pb, slot);
+      else
+         pthread_cond_wait(&pp->work, &pp->lock);
+   }
+   pthread_mutex_unlock(&pp->lock);
+
+   return NULL;
+}
+
+/* Hands the n blocks read into a slot to the workers (n = 0 frees it)   */
+static void bgzf_submit(BGZF_POOL *pp, int slot, int n)
+{
+   pthread_mutex_lock(&pp->lock);
+   pp->nblocks[slot] = n;
+   pp->next[slot] = pp->done[slot] = 0;
+   pthread_cond_broadcast(&pp->work);
+   pthread_mutex_unlock(&pp->lock);
+}
+
+/* Waits until every block of a slot is inflated, inflating those that   */
+/* no worker has taken yet on this thread                                 */
+static void bgzf_wait(BGZF_POOL *pp, int slot)
+{
+   pthread_mutex_lock(&pp->lock);
+   pp->head = slot;
+   while (pp->done[slot] < pp->nblocks[slot])
+   {
+      if (pp->next[slot] < pp->nblocks[slot])
+         bgzf_inflate_claimed(pp, &pp->blocks[slot * pp->nslots + pp->next[slot]++], slot);
+      else
+         pthread_cond_wait(&pp->inflated, &pp->lock);
+   }
+   pthread_mutex_unlock(&pp->lock);
+}
+
+/* Reads the next member into pb, returns 1 at EOF and -1 on error        */
+static int bgzf_read_block(FILE *fp, BGZF_BLOCK *pb)
+{
+   size_t got = fread(pb->cdata, 1, 18, fp);
+   if (got == 0)
+      return 1;
+
+   long bsize = bgzf_block_size(pb->cdata, (long)got);
+   if (!bsize || bsize > BGZF_MAX_BLOCK)
+      return -1;
+   if (fread(pb->cdata + 18, 1, bsize - 18, fp) != (size_t)(bsize - 18))
+      return -1;
+
+   pb->clen = bsize;
+   return 0;
+}
+
+/* Reads up to n members into blocks, returns 1 at EOF and -1 on error   */
+static int bgzf_read_batch(FILE *fp, BGZF_BLOCK *blocks, int n, int *pn)
+{
+   int r = 0;
+
+   *pn = 0;
+   while (*pn < n && !(r = bgzf_read_block(fp, &blocks[*pn])))
+      (*pn)++;
+   return r;
+}
+
+static int bgzf_count(FILE *fp, int threads, FASTA_PARSER *pp)
+{
+   BGZF_POOL pool = {.nslots = threads * BGZF_BLOCKS_PER_THREAD};
+   pthread_t *tids = malloc(threads * sizeof(pthread_t));
+   char *started = calloc(threads, 1);
+   int retval = 0, r, n, cur = 0, i, t;
+
+   pool.blocks = malloc(2 * pool.nslots * sizeof(BGZF_BLOCK));
+   if (!pool.blocks || !tids || !started)
+   {
+      free(pool.blocks);
+      free(tids);
+      free(started);
+      return 1;
+   }
+
+   pthread_mutex_init(&pool.lock, NULL);
+   pthread_cond_init(&pool.work, NULL);
+   pthread_cond_init(&pool.inflated, NULL);
+   for (t = 0; t < threads; t++) /* bgzf_wait inflates whatever blocks */
+      started[t] = !pthread_create(&tids[t], NULL, bgzf_worker, &pool);
+
+   r = bgzf_read_batch(fp, pool.blocks, pool.nslots, &n);
+   bgzf_submit(&pool, cur, n);
+
+   while (!retval && pool.nblocks[cur])
+   {
+      /* read the next batch while this one is inflated                    */
+      if (!r)
+      {
+         r = bgzf_read_batch(fp, pool.blocks + !cur * pool.nslots, pool.nslots, &n);
+         bgzf_submit(&pool, !cur, n);
+      }
+
+      /* and parse this one while the next is inflated                     */
+      bgzf_wait(&pool, cur);
+      for (i = 0; i < pool.nblocks[cur] && !retval; i++)
+      {
+         BGZF_BLOCK *pb = &pool.blocks[cur * pool.nslots + i];
+         retval = pb->error ? 2 : parser_feed(pp, (char *)pb->udata, pb->ulen);
+      }
+      bgzf_submit(&pool, cur, 0);
+      cur = !cur;
+   }
+   if (!retval && r < 0)
+      retval = 2;
+
+   pthread_mutex_lock(&pool.lock);
+   pool.stop = true;
+   pthread_cond_broadcast(&pool.work);
+   pthread_mutex_unlock(&pool.lock);
+   for (t = 0; t < threads; t++)
+      if (started[t])
+         pthread_join(tids[t], NULL);
+
+   pthread_mutex_destroy(&pool.lock);
+   pthread_cond_destroy(&pool.work);
+   pthread_cond_destroy(&pool.inflated);
+   free(pool.blocks);
+   free(tids);
+   free(started);
+   return retval == FASTA_RANGE_END ? 0 : retval;
+}
+
+static int gz_count(gzFile gz, FASTA_PARSER *pp)
+{
+   char *buf = malloc(FASTA_BUF_LEN);
+   int len, retval = 0;
+
+   if (!buf)
+      return 1;
+
+   while (!retval && (len = gzread(gz, buf, FASTA_BUF_LEN)) > 0)
+      retval = parser_feed(pp, buf, len);
+   if (len < 0)
+      retval = 2;
+
+   free(buf);
+   return retval == FASTA_RANGE_END ? 0 : retval;
+}
+
+static int plain_count(FILE *fp, FASTA_PARSER *pp)
+{
+   char *buf = malloc(FASTA_BUF_LEN);
+   size_t len;
+   int retval = 0;
+
+   if (!buf)
+      return 1;
+
+   while (!retval && (len = fread(buf, 1, FASTA_BUF_LEN, fp)) > 0)
+      retval = parser_feed(pp, buf, (long)len);
+   if (ferror(fp))
+      retval = 2;
+
+   free(buf);
+   return retval == FASTA_RANGE_END ? 0 : retval;
+}
+
+/******************  FASTA count            *******************************/
+/* Reads filename (plain, gzip or BGZF compressed) and adds the counts of */
+/* each record to pt. Returns 0 on success, 1 if the file could not be   */
+/* opened or memory allocated, 2 if the file is corrupt and 4 if a       */
+/* count does not fit the element type of pt (see count_table_add)       */
+/**************************************************************************/
+int fasta_count(const char *filename, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt)
+{
+   return fasta_count_range(filename, 0, -1, threads, pcu, pt);
+}
+
+/******************  FASTA count range      *******************************/
+/* As fasta_count but only the records whose '>' lies in the bytes       */
+/* [start, end) are counted, so a file can be split into shards without  */
+/* rewriting it. end < 0 reads to the end of the file. A range other than */
+/* the whole file needs an uncompressed file, otherwise 3 is returned    */
+/**************************************************************************/
+int fasta_count_range(const char *filename, long long start, long long end, int threads, GENETIC_CODE_STRUCT *pcu, COUNT_TABLE_STRUCT *pt)
+{
+   FASTA_PARSER parser;
+   unsigned char head[18];
+   int retval;
+
+   memset(&parser, 0, sizeof(parser));
+   parser.pt = pt;
+   parser.pcu = pcu;
+   parser.line_start = true;
+   parser.end = end < 0 ? LLONG_MAX : end;
+
+   FILE *fp = fopen(filename, "rb");
+   if (!fp)
+      return 1;
+
+   size_t got = fread(head, 1, sizeof(head), fp);
+   rewind(fp);
+
+   if (start > 0 || end >= 0)
+   { /* seek to the range in a plain file */
+      if (got >= 2 && head[0] == 31 && head[1] == 139)
+         retval = 3;
+      else if (start > 0 && fseeko(fp, start - 1, SEEK_SET))
+         retval = 2;
+      else
+      {
+         if (start > 0) /* does the range begin a line ? */
+            parser.line_start = (fgetc(fp) == '\n');
+         parser.offset = start;
+         retval = plain_count(fp, &parser);
+      }
+   }
+   else if (threads > 1 && bgzf_block_size(head, (long)got))
+      retval = bgzf_count(fp, threads, &parser);
+   else
+   { /* zlib reads plain files as they are */
+      gzFile gz = gzopen(filename, "rb");
+      if (!gz)
+      {
+         fclose(fp);
+         return 1;
+      }
+      gzbuffer(gz, 262144);
+      retval = gz_count(gz, &parser);
+      gzclose(gz);
+   }
+   fclose(fp);
+
+   if (!retval)
+      retval = parser_end_record(&parser);
+
+   free(parser.title);
+   return retval;
+}
@@ -0,0 +1,521 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains functions that read an uncompressed genome FASTA file
+in place (mapped into memory) and count the codons of annotated coding
+sequences, i.e. runs of segments (exons) on either strand, straight from
+the genome. The segments of a coding sequence are fed one after another
+into a codon stream, so codons spanning exon junctions are counted
+without the spliced sequence being built. The lines of each record must
+be of equal length (as for a samtools .fai index) so that the file
+offset of any base can be calculated.
+
+UCSC .2bit files (version 0 or 1, of either byte order) are read in place
+too. Their bases are packed 4 to a byte (T=0, C=1, A=2, G=3, the first in
+the high bits) and are decoded straight into the base codes counted by
+the codon stream, with the runs of N listed in the file as non-standard
+bases. The lower case (soft masked) runs only matter to genome_fetch.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/codonW.h"
+
+#define GENOME_RC_BUF 4096 /* bases reverse complemented at once  */
+#define TWOBIT_SIG 0x1A412743U /* first word of a .2bit file       */
+
+static const char complement[256] = {
+   ['A'] = 'T', ['C'] = 'G', ['G'] = 'C', ['T'] = 'A', ['U'] = 'A', ['N'] = 'N',
+   ['a'] = 't', ['c'] = 'g', ['g'] = 'c', ['t'] = 'a', ['u'] = 'a', ['n'] = 'n'};
+
+/******************  Genome records         *******************************/
+static int genome_add(GENOME_STRUCT *pg, const char *title, long len)
+{
+   long n = 0;
+
+   if (pg->n == pg->cap)
+   {
+      long cap = pg->cap ? pg->cap * 2 : 64;
+      GENOME_RECORD *rec = realloc(pg->rec, cap * sizeof(GENOME_RECORD));
+      if (!rec)
+         return 1;
+      pg->rec = rec;
+      pg->cap = cap;
+   }
+
+   while (n < len && !isspace((unsigned char)title[n]))
+      n++;
+   char *name = malloc(n + 1);
+   if (!name)
+      return 1;
+   memcpy(name, title, n);
+   name[n] = '\0';
+
+   memset(&pg->rec[pg->n], 0, sizeof(GENOME_RECORD));
+   pg->rec[pg->n].name = name;
+   pg->n++;
+   return 0;
+}
+
+/******************  .2bit layout           *******************************/
+/* twobit_word reads the 32 bit word at off in the byte order of the     */
+/* file. twobit_index reads the index and record headers, returning 0 on */
+/* success, 1 if memory ran out and 3 if the file is truncated or of an   */
+/* unknown version                                                        */
+/**************************************************************************/
+static uint32_t twobit_word(const GENOME_STRUCT *pg, size_t off)
+{
+   uint32_t v;
+
+   memcpy(&v, pg->map + off, 4);
+   if (pg->swap)
+      v = (v >> 24) | ((v >> 8) & 0xff00U) | ((v << 8) & 0xff0000U) | (v << 24);
+   return v;
+}
+
+static int twobit_record(GENOME_STRUCT *pg, GENOME_RECORD *pr, unsigned long long off)
+{
+   if (off + 8 > pg->size)
+      return 3;
+   pr->length = twobit_word(pg, off);
+   pr->nblocks = twobit_word(pg, off + 4);
+   pr->nblock = off + 8;
+   off += 8 + 8ULL * pr->nblocks;
+
+   if (off + 4 > pg->size)
+      return 3;
+   pr->nmasks = twobit_word(pg, off);
+   pr->mask = off + 4;
+   off += 4 + 8ULL * pr->nmasks + 4; /* and a reserved word            */
+
+   pr->offset = off;
+   if (off + (pr->length + 3) / 4 > pg->size)
+      return 3;
+   return 0;
+}
+
+static int twobit_index(GENOME_STRUCT *pg)
+{
+   uint32_t version = twobit_word(pg, 4);
+   uint32_t count = twobit_word(pg, 8), i;
+   size_t wide = version == 1 ? 4 : 0; /* 64 bit record offsets        */
+   size_t off = 16;
+   int ret;
+
+   if (version > 1)
+      return 3;
+   for (i = 0; i < count; i++)
+   {
+      unsigned long long rec_off, hi;
+      size_t len;
+
+      if (off + 1 > pg->size)
+         return 3;
+      len = (unsigned char)pg->map[off];
+      if (off + 1 + len + 4 + wide > pg->size)
+         return 3;
+      if (genome_add(pg, pg->map + off + 1, (long)len))
+         return 1;
+
+      off += 1 + len;
+      rec_off = twobit_word(pg, off);
+      if (wide)
+      { /* the low word first unless swapped */
+         hi = twobit_word(pg, off + 4);
+         rec_off = pg->swap ? (rec_off << 32) | hi : (hi << 32) | rec_off;
+      }
+      off += 4 + wide;
+
+      if ((ret = twobit_record(pg, &pg->rec[pg->n - 1], rec_off)))
+         return ret;
+   }
+   return 0;
+}
+
+/******************  .2bit runs             *******************************/
+/* The first of n runs (starts at tab, sizes following them) that ends   */
+/* after base from. Runs are in order and do not overlap                  */
+/**************************************************************************/
+static long twobit_first(const GENOME_STRUCT *pg, long long tab, long n, long long from)
+{
+   long lo = 0, hi = n, mid;
+
+   while (lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+      if ((long long)twobit_word(pg, tab + 4 * mid) +
+              twobit_word(pg, tab + 4 * (n + mid)) <= from)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+/******************  .2bit decode           *******************************/
+/* Writes the base codes (base_code, 0 in runs of N) of bases from..      */
+/* from+run-1 to codes, or if rc those of the reverse complement          */
+/**************************************************************************/
+static void twobit_codes(const GENOME_STRUCT *pg, const GENOME_RECORD *pr, long long from, long run, unsigned char *codes, bool rc)
+{
+   const unsigned char *dna = (const unsigned char *)pg->map + pr->offset;
+   long long q, s, e;
+   long k, b;
+   int c;
+
+   for (k = 0; k < run; k++)
+   {
+      q = from + k;
+      c = (dna[q >> 2] >> (6 - 2 * (q & 3))) & 3;
+      if (rc)
+         codes[run - 1 - k] = (unsigned char)((c ^ 2) + 1); /* T<>A, C<>G */
+      else
+         codes[k] = (unsigned char)(c + 1);
+   }
+
+   for (b = twobit_first(pg, pr->nblock, pr->nblocks, from); b < pr->nblocks; b++)
+   {
+      s = twobit_word(pg, pr->nblock + 4 * b);
+      e = s + twobit_word(pg, pr->nblock + 4 * (pr->nblocks + b));
+      if (s >= from + run)
+         break;
+      for (q = s < from ? from : s; q < e && q < from + run; q++)
+         codes[rc ? from + run - 1 - q : q - from] = 0;
+   }
+}
+
+/******************  Genome open            *******************************/
+/* Maps filename into memory and works out the layout of each record.    */
+/* Returns 0 on success, 1 if the file could not be opened, mapped or    */
+/* memory allocated, 2 if the lines of a record are of unequal length    */
+/* and 3 if a .2bit file is truncated or of an unknown version           */
+/**************************************************************************/
+int genome_open(GENOME_STRUCT *pg, const char *filename)
+{
+   struct stat st;
+   GENOME_RECORD *pr = NULL;
+   bool short_line = false; /* a line shorter than the first was read  */
+   size_t i = 0;
+
+   memset(pg, 0, sizeof(GENOME_STRUCT));
+
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0)
+      return 1;
+   if (fstat(fd, &st))
+   {
+      close(fd);
+      return 1;
+   }
+   if (st.st_size == 0)
+   { /* nothing to map                    */
+      close(fd);
+      return 0;
+   }
+
+   void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return 1;
+   madvise(map, st.st_size, MADV_RANDOM);
+   pg->map = map;
+   pg->size = st.st_size;
+
+   if (pg->size >= 16)
+   { /* .2bit files start with a signature */
+      uint32_t sig;
+      int ret;
+
+      memcpy(&sig, pg->map, 4);
+      pg->swap = sig == ((TWOBIT_SIG >> 24) | ((TWOBIT_SIG >> 8) & 0xff00U) |
+                         ((TWOBIT_SIG << 8) & 0xff0000U) | (TWOBIT_SIG << 24));
+      if (sig == TWOBIT_SIG || pg->swap)
+      {
+         pg->twobit = 1;
+         if ((ret = twobit_index(pg)))
+            genome_close(pg);
+         return ret;
+      }
+   }
+
+   while (i < pg->size)
+   {
+      const char *nl = memchr(pg->map + i, '\n', pg->size - i);
+      size_t end = nl ? (size_t)(nl - pg->map) : pg->size;
+      size_t next = nl ? end + 1 : end;
+      long width = (long)(next - i);
+      long bases = (long)(end - i);
+
+      if (bases && pg->map[end - 1] == '\r')
+         bases--;
+
+      if (pg->map[i] == '>')
+      { /* a new record                     */
+         if (genome_add(pg, pg->map + i + 1, bases - 1))
+         {
+            genome_close(pg);
+            return 1;
+         }
+         pr = &pg->rec[pg->n - 1];
+         pr->offset = next;
+         short_line = false;
+      }
+      else if (pr && bases)
+      {
+         if (!pr->linebases)
+         {
+            pr->linebases = bases;
+            pr->linewidth = width;
+         }
+         else if (short_line || bases > pr->linebases ||
+                  (bases == pr->linebases && width != pr->linewidth && nl))
+         {
+            genome_close(pg);
+            return 2;
+         }
+         short_line = bases < pr->linebases;
+         pr->length += bases;
+      }
+      else if (pr)
+         short_line = true; /* only blank lines may follow      */
+
+      i = next;
+   }
+
+   return 0;
+}
+
+void genome_close(GENOME_STRUCT *pg)
+{
+   long i;
+
+   for (i = 0; i < pg->n; i++)
+      free(pg->rec[i].name);
+   free(pg->rec);
+   if (pg->map)
+      munmap((void *)pg->map, pg->size);
+   memset(pg, 0, sizeof(GENOME_STRUCT));
+}
+
+/******************  Genome feed            *******************************/
+/* Feeds bases start..end-1 (0 based) of record rec into a codon stream, */
+/* on the minus strand (strand '-') as their reverse complement. Returns */
+/* 1 if the bases are not within the record                               */
+/**************************************************************************/
+static const char *base_at(GENOME_RECORD *pr, const char *map, long long p)
+{
+   return map + pr->offset + (p / pr->linebases) * pr->linewidth + p % pr->linebases;
+}
+
+int genome_feed(GENOME_STRUCT *pg, long rec, long long start, long long end, char strand, CODON_STREAM_STRUCT *ps)
+{
+   char buf[GENOME_RC_BUF];
+   unsigned char codes[GENOME_RC_BUF];
+   GENOME_RECORD *pr;
+   long long p;
+   long run, k;
+
+   if (rec < 0 || rec >= pg->n)
+      return 1;
+   pr = &pg->rec[rec];
+   if (start < 0 || end > pr->length || start > end)
+      return 1;
+
+   if (pg->twobit)
+   { /* decoded a buffer of codes at a time */
+      for (p = start; p < end; p += run)
+      {
+         run = end - p < GENOME_RC_BUF ? (long)(end - p) : GENOME_RC_BUF;
+         if (strand != '-')
+            twobit_codes(pg, pr, p, run, codes, false);
+         else
+            twobit_codes(pg, pr, end - (p - start) - run, run, codes, true);
+         codon_stream_feed_codes(ps, codes, run);
+      }
+      return 0;
+   }
+
+   if (strand != '-')
+   { /* a line of bases at a time        */
+      for (p = start; p < end; p += run)
+      {
+         run = pr->linebases - (long)(p % pr->linebases);
+         if (run > end - p)
+            run = (long)(end - p);
+         codon_stream_feed(ps, base_at(pr, pg->map, p), run);
+      }
+      return 0;
+   }
+
+   for (p = end; p > start; p -= run)
+   { /* backwards, a buffer at a time    */
+      run = p - start < GENOME_RC_BUF ? (long)(p - start) : GENOME_RC_BUF;
+      for (k = 0; k < run; k++)
+      {
+         char c = complement[(unsigned char)*base_at(pr, pg->map, p - 1 - k)];
+         buf[k] = c ? c : 'N';
+      }
+      codon_stream_feed(ps, buf, run);
+   }
+   return 0;
+}
+
+/******************  Genome fetch           *******************************/
+/* Writes bases start..end-1 of record rec to out (end - start chars, not */
+/* terminated), on the minus strand as their reverse complement. Bases of */
+/* .2bit files are upper case but in their lower case runs, and N in      */
+/* their runs of N. Returns 1 if the bases are not within the record      */
+/**************************************************************************/
+int genome_fetch(GENOME_STRUCT *pg, long rec, long long start, long long end, char strand, char *out)
+{
+   static const char code_base[5] = {'N', 'T', 'C', 'A', 'G'};
+   GENOME_RECORD *pr;
+   long long p, s, e, len = end - start;
+   long run, k, b;
+
+   if (rec < 0 || rec >= pg->n)
+      return 1;
+   pr = &pg->rec[rec];
+   if (start < 0 || end > pr->length || start > end)
+      return 1;
+
+   if (pg->twobit)
+   {
+      for (p = start; p < end; p += run)
+      {
+         run = end - p < GENOME_RC_BUF ? (long)(end - p) : GENOME_RC_BUF;
+         twobit_codes(pg, pr, p, run, (unsigned char *)out + (p - start), false);
+         for (k = 0; k < run; k++)
+            out[p - start + k] = code_base[(unsigned char)out[p - start + k]];
+      }
+      for (b = twobit_first(pg, pr->mask, pr->nmasks, start); b < pr->nmasks; b++)
+      {
+         s = twobit_word(pg, pr->mask + 4 * b);
+         e = s + twobit_word(pg, pr->mask + 4 * (pr->nmasks + b));
+         if (s >= end)
+            break;
+         for (p = s < start ? start : s; p < e && p < end; p++)
+            out[p - start] = (char)tolower((unsigned char)out[p - start]);
+      }
+   }
+   else
+   {
+      for (p = start; p < end; p += run)
+      {
+         run = pr->linebases - (long)(p % pr->linebases);
+         if (run > end - p)
+            run = (long)(end - p);
+         memcpy(out + (p - start), base_at(pr, pg->map, p), run);
+      }
+   }
+
+   if (strand == '-')
+      for (p = 0; p < len - 1 - p; p++)
+      { /* reverse complement in place       */
+         char a = complement[(unsigned char)out[p]];
+         char z = complement[(unsigned char)out[len - 1 - p]];
+         out[p] = z ? z : 'N';
+         out[len - 1 - p] = a ? a : 'N';
+      }
+   if (strand == '-' && len % 2)
+   {
+      char c = complement[(unsigned char)out[len / 2]];
+      out[len / 2] = c ? c : 'N';
+   }
+   return 0;
+}
+
+/******************  Genome count CDS       *******************************/
+/* Counts n coding sequences. Sequence i is on record rec[i] and strand  */
+/* strand[i] and is made of the segments seg_ptr[i]..seg_ptr[i+1]-1      */
+/* (seg_start, seg_end, 0 based) in the order they are transcribed.      */
+/* Returns the No. of coding sequences with a segment outside its record */
+/* (left at zero)                                                         */
+/**************************************************************************/
+typedef struct
+{
+   GENOME_STRUCT *pg;
+   const long *rec;
+   const char *strand;
+   const long *seg_ptr;
+   const long long *seg_start;
+   const long long *seg_end;
+   GENETIC_CODE_STRUCT *pcu;
+   long (*ncod)[65];
+   long (*naa)[22];
+   long *codon_tot;
+   int *valid_stops;
+   char *bad;
+} CDS_JOB;
+
+static void cds_rows(long lo, long hi, void *ctx)
+{
+   CDS_JOB *pj = ctx;
+   CODON_STREAM_STRUCT stream;
+   long i, k;
+
+   for (i = lo; i < hi; i++)
+   {
+      pj->bad[i] = 0;
+      codon_stream_init(&stream, pj->pcu, false);
+      for (k = pj->seg_ptr[i]; k < pj->seg_ptr[i + 1] && !pj->bad[i]; k++)
+         pj->bad[i] = (char)genome_feed(pj->pg, pj->rec[i], pj->seg_start[k], pj->seg_end[k],
+                                        pj->strand[i], &stream);
+      if (pj->bad[i])
+         continue;
+      codon_stream_finish(&stream);
+
+      memcpy(pj->ncod[i], stream.ncod, sizeof(long[65]));
+      memcpy(pj->naa[i], stream.naa, sizeof(long[22]));
+      pj->codon_tot[i] = stream.codon_tot;
+      pj->valid_stops[i] = stream.valid_stops;
+   }
+}
+
+int genome_count_cds(GENOME_STRUCT *pg, long n, const long *rec, const char *strand, const long *seg_ptr, const long long *seg_start, const long long *seg_end, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads)
+{
+   CDS_JOB job = {pg, rec, strand, seg_ptr, seg_start, seg_end, pcu,
+                  ncod, naa, codon_tot, valid_stops, NULL};
+   long i;
+   int nbad = 0;
+
+   job.bad = calloc(n > 0 ? n : 1, 1);
+   if (!job.bad)
+      return -1;
+
+   parallel_rows(n, threads, cds_rows, &job);
+   for (i = 0; i < n; i++)
+      nbad += job.bad[i];
+   free(job.bad);
+
+   return nbad;
+}
@@ -0,0 +1,150 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains a 128 bit hash of sequences (MurmurHash3 x64 128 by
+Austin Appleby, seed 0) that can be fed in pieces of any size, so that
+sequences are hashed in the same pass that counts them. It is used to
+find identical sequences, and is not meant to resist deliberate
+collisions.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../include/codonW.h"
+
+#define HASH_C1 0x87c37b91114253d5ULL
+#define HASH_C2 0x4cf5ad432745937fULL
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+   k ^= k >> 33;
+   k *= 0xff51afd7ed558ccdULL;
+   k ^= k >> 33;
+   k *= 0xc4ceb9fe1a85ec53ULL;
+   k ^= k >> 33;
+   return k;
+}
+
+static inline uint64_t load64(const unsigned char *p)
+{ /* little endian on any machine       */
+   uint64_t k = 0;
+   int i;
+   for (i = 7; i >= 0; i--)
+      k = (k << 8) | p[i];
+   return k;
+}
+
+static inline uint64_t mix_k1(uint64_t k1)
+{
+   k1 *= HASH_C1;
+   k1 = rotl64(k1, 31);
+   return k1 * HASH_C2;
+}
+
+static inline uint64_t mix_k2(uint64_t k2)
+{
+   k2 *= HASH_C2;
+   k2 = rotl64(k2, 33);
+   return k2 * HASH_C1;
+}
+
+static void hash_block(SEQ_HASH_STRUCT *ph, const unsigned char *p)
+{
+   ph->h1 ^= mix_k1(load64(p));
+   ph->h1 = rotl64(ph->h1, 27);
+   ph->h1 += ph->h2;
+   ph->h1 = ph->h1 * 5 + 0x52dce729;
+
+   ph->h2 ^= mix_k2(load64(p + 8));
+   ph->h2 = rotl64(ph->h2, 31);
+   ph->h2 += ph->h1;
+   ph->h2 = ph->h2 * 5 + 0x38495ab5;
+}
+
+void seq_hash_init(SEQ_HASH_STRUCT *ph)
+{
+   memset(ph, 0, sizeof(SEQ_HASH_STRUCT));
+}
+
+void seq_hash_feed(SEQ_HASH_STRUCT *ph, const char *buf, long long len)
+{
+   const unsigned char *p = (const unsigned char *)buf;
+   long long i = 0;
+
+   if (len <= 0)
+      return;
+   ph->len += len;
+
+   if (ph->ntail)
+   { /* complete the block held back        */
+      while (ph->ntail < 16 && i < len)
+         ph->tail[ph->ntail++] = p[i++];
+      if (ph->ntail < 16)
+         return;
+      hash_block(ph, ph->tail);
+      ph->ntail = 0;
+   }
+
+   for (; i + 16 <= len; i += 16)
+      hash_block(ph, p + i);
+
+   while (i < len)
+      ph->tail[ph->ntail++] = p[i++];
+}
+
+void seq_hash_final(SEQ_HASH_STRUCT *ph, uint64_t digest[2])
+{
+   uint64_t h1 = ph->h1, h2 = ph->h2;
+   uint64_t k1 = 0, k2 = 0;
+   int i;
+
+   for (i = ph->ntail - 1; i >= 8; i--)
+      k2 = (k2 << 8) | ph->tail[i];
+   for (i = (ph->ntail < 8 ? ph->ntail : 8) - 1; i >= 0; i--)
+      k1 = (k1 << 8) | ph->tail[i];
+   if (ph->ntail > 8)
+      h2 ^= mix_k2(k2);
+   if (ph->ntail)
+      h1 ^= mix_k1(k1);
+
+   h1 ^= ph->len;
+   h2 ^= ph->len;
+   h1 += h2;
+   h2 += h1;
+   h1 = fmix64(h1);
+   h2 = fmix64(h2);
+   h1 += h2;
+   h2 += h1;
+
+   digest[0] = h1;
+   digest[1] = h2;
+}
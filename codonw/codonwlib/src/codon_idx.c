@@ -100,6 +100,7 @@ int base_sil_us(long *nncod, long *nnaa, double base_sil[], int *ds, int *da, GE
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int base_sil_us_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
 {
    double base_sil[4];
@@ -113,6 +114,7 @@ int base_sil_us_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
 
    return 0;
 }
+#endif
 
 /***************** Codon Adaptation Index   *************************/
 int cai(long *nncod, double *sigma, int *ds, CAI_STRUCT *pcai, GENETIC_CODE_STRUCT *pcu)
@@ -141,6 +143,7 @@ int cai(long *nncod, double *sigma, int *ds, CAI_STRUCT *pcai, GENETIC_CODE_STRU
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int cai_out(FILE *foutput, long *nncod, MENU_STRUCT *pm)
 {
    double sigma;
@@ -155,6 +158,7 @@ int cai_out(FILE *foutput, long *nncod, MENU_STRUCT *pm)
 
    return 0;
 }
+#endif
 
 /*****************     Codon Bias Index     **************************/
 int cbi(long *nncod, long *nnaa, float *fcbi, int *ds, int *da, GENETIC_CODE_STRUCT *pcu, FOP_STRUCT *pcbi)
@@ -163,24 +167,18 @@ int cbi(long *nncod, long *nnaa, float *fcbi, int *ds, int *da, GENETIC_CODE_STR
    long opt = 0;
    float exp_cod = 0.0F;
    int x;
-   static char first_call_cbi = true;
-   static char has_opt_info[22];
+   char has_opt_info[22];
 
-   if (first_call_cbi)
-   { /* have we been called already   */
-      /* initilise has_opt_info             */
-      for (x = 1; x < 22; x++)
-         has_opt_info[x] = 0;
+   /* initilise has_opt_info for this code and set of optimal codons       */
+   for (x = 0; x < 22; x++)
+      has_opt_info[x] = 0;
 
-      for (x = 1; x < 65; x++)
-      {
-         if (pcu->ca[x] == 11 || *(ds + x) == 1)
-            continue;
-         if (pcbi->fop_cod[x] == 3)
-            has_opt_info[pcu->ca[x]]++;
-      }
-
-      first_call_cbi = false; /*      this won't be called again      */
+   for (x = 1; x < 65; x++)
+   {
+      if (pcu->ca[x] == 11 || *(ds + x) == 1)
+         continue;
+      if (pcbi->fop_cod[x] == 3)
+         has_opt_info[pcu->ca[x]]++;
    }
 
    for (x = 1; x < 65; x++)
@@ -199,12 +197,14 @@ int cbi(long *nncod, long *nnaa, float *fcbi, int *ds, int *da, GENETIC_CODE_STR
          tot_cod += *(nncod + x);
          break;
       default:
+#ifndef CODONW_NO_STDIO
          fprintf(stderr, " Serious error in CBI information found"
                          " an illegal CBI value of %c for codon %i"
                          " permissible values are \n 1 for non-optimal"
                          " codons\n 2 for common codons\n"
                          " 3 for optimal codons\n",
                  pcbi->fop_cod[x], x);
+#endif
          return 1;
       } /*                   end of switch     */
    }    /*                   for (    )        */
@@ -217,6 +217,7 @@ int cbi(long *nncod, long *nnaa, float *fcbi, int *ds, int *da, GENETIC_CODE_STR
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int cbi_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
 {
    float fcbi;
@@ -231,6 +232,7 @@ int cbi_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
 
    return 0;
 }
+#endif
 
 /****************** Frequency of OPtimal codons  ********************/
 int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STRUCT *pcu, FOP_STRUCT *pfop)
@@ -242,7 +244,7 @@ int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STR
    
    /* initilise has_opt_info             */
    bool has_opt_info[22];
-   for (x = 1; x < 22; x++)
+   for (x = 0; x < 22; x++)
       has_opt_info[x] = false;
    for (x = 1; x < 65; x++)
    {
@@ -273,6 +275,7 @@ int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STR
          nonopt += *(nncod + x);
          break;
       default:
+#ifndef CODONW_NO_STDIO
          fprintf(stderr, " Serious error in fop information found"
                          " an illegal fop value of %c for codon %i"
                          " permissible values are \n 1 for non-optimal"
@@ -280,6 +283,7 @@ int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STR
                          " 3 for optimal codons\n",
                  pfop->fop_cod[x], x);
          fprintf(stderr, "opt %ld, std %ld, nonopt %ld\n", opt, std, nonopt);
+#endif
          return 1;
       }
    }
@@ -295,6 +299,7 @@ int fop(long *nncod, float *ffop, int *ds, bool factor_in_rare, GENETIC_CODE_STR
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int fop_out(FILE *foutput, long *nncod, MENU_STRUCT *pm) {
    float ffop;
 
@@ -309,6 +314,7 @@ int fop_out(FILE *foutput, long *nncod, MENU_STRUCT *pm) {
 
    return 0;
 }
+#endif
 
 /***************  Effective Number of Codons   *********************/
 int enc(long *nncod, long *nnaa, float *enc_tot, int *da, GENETIC_CODE_STRUCT *pcu)
@@ -380,11 +386,7 @@ int enc(long *nncod, long *nnaa, float *enc_tot, int *da, GENETIC_CODE_STRUCT *p
             /* special case                      */
             averb = (totb[2] / numaa[2] + totb[4] / numaa[4]) * 0.5;
          else
-         {
-            fprintf(stderr, "%i amino acids with %i synonymous codons\n", numaa[z], z);
-            fprintf(stderr, "\t -- Nc was not calculated\n");
-            return 1;
-         }
+            return 1; /* Nc can not be calculated */
          /* the calculation                   */
          *enc_tot += (float)fold[z] / (float)averb;
          if (*enc_tot > 61)
@@ -395,6 +397,7 @@ int enc(long *nncod, long *nnaa, float *enc_tot, int *da, GENETIC_CODE_STRUCT *p
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int enc_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
 {
    char sp = pm->separator;
@@ -403,12 +406,16 @@ int enc_out(FILE *foutput, long *nncod, long *nnaa, MENU_STRUCT *pm)
    int retval = enc(nncod, nnaa, &enc_tot, pm->da, pm->pcu);
 
    if (retval == 1)
+   {
+      fprintf(stderr, "\t -- Nc was not calculated\n");
       fprintf(foutput, "*****%c", sp);
+   }
    else
       fprintf(foutput, "%5.2f%c", enc_tot, sp);
       
    return 0;
 }
+#endif
 
 
 /*********************  Hydropathy        **********************************/
@@ -433,6 +440,7 @@ int hydro(long *nnaa, float *hydro, float hydro_ref[22])
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int hydro_out(FILE *foutput, long *nnaa, char* title, MENU_STRUCT *pm)
 {
    float out;
@@ -449,6 +457,7 @@ int hydro_out(FILE *foutput, long *nnaa, char* title, MENU_STRUCT *pm)
    return 0;
 
 }
+#endif
 
 /**************** Aromaticity ***********************************************/
 int aromo(long *nnaa, float *aromo, int aromo_ref[22])
@@ -471,6 +480,7 @@ int aromo(long *nnaa, float *aromo, int aromo_ref[22])
    return 0;
 }
 
+#ifndef CODONW_NO_STDIO
 int aromo_out(FILE *foutput, long *nnaa, char* title, MENU_STRUCT *pm)
 {
    float out;
@@ -485,4 +495,5 @@ int aromo_out(FILE *foutput, long *nnaa, char* title, MENU_STRUCT *pm)
       
    fprintf(foutput, "%8.6f%c", out, sp);
    return 0;
-}
\ No newline at end of file
+}
+#endif
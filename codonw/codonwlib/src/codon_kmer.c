@@ -0,0 +1,325 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains counts of words of k bases (k-mers) by frame, the
+generalisation of dinuc_count. The last k bases are kept as a rolling word
+of 2 bits per base (T=0, C=1, A=2, G=3, so k-mers sort as the dinucleotides
+of dinuc_count do) and a run length of standard bases, so that k-mers with
+a non-standard base are skipped. Each k-mer is counted in one of three
+frames, either
+
+  by position   the codon position (0, 1, 2) of its first base, or
+  by count      the No. of k-mers counted before it, mod 3, as dinuc_feed
+                does (for k = 2 this reproduces dinuc_count exactly)
+
+Counts go to a dense table of 3 x 4^k, or for larger k to a hash table of
+the k-mers seen (open addressing, linear probing).
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#define KMER_BLOCK 4096
+
+/******************  Hash table             *******************************/
+/* kmer_table_init allocates a table of at least cap slots, which grows   */
+/* as it fills. kmer_table_clear empties it for reuse. Return 1 if memory */
+/* ran out                                                                */
+/**************************************************************************/
+int kmer_table_init(KMER_TABLE_STRUCT *pt, long cap)
+{
+   long c = 64;
+
+   while (c < cap)
+      c <<= 1;
+   pt->cap = c;
+   pt->n = 0;
+   pt->key = malloc(c * sizeof(uint64_t));
+   pt->count = malloc(c * sizeof(*pt->count));
+   pt->used = calloc(c, 1);
+   if (!pt->key || !pt->count || !pt->used)
+   {
+      kmer_table_free(pt);
+      return 1;
+   }
+   return 0;
+}
+
+void kmer_table_clear(KMER_TABLE_STRUCT *pt)
+{
+   memset(pt->used, 0, pt->cap);
+   pt->n = 0;
+}
+
+void kmer_table_free(KMER_TABLE_STRUCT *pt)
+{
+   free(pt->key);
+   free(pt->count);
+   free(pt->used);
+   pt->key = NULL;
+   pt->count = NULL;
+   pt->used = NULL;
+   pt->cap = pt->n = 0;
+}
+
+static inline long kmer_slot(const KMER_TABLE_STRUCT *pt, uint64_t key)
+{
+   uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+   long s = (long)(h >> 17) & (pt->cap - 1);
+
+   while (pt->used[s] && pt->key[s] != key)
+      s = (s + 1) & (pt->cap - 1);
+   return s;
+}
+
+static int kmer_grow(KMER_TABLE_STRUCT *pt)
+{
+   KMER_TABLE_STRUCT bigger;
+   long s, t;
+
+   if (kmer_table_init(&bigger, pt->cap * 2))
+      return 1;
+   for (s = 0; s < pt->cap; s++)
+      if (pt->used[s])
+      {
+         t = kmer_slot(&bigger, pt->key[s]);
+         bigger.key[t] = pt->key[s];
+         bigger.used[t] = 1;
+         memcpy(bigger.count[t], pt->count[s], sizeof(*pt->count));
+      }
+   bigger.n = pt->n;
+   kmer_table_free(pt);
+   *pt = bigger;
+   return 0;
+}
+
+/******************  Count                  *******************************/
+/* Adds the k-mers of len bases of seq to dense (frame f of k-mer w at    */
+/* dense[f * 4^k + w]) or, if dense is NULL, to the table pt. k is 1 to   */
+/* KMER_MAX_K. Returns 1 if the table could not grow                      */
+/**************************************************************************/
+int kmer_feed(const char *seq, long long len, int k, int by_count, long *dense, KMER_TABLE_STRUCT *pt)
+{
+   unsigned char codes[KMER_BLOCK];
+   uint64_t mask = (k == 32) ? ~0ULL : (1ULL << (2 * k)) - 1;
+   uint64_t word = 0;
+   long long i, p, counted = 0;
+   long m, j, s, nk = dense ? 1L << (2 * k) : 0;
+   int run = 0, f;
+
+   for (i = 0; i < len; i += m)
+   {
+      m = (long)(len - i < KMER_BLOCK ? len - i : KMER_BLOCK);
+      base_codes(seq + i, m, codes);
+
+      for (j = 0; j < m; j++)
+      {
+         if (!codes[j])
+         {
+            run = 0;
+            continue;
+         }
+         word = ((word << 2) | (uint64_t)(codes[j] - 1)) & mask;
+         if (++run < k)
+            continue;
+
+         p = i + j - k + 1; /* first base of the k-mer            */
+         f = (int)((by_count ? counted : p) % 3);
+         counted++;
+         if (dense)
+            dense[f * nk + (long)word]++;
+         else
+         {
+            if (2 * (pt->n + 1) > pt->cap && kmer_grow(pt))
+               return 1;
+            s = kmer_slot(pt, word);
+            if (!pt->used[s])
+            {
+               pt->key[s] = word;
+               pt->used[s] = 1;
+               memset(pt->count[s], 0, sizeof(*pt->count));
+               pt->n++;
+            }
+            pt->count[s][f]++;
+         }
+      }
+   }
+   return 0;
+}
+
+/******************  Many sequences         *******************************/
+/* kmer_seqs counts n sequences into dense rows of 3 x 4^k, and           */
+/* kmer_seqs_sparse into pc as (row, k-mer, counts by frame) of the       */
+/* k-mers each row has, in order of row and k-mer, which kmer_coo_free    */
+/* releases. Return -1 if memory ran out                                  */
+/**************************************************************************/
+typedef struct
+{
+   const char **seqs;
+   const long long *lens;
+   int k, by_count;
+   long *dense;              /* kmer_seqs                         */
+   long *nrow;               /* kmer_seqs_sparse: No. of k-mers,  */
+   uint64_t **rkey;          /* k-mers and counts of each row     */
+   long (**rcount)[3];
+   pthread_mutex_t lock;
+   int failed;
+} KMER_JOB;
+
+static void dense_rows(long lo, long hi, void *ctx)
+{
+   KMER_JOB *pj = ctx;
+   long nk = 3L << (2 * pj->k), i;
+
+   for (i = lo; i < hi; i++)
+      kmer_feed(pj->seqs[i], pj->lens[i], pj->k, pj->by_count, pj->dense + i * nk, NULL);
+}
+
+int kmer_seqs(long n, const char **seqs, const long long *lens, int k, int by_count, long *dense, int threads)
+{
+   KMER_JOB job = {.seqs = seqs, .lens = lens, .k = k, .by_count = by_count, .dense = dense};
+
+   memset(dense, 0, n * (3L << (2 * k)) * sizeof(long));
+   return parallel_rows(n, threads, dense_rows, &job);
+}
+
+static int key_order(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+   return (x > y) - (x < y);
+}
+
+static void sparse_rows(long lo, long hi, void *ctx)
+{
+   KMER_JOB *pj = ctx;
+   KMER_TABLE_STRUCT table;
+   uint64_t *order = NULL;
+   long i, s, r;
+   int failed = kmer_table_init(&table, 1024);
+
+   for (i = lo; i < hi && !failed; i++)
+   {
+      kmer_table_clear(&table);
+      failed = kmer_feed(pj->seqs[i], pj->lens[i], pj->k, pj->by_count, NULL, &table);
+      if (failed)
+         break;
+
+      /* k-mers in order, each followed by its slot                      */
+      free(order);
+      order = malloc(2 * table.n * sizeof(uint64_t) + 1);
+      pj->rkey[i] = malloc(table.n * sizeof(uint64_t) + 1);
+      pj->rcount[i] = malloc(table.n * sizeof(long[3]) + 1);
+      if (!order || !pj->rkey[i] || !pj->rcount[i])
+      {
+         failed = 1;
+         break;
+      }
+      for (s = 0, r = 0; s < table.cap; s++)
+         if (table.used[s])
+         {
+            order[2 * r] = table.key[s];
+            order[2 * r++ + 1] = (uint64_t)s;
+         }
+      qsort(order, table.n, 2 * sizeof(uint64_t), key_order);
+      for (r = 0; r < table.n; r++)
+      {
+         pj->rkey[i][r] = order[2 * r];
+         memcpy(pj->rcount[i][r], table.count[order[2 * r + 1]], sizeof(long[3]));
+      }
+      pj->nrow[i] = table.n;
+   }
+
+   free(order);
+   kmer_table_free(&table);
+   if (failed)
+   {
+      pthread_mutex_lock(&pj->lock);
+      pj->failed = 1;
+      pthread_mutex_unlock(&pj->lock);
+   }
+}
+
+int kmer_seqs_sparse(long n, const char **seqs, const long long *lens, int k, int by_count, KMER_COO_STRUCT *pc, int threads)
+{
+   KMER_JOB job = {.seqs = seqs, .lens = lens, .k = k, .by_count = by_count};
+   long i, r, at;
+   int ret = -1;
+
+   memset(pc, 0, sizeof(KMER_COO_STRUCT));
+   job.nrow = calloc(n + 1, sizeof(long));
+   job.rkey = calloc(n + 1, sizeof(uint64_t *));
+   job.rcount = calloc(n + 1, sizeof(long (*)[3]));
+   pthread_mutex_init(&job.lock, NULL);
+   job.failed = 0;
+
+   if (job.nrow && job.rkey && job.rcount)
+   {
+      parallel_rows(n, threads, sparse_rows, &job);
+      if (!job.failed)
+      {
+         for (i = 0; i < n; i++)
+            pc->n += job.nrow[i];
+         pc->row = malloc(pc->n * sizeof(long) + 1);
+         pc->kmer = malloc(pc->n * sizeof(uint64_t) + 1);
+         pc->count = malloc(pc->n * sizeof(long[3]) + 1);
+         if (pc->row && pc->kmer && pc->count)
+         {
+            for (i = 0, at = 0; i < n; i++)
+               for (r = 0; r < job.nrow[i]; r++, at++)
+               {
+                  pc->row[at] = i;
+                  pc->kmer[at] = job.rkey[i][r];
+                  memcpy(pc->count[at], job.rcount[i][r], sizeof(long[3]));
+               }
+            ret = 0;
+         }
+         else
+            kmer_coo_free(pc);
+      }
+   }
+
+   for (i = 0; job.rkey && job.rcount && i < n; i++)
+   {
+      free(job.rkey[i]);
+      free(job.rcount[i]);
+   }
+   free(job.nrow);
+   free(job.rkey);
+   free(job.rcount);
+   pthread_mutex_destroy(&job.lock);
+   return ret;
+}
+
+void kmer_coo_free(KMER_COO_STRUCT *pc)
+{
+   free(pc->row);
+   free(pc->kmer);
+   free(pc->count);
+   memset(pc, 0, sizeof(KMER_COO_STRUCT));
+}
@@ -0,0 +1,247 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains the embeddable interface of libcodonw (libcodonw.h):
+contexts that hold a genetic code with the reference values of the
+indices, and counting and scoring of single sequences or of batches of
+them into caller structs. It uses neither the menu globals nor stdio, so
+the library is built with CODONW_NO_STDIO.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../include/codonW.h"
+#include "../include/libcodonw.h"
+
+struct codonw_ctx
+{
+   GENETIC_CODE_STRUCT code;
+   CODE_PLAN_STRUCT plan;
+   CAI_STRUCT cai;
+   INDEX_PLAN_STRUCT pi;
+};
+
+/******************  NCBI codon order       *******************************/
+/* Code of the k-th codon of the NCBI order (TTT, TTC, TTA, TTG, TCT, ..) */
+/**************************************************************************/
+static int ncbi_icode(int k)
+{
+   return (k >> 4) * 16 + ((k >> 2) & 3) + 1 + (k & 3) * 4;
+}
+
+/******************  Contexts               *******************************/
+void codonw_options_default(codonw_options *opt)
+{
+   memset(opt, 0, sizeof(codonw_options));
+}
+
+int codonw_create(const codonw_options *opt, codonw_ctx **ctx)
+{
+   codonw_ctx *pc;
+   int k, a;
+
+   if (!opt || !ctx)
+      return CODONW_EINVAL;
+   *ctx = NULL;
+   if (opt->genetic_code < 0 || opt->genetic_code >= NUM_GENETIC_CODES ||
+       opt->cai_ref < 0 || opt->cai_ref >= NUM_CAI_SPECIES ||
+       opt->fop_ref < 0 || opt->fop_ref >= NUM_FOP_SPECIES ||
+       opt->cbi_ref < 0 || opt->cbi_ref >= NUM_FOP_SPECIES)
+      return CODONW_EINVAL;
+
+   pc = calloc(1, sizeof(codonw_ctx));
+   if (!pc)
+      return CODONW_ENOMEM;
+
+   pc->code = cu_ref[opt->genetic_code];
+   if (opt->translation)
+   { /* one letter amino acids, X not allowed  */
+      if (strlen(opt->translation) != 64)
+         goto invalid;
+      pc->code.des = "User supplied genetic code";
+      pc->code.typ = "";
+      pc->code.ca[0] = 0;
+      for (k = 0; k < 64; k++)
+      {
+         for (a = 1; a < 22; a++)
+            if (amino_acids.aa1[a][0] == opt->translation[k])
+               break;
+         if (a == 22)
+            goto invalid;
+         pc->code.ca[ncbi_icode(k)] = a;
+      }
+   }
+
+   pc->cai = cai_ref[opt->cai_ref];
+   if (opt->cai_w)
+   {
+      pc->cai.des = "User supplied w values";
+      pc->cai.ref = "";
+      for (k = 0; k < 64; k++)
+      {
+         if (!(opt->cai_w[k] >= 0.0 && opt->cai_w[k] <= 1.0))
+            goto invalid;
+         pc->cai.cai_val[ncbi_icode(k)] = (float)opt->cai_w[k];
+      }
+   }
+
+   code_plan_init(&pc->plan, &pc->code);
+   index_plan_init(&pc->pi, &pc->plan, &pc->cai, &fop_ref[opt->fop_ref],
+                   &fop_ref[opt->cbi_ref], &amino_prop, opt->factor_in_rare != 0);
+   *ctx = pc;
+   return CODONW_OK;
+
+invalid:
+   free(pc);
+   return CODONW_EINVAL;
+}
+
+void codonw_destroy(codonw_ctx *ctx)
+{
+   free(ctx);
+}
+
+/******************  Counting and scoring   *******************************/
+/* The context is only read, through pointers the kernels take as not    */
+/* const                                                                 */
+/**************************************************************************/
+int codonw_count(const codonw_ctx *ctx, const char *seq, size_t len, codonw_counts *counts)
+{
+   CODON_STREAM_STRUCT stream;
+
+   if (!ctx || !counts || (!seq && len))
+      return CODONW_EINVAL;
+
+   codon_stream_init(&stream, (GENETIC_CODE_STRUCT *)&ctx->code, false);
+   codon_stream_feed(&stream, seq, (long long)len);
+   codon_stream_finish(&stream);
+
+   memcpy(counts->ncod, stream.ncod, sizeof(counts->ncod));
+   memcpy(counts->naa, stream.naa, sizeof(counts->naa));
+   counts->codon_tot = stream.codon_tot;
+   counts->valid_stops = stream.valid_stops;
+   return CODONW_OK;
+}
+
+int codonw_metrics_of(const codonw_ctx *ctx, const codonw_counts *counts, codonw_metrics *metrics)
+{
+   static const int which[NUM_INDICES] = {
+      INDEX_CAI, INDEX_FOP, INDEX_CBI, INDEX_ENC, INDEX_GRAVY, INDEX_AROMO,
+      INDEX_GC, INDEX_GC3S, INDEX_L_SYM, INDEX_L_AA,
+      INDEX_T3S, INDEX_C3S, INDEX_A3S, INDEX_G3S};
+   double v[NUM_INDICES];
+
+   if (!ctx || !counts || !metrics)
+      return CODONW_EINVAL;
+
+   batch_indices(1, counts->ncod, counts->naa, COUNT_LONG, which, NUM_INDICES, v,
+                 NUM_INDICES, (INDEX_PLAN_STRUCT *)&ctx->pi, 1);
+   metrics->cai = v[INDEX_CAI];
+   metrics->fop = v[INDEX_FOP];
+   metrics->cbi = v[INDEX_CBI];
+   metrics->nc = v[INDEX_ENC];
+   metrics->gravy = v[INDEX_GRAVY];
+   metrics->aromo = v[INDEX_AROMO];
+   metrics->gc = v[INDEX_GC];
+   metrics->gc3s = v[INDEX_GC3S];
+   metrics->l_sym = v[INDEX_L_SYM];
+   metrics->l_aa = v[INDEX_L_AA];
+   metrics->t3s = v[INDEX_T3S];
+   metrics->c3s = v[INDEX_C3S];
+   metrics->a3s = v[INDEX_A3S];
+   metrics->g3s = v[INDEX_G3S];
+   return CODONW_OK;
+}
+
+int codonw_score(const codonw_ctx *ctx, const char *seq, size_t len, codonw_counts *counts, codonw_metrics *metrics)
+{
+   codonw_counts local;
+   int ret;
+
+   if (!counts)
+      counts = &local;
+   if ((ret = codonw_count(ctx, seq, len, counts)))
+      return ret;
+   return metrics ? codonw_metrics_of(ctx, counts, metrics) : CODONW_OK;
+}
+
+/******************  Batches                *******************************/
+typedef struct
+{
+   const codonw_ctx *ctx;
+   const char *const *seqs;
+   const size_t *lens;
+   codonw_counts *counts;
+   codonw_metrics *metrics;
+} LIB_JOB;
+
+static void lib_rows(long lo, long hi, void *ctx)
+{
+   LIB_JOB *pj = ctx;
+   long i;
+
+   for (i = lo; i < hi; i++)
+      codonw_score(pj->ctx, pj->seqs[i], pj->lens[i],
+                   pj->counts ? &pj->counts[i] : NULL,
+                   pj->metrics ? &pj->metrics[i] : NULL);
+}
+
+int codonw_score_batch(const codonw_ctx *ctx, size_t n, const char *const *seqs, const size_t *lens, codonw_counts *counts, codonw_metrics *metrics, int threads)
+{
+   LIB_JOB job = {ctx, seqs, lens, counts, metrics};
+   size_t i;
+
+   if (!ctx || (n && (!seqs || !lens)) || n > LONG_MAX)
+      return CODONW_EINVAL;
+   for (i = 0; i < n; i++)
+      if (!seqs[i] && lens[i])
+         return CODONW_EINVAL;
+
+   parallel_rows((long)n, threads, lib_rows, &job);
+   return CODONW_OK;
+}
+
+/******************  Messages               *******************************/
+const char *codonw_strerror(int err)
+{
+   switch (err)
+   {
+   case CODONW_OK:
+      return "Success";
+   case CODONW_EINVAL:
+      return "Invalid argument";
+   case CODONW_ENOMEM:
+      return "Out of memory";
+   default:
+      return "Unknown error";
+   }
+}
+
+const char *codonw_version(void)
+{
+   return CODONW_VERSION;
+}
@@ -0,0 +1,316 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains sequences packed at 2 bits per base (T=0, C=1, A=2,
+G=3, 32 bases to a 64 bit word, the first in the lowest bits), a quarter
+of the memory of one byte per base. Anything else is kept in two sorted
+run lists, so that the sequence is restored exactly:
+
+  exc   runs of characters other than T, U, C, A, G (any case), whose
+        characters are kept as they are, and which count as
+        non-standard bases
+  low   runs of lower case t, u, c, a, g
+  rna   runs of U (packed as T)
+
+A sequence is packed as it is fed in chunks (e.g. by the codon stream as
+it counts), and codons, dinucleotides and the G+C content of windows are
+then calculated from the packed words without unpacking. G and C are the
+codes with the low bit set, so G+C is a masked popcount.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "../include/codonW.h"
+
+#define LOW_BITS 0x5555555555555555ULL /* low bit of each base        */
+
+/******************  Packing                *******************************/
+/* packed_init empties a packed sequence and packed_free releases it.     */
+/* packed_feed appends len characters of chunk and returns 1 if memory    */
+/* ran out                                                                */
+/**************************************************************************/
+void packed_init(PACKED_SEQ_STRUCT *pp)
+{
+   memset(pp, 0, sizeof(PACKED_SEQ_STRUCT));
+}
+
+void packed_free(PACKED_SEQ_STRUCT *pp)
+{
+   free(pp->words);
+   free(pp->exc);
+   free(pp->exc_chars);
+   free(pp->low);
+   free(pp->rna);
+   packed_init(pp);
+}
+
+/* adds base i to a list of runs, extending the last run if it ends there */
+static int run_add(long long (**runs)[2], long *n, long *cap, long long i)
+{
+   if (*n && (*runs)[*n - 1][0] + (*runs)[*n - 1][1] == i)
+   {
+      (*runs)[*n - 1][1]++;
+      return 0;
+   }
+   if (*n == *cap)
+   {
+      long c = *cap ? 2 * *cap : 16;
+      long long (*bigger)[2] = realloc(*runs, c * sizeof(**runs));
+      if (!bigger)
+         return 1;
+      *runs = bigger;
+      *cap = c;
+   }
+   (*runs)[*n][0] = i;
+   (*runs)[(*n)++][1] = 1;
+   return 0;
+}
+
+int packed_feed(PACKED_SEQ_STRUCT *pp, const char *chunk, long long len)
+{
+   long long need = (pp->len + len) / 32 + 2, i, at;
+   unsigned char c;
+   int b;
+
+   if (need > pp->nwords)
+   {
+      long long n = pp->nwords ? pp->nwords : 64;
+      while (n < need)
+         n *= 2;
+      uint64_t *bigger = realloc(pp->words, n * sizeof(uint64_t));
+      if (!bigger)
+         return 1;
+      memset(bigger + pp->nwords, 0, (n - pp->nwords) * sizeof(uint64_t));
+      pp->words = bigger;
+      pp->nwords = n;
+   }
+
+   for (i = 0; i < len; i++)
+   {
+      at = pp->len + i;
+      c = (unsigned char)chunk[i];
+      b = base_code[c];
+      if (b)
+      {
+         pp->words[at >> 5] |= (uint64_t)(b - 1) << (2 * (at & 31));
+         if (c >= 'a' && run_add(&pp->low, &pp->nlow, &pp->low_cap, at))
+            return 1;
+         if ((c == 'U' || c == 'u') && run_add(&pp->rna, &pp->nrna, &pp->rna_cap, at))
+            return 1;
+         continue;
+      }
+
+      if (run_add(&pp->exc, &pp->nexc, &pp->exc_cap, at))
+         return 1;
+      if (pp->nexc_chars == pp->exc_chars_cap)
+      {
+         long long n = pp->exc_chars_cap ? 2 * pp->exc_chars_cap : 64;
+         char *bigger = realloc(pp->exc_chars, n);
+         if (!bigger)
+            return 1;
+         pp->exc_chars = bigger;
+         pp->exc_chars_cap = n;
+      }
+      pp->exc_chars[pp->nexc_chars++] = (char)c;
+   }
+   pp->len += len;
+   return 0;
+}
+
+/* code (0..3) of base i                                                  */
+static inline int packed_base(const PACKED_SEQ_STRUCT *pp, long long i)
+{
+   return (int)(pp->words[i >> 5] >> (2 * (i & 31))) & 3;
+}
+
+/* first run of runs[0..n-1] that ends after base i                       */
+static long run_after(long long (*runs)[2], long n, long long i)
+{
+   long lo = 0, hi = n;
+
+   while (lo < hi)
+   {
+      long mid = (lo + hi) / 2;
+      if (runs[mid][0] + runs[mid][1] <= i)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+/******************  Unpacking              *******************************/
+/* Writes the characters of bases start..end-1 to out, as they were fed   */
+/**************************************************************************/
+void packed_unpack(const PACKED_SEQ_STRUCT *pp, long long start, long long end, char *out)
+{
+   static const char upper[4] = {'T', 'C', 'A', 'G'};
+   long long i, j, k, c;
+   long r;
+
+   for (i = start; i < end; i++)
+      out[i - start] = upper[packed_base(pp, i)];
+
+   r = run_after(pp->rna, pp->nrna, start);
+   for (; r < pp->nrna && pp->rna[r][0] < end; r++)
+      for (j = pp->rna[r][0], k = j + pp->rna[r][1]; j < k; j++)
+         if (j >= start && j < end)
+            out[j - start] = 'U';
+
+   r = run_after(pp->low, pp->nlow, start);
+   for (; r < pp->nlow && pp->low[r][0] < end; r++)
+      for (j = pp->low[r][0], k = j + pp->low[r][1]; j < k; j++)
+         if (j >= start && j < end)
+            out[j - start] += 'a' - 'A';
+
+   /* characters of runs before r are ahead of those of run r            */
+   r = run_after(pp->exc, pp->nexc, start);
+   for (k = 0, c = 0; k < r; k++)
+      c += pp->exc[k][1];
+   for (; r < pp->nexc && pp->exc[r][0] < end; r++)
+      for (j = pp->exc[r][0], k = j + pp->exc[r][1]; j < k; j++, c++)
+         if (j >= start && j < end)
+            out[j - start] = pp->exc_chars[c];
+}
+
+/******************  Codons                 *******************************/
+/* Adds the complete codons of bases start..end-1 to ncod and naa, as     */
+/* tally_codons would for the unpacked bases, and returns the code of the */
+/* last one. Codons with a non-standard base are codon 0                  */
+/**************************************************************************/
+int packed_tally(const PACKED_SEQ_STRUCT *pp, long long start, long long end, long ncod[65], long naa[22], GENETIC_CODE_STRUCT *pcu)
+{
+   long block[65] = {0};
+   long r = run_after(pp->exc, pp->nexc, start);
+   long long p;
+   uint64_t v;
+   int sh, icode = 0, x;
+
+   for (p = start; p + 3 <= end; p += 3)
+   {
+      while (r < pp->nexc && pp->exc[r][0] + pp->exc[r][1] <= p)
+         r++;
+      if (r < pp->nexc && pp->exc[r][0] < p + 3)
+         icode = 0;
+      else
+      {
+         sh = 2 * (int)(p & 31);
+         v = pp->words[p >> 5] >> sh;
+         if (sh > 58)
+            v |= pp->words[(p >> 5) + 1] << (64 - sh);
+         icode = (int)(v & 3) * 16 + (int)((v >> 2) & 3) + (int)((v >> 4) & 3) * 4 + 1;
+      }
+      block[icode]++;
+   }
+
+   for (x = 0; x < 65; x++)
+   {
+      ncod[x] += block[x];
+      naa[pcu->ca[x]] += block[x];
+   }
+   return icode;
+}
+
+/******************  Dinucleotides          *******************************/
+/* Adds the dinucleotides of the whole sequence to din as dinuc_count     */
+/* does for the unpacked bases                                            */
+/**************************************************************************/
+void packed_dinuc(const PACKED_SEQ_STRUCT *pp, long din[3][16])
+{
+   long r = 0;
+   long long i;
+   int last = -1, cur, fram = 0;
+
+   for (i = 0; i < pp->len; i++)
+   {
+      while (r < pp->nexc && pp->exc[r][0] + pp->exc[r][1] <= i)
+         r++;
+      if (r < pp->nexc && pp->exc[r][0] <= i)
+      {  /* skip the rest of the run                                    */
+         i = pp->exc[r][0] + pp->exc[r][1] - 1;
+         last = -1;
+         continue;
+      }
+      cur = packed_base(pp, i);
+      if (last >= 0)
+      {
+         din[fram][last * 4 + cur]++;
+         if (++fram == 3)
+            fram = 0;
+      }
+      last = cur;
+   }
+}
+
+/******************  Windows                *******************************/
+/* G+C and No. of standard bases of nwin windows of width bases, the k-th */
+/* starting at base k * step. Windows are cut short at the end            */
+/**************************************************************************/
+/* No. of G or C among bases a..b-1, non-standard bases included         */
+static long long packed_gc(const PACKED_SEQ_STRUCT *pp, long long a, long long b)
+{
+   long long n = 0, wa, wb, w;
+   uint64_t m;
+
+   if (a >= b)
+      return 0;
+   wa = a >> 5;
+   wb = (b - 1) >> 5;
+   for (w = wa; w <= wb; w++)
+   {
+      m = LOW_BITS;
+      if (w == wa)
+         m &= ~0ULL << (2 * (a & 31));
+      if (w == wb && (b & 31))
+         m &= ~0ULL >> (64 - 2 * (b & 31));
+      n += __builtin_popcountll(pp->words[w] & m);
+   }
+   return n;
+}
+
+void packed_windows(const PACKED_SEQ_STRUCT *pp, long long width, long long step, long nwin, long long *gc, long long *valid)
+{
+   long long a, b, j, lo, hi;
+   long k, r;
+
+   for (k = 0; k < nwin; k++)
+   {
+      a = k * step;
+      b = a + width < pp->len ? a + width : pp->len;
+      gc[k] = packed_gc(pp, a, b);
+      valid[k] = b - a;
+
+      /* bases of exc runs in the window, which were packed as T        */
+      for (r = run_after(pp->exc, pp->nexc, a); r < pp->nexc && pp->exc[r][0] < b; r++)
+      {
+         lo = pp->exc[r][0] > a ? pp->exc[r][0] : a;
+         j = pp->exc[r][0] + pp->exc[r][1];
+         hi = j < b ? j : b;
+         valid[k] -= hi - lo;
+      }
+   }
+}
@@ -0,0 +1,167 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains codon usage as a function of position along the gene,
+summed over many genes in one pass (e.g. for the ramp of slowly
+translated codons at the start of genes). Codon i of a gene of n complete
+codons falls into bin
+
+  PROFILE_START     i / width, codons counted from the first
+  PROFILE_END       (n - 1 - i) / width, codons counted from the last
+  PROFILE_RELATIVE  i * nbins / n, bins of equal fractions of the gene
+
+and codons beyond the last bin are left out. Each thread sums its own
+table of bins, which are added up at the end, and any index of the bins
+is then calculated from the table as from the counts of a gene.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#define PROFILE_BLOCK 4096 /* codons identified at once           */
+
+/******************  Profile                *******************************/
+/* Sums the codons of the n sequences into nbins rows of ncod and naa    */
+/* (as described above), and the No. of sequences with a codon in each   */
+/* bin into genes (unless NULL). Returns -1 if memory ran out             */
+/**************************************************************************/
+typedef struct
+{
+   const char **seqs;
+   const long long *lens;
+   GENETIC_CODE_STRUCT *pcu;
+   PROFILE_MODE mode;
+   long nbins;
+   long width;
+   long (*ncod)[65];
+   long *genes;
+   pthread_mutex_t lock;
+   int failed;
+} PROFILE_JOB;
+
+static long profile_bin(PROFILE_MODE mode, long long i, long long n, long nbins, long width)
+{
+   long long b;
+
+   if (mode == PROFILE_START)
+      b = i / width;
+   else if (mode == PROFILE_END)
+      b = (n - 1 - i) / width;
+   else
+      b = i * nbins / n;
+   return b < nbins ? (long)b : -1;
+}
+
+static void profile_rows(long lo, long hi, void *ctx)
+{
+   PROFILE_JOB *pj = ctx;
+   unsigned char codes[PROFILE_BLOCK];
+   long nb = pj->nbins, b, last, k, m;
+   long long i, n;
+   int x;
+
+   long (*ncod)[65] = calloc(nb, sizeof(*ncod));
+   long *genes = calloc(nb, sizeof(long));
+   if (!ncod || !genes)
+   {
+      free(ncod);
+      free(genes);
+      pthread_mutex_lock(&pj->lock);
+      pj->failed = 1;
+      pthread_mutex_unlock(&pj->lock);
+      return;
+   }
+
+   for (; lo < hi; lo++)
+   {
+      n = pj->lens[lo] / 3;
+      last = -1;
+      i = 0;
+      if (pj->mode == PROFILE_END && n > (long long)nb * pj->width)
+         i = n - (long long)nb * pj->width; /* before the last bin          */
+      for (; i < n; i += m)
+      {
+         m = (long)(n - i < PROFILE_BLOCK ? n - i : PROFILE_BLOCK);
+         codon_codes(pj->seqs[lo] + 3 * i, m, codes);
+         for (k = 0; k < m; k++)
+         {
+            b = profile_bin(pj->mode, i + k, n, nb, pj->width);
+            if (b < 0)
+               continue;
+            ncod[b][codes[k]]++;
+            if (b != last)
+            { /* bins are visited in order, so each once */
+               genes[b]++;
+               last = b;
+            }
+         }
+         if (pj->mode == PROFILE_START && (i + m) / pj->width >= nb)
+            break;   /* past the last bin                            */
+      }
+   }
+
+   pthread_mutex_lock(&pj->lock);
+   for (b = 0; b < nb; b++)
+   {
+      for (x = 0; x < 65; x++)
+         pj->ncod[b][x] += ncod[b][x];
+      pj->genes[b] += genes[b];
+   }
+   pthread_mutex_unlock(&pj->lock);
+   free(ncod);
+   free(genes);
+}
+
+int codon_profile(long n, const char **seqs, const long long *lens, GENETIC_CODE_STRUCT *pcu, PROFILE_MODE mode, long nbins, long width, long (*ncod)[65], long (*naa)[22], long *genes, int threads)
+{
+   PROFILE_JOB job = {.seqs = seqs, .lens = lens, .pcu = pcu, .mode = mode, .nbins = nbins,
+                      .width = width > 0 ? width : 1, .ncod = ncod};
+   long b;
+   int x, ret;
+
+   job.genes = calloc(nbins > 0 ? nbins : 1, sizeof(long));
+   if (!job.genes)
+      return -1;
+   memset(ncod, 0, nbins * sizeof(*ncod));
+   memset(naa, 0, nbins * sizeof(*naa));
+
+   pthread_mutex_init(&job.lock, NULL);
+   job.failed = 0;
+   if (nbins > 0)
+      parallel_rows(n, threads, profile_rows, &job);
+   ret = job.failed ? -1 : 0;
+   pthread_mutex_destroy(&job.lock);
+
+   for (b = 0; b < nbins; b++)
+      for (x = 0; x < 65; x++)
+         naa[b][pcu->ca[x]] += ncod[b][x];
+   if (genes)
+      memcpy(genes, job.genes, nbins * sizeof(long));
+   free(job.genes);
+   return ret;
+}
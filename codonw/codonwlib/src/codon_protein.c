@@ -0,0 +1,176 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains properties of the hypothetical translated gene product
+that depend only on its amino acid composition, calculated straight from
+amino acid counts (naa) as hydro and aromo are. Values per amino acid come
+from tables (PROTEIN_PROP_STRUCT and AMINO_PROP_STRUCT), and any number
+of further per amino acid scales may be averaged over the residues.
+
+  PROT_MW         average molecular weight
+  PROT_PI         isoelectric point, by bisection of the net charge
+  PROT_CHARGE     net charge at the pH of the plan
+  PROT_ALIPHATIC  aliphatic index (Ikai 1980)
+  PROT_EXTINCT    molar extinction at 280 nm, cysteines reduced
+  PROT_GRAVY      as hydro
+  PROT_AROMO      as aromo
+
+Stop codons and untranslatable codons are not residues. The pK of the
+termini do not depend on the residues there, as the order of the residues
+is not known.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../include/codonW.h"
+
+/* net charge of residues naa (tot of them) at pH                         */
+static double net_charge(const long naa[22], PROTEIN_PROP_STRUCT *ppp, double ph)
+{
+   double q = 1.0 / (pow(10.0, ph - ppp->pk_nterm) + 1.0) - 1.0 / (pow(10.0, ppp->pk_cterm - ph) + 1.0);
+   int i;
+
+   for (i = 1; i < 22; i++)
+      if (i != 11 && naa[i] && ppp->charge[i] > 0)
+         q += naa[i] / (pow(10.0, ph - ppp->pk[i]) + 1.0);
+      else if (i != 11 && naa[i] && ppp->charge[i] < 0)
+         q -= naa[i] / (pow(10.0, ppp->pk[i] - ph) + 1.0);
+   return q;
+}
+
+/******************  One row                *******************************/
+/* Writes the properties listed in which (PROT_*, or NUM_PROT + k for the */
+/* k-th scale of the plan) of the amino acid counts naa to out. All are   */
+/* NaN if there are no residues                                           */
+/**************************************************************************/
+void protein_row(const long naa[22], PROTEIN_PLAN_STRUCT *pp, const int *which, int nwhich, double *out)
+{
+   PROTEIN_PROP_STRUCT *ppp = pp->ppp;
+   double lo, hi, mid, v;
+   long tot = 0;
+   int i, w;
+
+   for (i = 1; i < 22; i++)
+      if (i != 11)
+         tot += naa[i];
+
+   for (w = 0; w < nwhich; w++)
+   {
+      v = 0.0;
+      if (!tot)
+         v = NAN;
+      else if (which[w] >= NUM_PROT)
+      {
+         const double *scale = pp->scale + (which[w] - NUM_PROT) * 22;
+         for (i = 1; i < 22; i++)
+            if (i != 11)
+               v += naa[i] * scale[i];
+         v /= tot;
+      }
+      else
+         switch (which[w])
+         {
+         case PROT_MW:
+            for (i = 1; i < 22; i++)
+               if (i != 11)
+                  v += naa[i] * ppp->mass[i];
+            v -= (tot - 1) * ppp->water;
+            break;
+         case PROT_PI: /* charge falls as pH rises            */
+            for (lo = 0.0, hi = 14.0; hi - lo > 1e-7;)
+            {
+               mid = 0.5 * (lo + hi);
+               if (net_charge(naa, ppp, mid) > 0)
+                  lo = mid;
+               else
+                  hi = mid;
+            }
+            v = 0.5 * (lo + hi);
+            break;
+         case PROT_CHARGE:
+            v = net_charge(naa, ppp, pp->ph);
+            break;
+         case PROT_ALIPHATIC:
+            for (i = 1; i < 22; i++)
+               if (i != 11)
+                  v += naa[i] * ppp->aliphatic[i];
+            v *= 100.0 / tot;
+            break;
+         case PROT_EXTINCT:
+            for (i = 1; i < 22; i++)
+               if (i != 11)
+                  v += naa[i] * ppp->extinct[i];
+            break;
+         case PROT_GRAVY:
+            for (i = 1; i < 22; i++)
+               if (i != 11)
+                  v += naa[i] * (double)pp->pap->hydro[i];
+            v /= tot;
+            break;
+         case PROT_AROMO:
+            for (i = 1; i < 22; i++)
+               if (i != 11)
+                  v += naa[i] * pp->pap->aromo[i];
+            v /= tot;
+            break;
+         }
+      out[w] = v;
+   }
+}
+
+/******************  Many rows              *******************************/
+/* protein_row of rows 0..n-1 of the amino acid count matrix naa, written */
+/* to out with rows out_stride apart, on threads                          */
+/**************************************************************************/
+typedef struct
+{
+   const void *naa;
+   COUNT_TYPE type;
+   PROTEIN_PLAN_STRUCT *pp;
+   const int *which;
+   int nwhich;
+   double *out;
+   long out_stride;
+} PROTEIN_JOB;
+
+static void protein_rows(long lo, long hi, void *ctx)
+{
+   PROTEIN_JOB *pj = ctx;
+   long naa[22], i;
+
+   for (i = lo; i < hi; i++)
+   {
+      count_row_get(pj->naa, pj->type, 22, i, naa);
+      protein_row(naa, pj->pp, pj->which, pj->nwhich, pj->out + i * pj->out_stride);
+   }
+}
+
+int protein_props(long n, const void *naa, COUNT_TYPE type, PROTEIN_PLAN_STRUCT *pp, const int *which, int nwhich, double *out, long out_stride, int threads)
+{
+   PROTEIN_JOB job = {naa, type, pp, which, nwhich, out, out_stride};
+   return parallel_rows(n, threads, protein_rows, &job);
+}
@@ -0,0 +1,197 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains an index of one long sequence that gives the codon
+usage of any range of it (e.g. exons or domains of a chromosome) without
+counting the range again. The code of the codon starting at every base
+is kept, along with the cumulative codon usage of each reading frame at
+checkpoints every step codons. A range is the difference of two prefix
+counts, each a checkpoint plus fewer than step codons.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "../include/codonW.h"
+
+/******************  Index build            *******************************/
+/* Indexes len bases of seq with a checkpoint every step codons. Returns  */
+/* 1 if memory could not be allocated                                     */
+/**************************************************************************/
+int codon_index_build(CODON_INDEX_STRUCT *px, const char *seq, long long len, int step)
+{
+   long long p;
+   long c, m;
+   int f;
+
+   memset(px, 0, sizeof(CODON_INDEX_STRUCT));
+   px->len = len;
+   px->step = step < 1 ? 1 : step;
+   px->nchk = (long)(len / 3 / px->step) + 1;
+
+   px->codes = malloc(len > 0 ? len : 1);
+   for (f = 0; f < 3; f++)
+      px->cum[f] = malloc(px->nchk * sizeof(long[65]));
+   if (!px->codes || !px->cum[0] || !px->cum[1] || !px->cum[2])
+   {
+      codon_index_free(px);
+      return 1;
+   }
+
+   /* base codes, then (in place) the code of the codon at each base      */
+   base_codes(seq, (long)len, px->codes);
+   for (p = 0; p < len; p++)
+   {
+      int b1 = px->codes[p];
+      int b2 = p + 1 < len ? px->codes[p + 1] : 0;
+      int b3 = p + 2 < len ? px->codes[p + 2] : 0;
+      px->codes[p] = (b1 && b2 && b3) ? (unsigned char)((b1 - 1) * 16 + b2 + (b3 - 1) * 4) : 0;
+   }
+
+   for (f = 0; f < 3; f++)
+   {
+      long run[65];
+
+      memset(run, 0, sizeof(run));
+      for (c = 0, m = 0; c < px->nchk; c++)
+      { /* m: codons of frame f counted so far */
+         for (; m < c * px->step; m++)
+            run[px->codes[f + 3 * (long long)m]]++;
+         memcpy(px->cum[f][c], run, sizeof(run));
+      }
+   }
+
+   return 0;
+}
+
+void codon_index_free(CODON_INDEX_STRUCT *px)
+{
+   int f;
+
+   free(px->codes);
+   for (f = 0; f < 3; f++)
+      free(px->cum[f]);
+   memset(px, 0, sizeof(CODON_INDEX_STRUCT));
+}
+
+/* adds sign * the usage of the first m codons of frame f to ncod        */
+static void prefix_add(CODON_INDEX_STRUCT *px, int f, long m, long sign, long ncod[65])
+{
+   long c = m / px->step;
+   long q;
+   int x;
+
+   for (x = 0; x < 65; x++)
+      ncod[x] += sign * px->cum[f][c][x];
+   for (q = c * px->step; q < m; q++)
+      ncod[px->codes[f + 3 * (long long)q]] += sign;
+}
+
+/******************  Index query            *******************************/
+/* Codon and amino acid usage of bases start..end-1 (0 based), exactly as */
+/* if they were counted on their own by codon_usage_tot. Returns 1 if the */
+/* range is not within the sequence                                       */
+/**************************************************************************/
+int codon_index_query(CODON_INDEX_STRUCT *px, long long start, long long end, GENETIC_CODE_STRUCT *pcu, long ncod[65], long naa[22], long *codon_tot, int *valid_stops)
+{
+   int f = (int)(start % 3);
+   long m0, nfull;
+   int x, icode = 0;
+
+   memset(ncod, 0, sizeof(long[65]));
+   memset(naa, 0, sizeof(long[22]));
+   *codon_tot = 0;
+   *valid_stops = 0;
+   if (start < 0 || end > px->len || start > end)
+      return 1;
+
+   m0 = (long)(start / 3);
+   nfull = (long)((end - start) / 3);
+
+   prefix_add(px, f, m0 + nfull, 1, ncod);
+   prefix_add(px, f, m0, -1, ncod);
+   for (x = 0; x < 65; x++)
+      naa[pcu->ca[x]] += ncod[x];
+   if (nfull)
+      icode = px->codes[start + 3 * (long long)(nfull - 1)];
+
+   if ((end - start) % 3)
+   {             /*if last codon was partial */
+      icode = 0; /*set icode to zero and     */
+      ncod[0]++; /*increment untranslated    */
+   }
+
+   *codon_tot = nfull;
+   *valid_stops = (nfull && pcu->ca[icode] == 11) ? 1 : 0;
+   return 0;
+}
+
+/******************  Index ranges           *******************************/
+/* Queries n ranges into count matrices on up to threads threads. Returns */
+/* the No. of ranges that were not within the sequence (left at zero),    */
+/* or -1 if memory could not be allocated                                 */
+/**************************************************************************/
+typedef struct
+{
+   CODON_INDEX_STRUCT *px;
+   const long long *starts;
+   const long long *ends;
+   GENETIC_CODE_STRUCT *pcu;
+   long (*ncod)[65];
+   long (*naa)[22];
+   long *codon_tot;
+   int *valid_stops;
+   char *bad;
+} RANGES_JOB;
+
+static void range_rows(long lo, long hi, void *ctx)
+{
+   RANGES_JOB *pj = ctx;
+   long i;
+
+   for (i = lo; i < hi; i++)
+      pj->bad[i] = (char)codon_index_query(pj->px, pj->starts[i], pj->ends[i], pj->pcu,
+                                           pj->ncod[i], pj->naa[i], &pj->codon_tot[i],
+                                           &pj->valid_stops[i]);
+}
+
+int codon_index_ranges(CODON_INDEX_STRUCT *px, long n, const long long *starts, const long long *ends, GENETIC_CODE_STRUCT *pcu, long (*ncod)[65], long (*naa)[22], long *codon_tot, int *valid_stops, int threads)
+{
+   RANGES_JOB job = {px, starts, ends, pcu, ncod, naa, codon_tot, valid_stops, NULL};
+   long i;
+   int nbad = 0;
+
+   job.bad = calloc(n > 0 ? n : 1, 1);
+   if (!job.bad)
+      return -1;
+
+   parallel_rows(n, threads, range_rows, &job);
+   for (i = 0; i < n; i++)
+      nbad += job.bad[i];
+   free(job.bad);
+
+   return nbad;
+}
@@ -0,0 +1,281 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains the scoring of many genes against many references of
+CAI (w values) or Fop (optimal codons) at once. Each index is a ratio of
+two weighted sums of codon counts, so a reference is reduced once to
+weights of each codon (log w for CAI, +1/-1 for optimal and rare codons
+for Fop, zero for codons the index skips) and a block of genes is scored
+against a block of references with score_block. Results agree with cai
+and fop, apart from Fop being calculated in double rather than float.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#define SCORE_ROWS 32  /* genes scored at a time              */
+#define SCORE_REFS 256 /* references scored at a time         */
+
+/******************  Score plans            *******************************/
+/* score_plan_cai reduces nref rows of 65 w values (as cai_val), and      */
+/* score_plan_fop nref rows of 65 optimal codon classes (as fop_cod), to  */
+/* codon weights. Return 1 if memory ran out, score_plan_fop 2 if a class */
+/* is not 1, 2 or 3                                                        */
+/**************************************************************************/
+static int score_plan_alloc(SCORE_PLAN_STRUCT *ps, SCORE_KIND kind, long nref, bool den)
+{
+   memset(ps, 0, sizeof(SCORE_PLAN_STRUCT));
+   ps->kind = kind;
+   ps->nref = nref;
+   ps->num = calloc(64 * nref + 1, sizeof(double));
+   if (den)
+      ps->den = calloc(64 * nref + 1, sizeof(double));
+   if (!ps->num || (den && !ps->den))
+   {
+      score_plan_free(ps);
+      return 1;
+   }
+   return 0;
+}
+
+int score_plan_cai(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const double *w)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   long r;
+   int x;
+
+   if (score_plan_alloc(ps, SCORE_CAI, nref, false))
+      return 1;
+
+   for (x = 1; x < 65; x++)
+   {
+      if (pcu->ca[x] == 11 || plan->ds[x] == 1)
+         continue; /* as cai, weight 0                  */
+      ps->den1[x - 1] = 1.0;
+      for (r = 0; r < nref; r++)
+      {
+         double wx = w[r * 65 + x];
+         ps->num[(x - 1) * nref + r] = log(wx < 0.0001 ? 0.01 : wx);
+      }
+   }
+   return 0;
+}
+
+int score_plan_fop(SCORE_PLAN_STRUCT *ps, CODE_PLAN_STRUCT *plan, long nref, const char *fop_cod, bool factor_in_rare)
+{
+   GENETIC_CODE_STRUCT *pcu = plan->pcu;
+   bool has_opt_info[22];
+   long r;
+   int x;
+
+   if (score_plan_alloc(ps, SCORE_FOP, nref, true))
+      return 1;
+
+   for (r = 0; r < nref; r++)
+   {
+      const char *cod = fop_cod + r * 65;
+
+      /* amino acids with optimal (or rare) codons, as fop          */
+      memset(has_opt_info, 0, sizeof(has_opt_info));
+      for (x = 1; x < 65; x++)
+      {
+         if (pcu->ca[x] == 11 || plan->ds[x] == 1)
+            continue;
+         if (cod[x] == 3 || (cod[x] == 1 && factor_in_rare))
+            has_opt_info[pcu->ca[x]] = true;
+      }
+
+      for (x = 1; x < 65; x++)
+      {
+         if (!has_opt_info[pcu->ca[x]])
+            continue;
+         if (cod[x] < 1 || cod[x] > 3)
+         {
+            score_plan_free(ps);
+            return 2;
+         }
+         ps->den[(x - 1) * nref + r] = 1.0;
+         if (cod[x] == 3)
+            ps->num[(x - 1) * nref + r] = 1.0;
+         else if (cod[x] == 1 && factor_in_rare)
+            ps->num[(x - 1) * nref + r] = -1.0;
+      }
+   }
+   return 0;
+}
+
+void score_plan_free(SCORE_PLAN_STRUCT *ps)
+{
+   free(ps->num);
+   free(ps->den);
+   ps->num = ps->den = NULL;
+}
+
+/******************  Scoring                *******************************/
+/* Scores rows lo..hi-1 a block of genes and references at a time,        */
+/* handing each block of scores to emit                                   */
+/**************************************************************************/
+typedef struct
+{
+   const void *ncod;
+   COUNT_TYPE type;
+   SCORE_PLAN_STRUCT *ps;
+   double *out;       /* score_matrix                      */
+   long out_stride;
+   int k;             /* score_topk                        */
+   long *top;
+   double *score;
+   int failed;
+} SCORE_JOB;
+
+typedef void (*SCORE_EMIT)(SCORE_JOB *pj, long row, long r0, long nr, const double *scores);
+
+static void score_rows(SCORE_JOB *pj, long lo, long hi, SCORE_EMIT emit)
+{
+   SCORE_PLAN_STRUCT *ps = pj->ps;
+   double c[SCORE_ROWS * 64], den1[SCORE_ROWS];
+   long row[65];
+   long i, r0, nb, nr, j;
+   int x;
+
+   double *num = malloc(2 * SCORE_ROWS * SCORE_REFS * sizeof(double));
+   double *den = num + SCORE_ROWS * SCORE_REFS;
+   if (!num)
+   {
+      pj->failed = 1;
+      return;
+   }
+
+   for (; lo < hi; lo += nb)
+   {
+      nb = hi - lo < SCORE_ROWS ? hi - lo : SCORE_ROWS;
+      for (i = 0; i < nb; i++)
+      {
+         count_row_get(pj->ncod, pj->type, 65, lo + i, row);
+         den1[i] = 0.0;
+         for (x = 0; x < 64; x++)
+         {
+            c[i * 64 + x] = (double)row[x + 1];
+            den1[i] += c[i * 64 + x] * ps->den1[x];
+         }
+      }
+
+      for (r0 = 0; r0 < ps->nref; r0 += nr)
+      {
+         nr = ps->nref - r0 < SCORE_REFS ? ps->nref - r0 : SCORE_REFS;
+         score_block(c, nb, ps->num + r0, ps->nref, nr, num);
+         if (ps->den)
+            score_block(c, nb, ps->den + r0, ps->nref, nr, den);
+
+         for (i = 0; i < nb; i++)
+         {
+            double *s = num + i * nr;
+            for (j = 0; j < nr; j++)
+            {
+               double d = ps->den ? den[i * nr + j] : den1[i];
+               if (d == 0.0)
+                  s[j] = 0.0; /* no codons counted, as cai and fop */
+               else if (ps->kind == SCORE_CAI)
+                  s[j] = exp(s[j] / d);
+               else
+                  s[j] = s[j] / d;
+            }
+            emit(pj, lo + i, r0, nr, s);
+         }
+      }
+   }
+   free(num);
+}
+
+static void emit_matrix(SCORE_JOB *pj, long row, long r0, long nr, const double *scores)
+{
+   memcpy(pj->out + row * pj->out_stride + r0, scores, nr * sizeof(double));
+}
+
+static void matrix_rows(long lo, long hi, void *ctx)
+{
+   score_rows(ctx, lo, hi, emit_matrix);
+}
+
+/* Writes the score of gene i against reference r to out[i * out_stride  */
+/* + r]. Returns -1 if memory ran out                                     */
+int score_matrix(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, double *out, long out_stride, int threads)
+{
+   SCORE_JOB job = {ncod, type, ps, out, out_stride, 0, NULL, NULL, 0};
+   parallel_rows(n, threads, matrix_rows, &job);
+   return job.failed ? -1 : 0;
+}
+
+/* keeps the k best references of each gene, best first (ties to the     */
+/* first reference); top starts out as -1                                 */
+static void emit_topk(SCORE_JOB *pj, long row, long r0, long nr, const double *scores)
+{
+   long *top = pj->top + row * pj->k;
+   double *best = pj->score + row * pj->k;
+   long j;
+   int p, k = pj->k;
+
+   for (j = 0; j < nr; j++)
+   {
+      double s = scores[j];
+      if (top[k - 1] >= 0 && !(s > best[k - 1]))
+         continue; /* not better than the k-th          */
+      for (p = k - 1; p > 0 && (top[p - 1] < 0 || s > best[p - 1]); p--)
+      {
+         top[p] = top[p - 1];
+         best[p] = best[p - 1];
+      }
+      top[p] = r0 + j;
+      best[p] = s;
+   }
+}
+
+static void topk_rows(long lo, long hi, void *ctx)
+{
+   SCORE_JOB *pj = ctx;
+   long i;
+
+   for (i = lo * pj->k; i < hi * pj->k; i++)
+   {
+      pj->top[i] = -1;
+      pj->score[i] = NAN;
+   }
+   score_rows(pj, lo, hi, emit_topk);
+}
+
+/* Writes the k best references of gene i (by index, best first) to      */
+/* top[i * k ..] and their scores to score[i * k ..], without keeping     */
+/* every score. Returns -1 if memory ran out                              */
+int score_topk(long n, const void *ncod, COUNT_TYPE type, SCORE_PLAN_STRUCT *ps, int k, long *top, double *score, int threads)
+{
+   SCORE_JOB job = {ncod, type, ps, NULL, 0, k, top, score, 0};
+   parallel_rows(n, threads, topk_rows, &job);
+   return job.failed ? -1 : 0;
+}
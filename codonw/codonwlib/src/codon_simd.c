@@ -0,0 +1,412 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains the innermost loops of counting (turning bases and
+codons into codes, widening narrow counts) built for several instruction
+sets. The variant used is picked once at run time from what the CPU
+supports, or from the CODONW_ISA environment variable (scalar, baseline,
+avx2 or avx512) so that each can be tested. The scalar variant is the
+table driven reference that the others must agree with.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../include/codonW.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#endif
+
+#define SIMD_BLOCK 256 /* codons encoded at a time           */
+
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define VECTORIZE __attribute__((optimize("tree-vectorize"))) /* also at -O2 */
+#else
+#define VECTORIZE
+#endif
+
+/******************  Kernel bodies          *******************************/
+/* Written so that the compiler vectorises them (compares combined with  */
+/* arithmetic instead of table lookups or branches, at most one compare  */
+/* is true). Each variant inlines them under its own                     */
+/* target so that they are compiled for that instruction set             */
+/**************************************************************************/
+KERNEL_INLINE void base_codes_body(const char *seq, long n, unsigned char *codes)
+{
+   long i;
+
+   for (i = 0; i < n; i++)
+   {
+      unsigned char c = (unsigned char)seq[i] | 0x20; /* lower case      */
+      codes[i] = ((c == 't') | (c == 'u')) | ((c == 'c') << 1) | ((c == 'a') * 3) | ((c == 'g') << 2);
+   }
+}
+
+KERNEL_INLINE void codon_codes_body(const char *seq, long n, unsigned char *codes)
+{
+   unsigned char b[3 * SIMD_BLOCK];
+   long i, k, m;
+
+   for (i = 0; i < n; i += m)
+   {
+      m = n - i < SIMD_BLOCK ? n - i : SIMD_BLOCK;
+      base_codes_body(seq + 3 * i, 3 * m, b);
+      for (k = 0; k < m; k++)
+      {
+         unsigned char b1 = b[3 * k], b2 = b[3 * k + 1], b3 = b[3 * k + 2];
+         unsigned char icode = (unsigned char)(b1 * 16 + b2 + b3 * 4 - 20);
+         codes[i + k] = (b1 && b2 && b3) ? icode : 0;
+      }
+   }
+}
+
+KERNEL_INLINE void score_block_body(const double *c, long nc, const double *w, long ldw, long nw, double *acc)
+{
+   long i, j;
+   int x;
+
+   for (i = 0; i < nc; i++)
+   {
+      double *a = acc + i * nw;
+      for (j = 0; j < nw; j++)
+         a[j] = 0.0;
+      for (x = 0; x < 64; x++)
+      {
+         double cx = c[i * 64 + x];
+         const double *wx = w + x * ldw;
+         if (cx == 0.0) /* most genes miss some codons       */
+            continue;
+         for (j = 0; j < nw; j++)
+            a[j] += cx * wx[j];
+      }
+   }
+}
+
+KERNEL_INLINE void dist_block_body(DIST_METRIC metric, const double *a, const double *wa, long na, const double *bt,
+                                   const double *wbt, long ldb, long nb, double *out, long ldo)
+{
+   long i, j;
+   int x;
+
+   for (i = 0; i < na; i++)
+   {
+      double *o = out + i * ldo;
+      for (j = 0; j < nb; j++)
+         o[j] = 0.0;
+      for (x = 0; x < 64; x++)
+      {
+         double ax = a[i * 64 + x];
+         const double *bx = bt + x * ldb;
+         switch (metric)
+         {
+         case DIST_EUCLIDEAN:
+            for (j = 0; j < nb; j++)
+               o[j] += (ax - bx[j]) * (ax - bx[j]);
+            break;
+         case DIST_MANHATTAN:
+            for (j = 0; j < nb; j++)
+               o[j] += fabs(ax - bx[j]);
+            break;
+         case DIST_CHI2: /* a sum of 0 has a difference of 0     */
+            for (j = 0; j < nb; j++)
+               o[j] += (ax - bx[j]) * (ax - bx[j]) / (ax + bx[j] + (ax + bx[j] == 0.0));
+            break;
+         case DIST_KARLIN:
+         {
+            double wx = wa[i * 64 + x];
+            const double *wbx = wbt + x * ldb;
+            for (j = 0; j < nb; j++)
+               o[j] += (wx + wbx[j]) * fabs(ax - bx[j]);
+            break;
+         }
+         }
+      }
+   }
+}
+
+KERNEL_INLINE void widen_u16_body(const uint16_t *m, long n, long *out)
+{
+   long i;
+   for (i = 0; i < n; i++)
+      out[i] = m[i];
+}
+
+KERNEL_INLINE void widen_u32_body(const uint32_t *m, long n, long *out)
+{
+   long i;
+   for (i = 0; i < n; i++)
+      out[i] = m[i];
+}
+
+/******************  Variants               *******************************/
+/* scalar is the reference, baseline is the bodies compiled for the      */
+/* default target of the build                                           */
+/**************************************************************************/
+static void base_codes_scalar(const char *seq, long n, unsigned char *codes)
+{
+   long i;
+   for (i = 0; i < n; i++)
+      codes[i] = base_code[(unsigned char)seq[i]];
+}
+
+static void codon_codes_scalar(const char *seq, long n, unsigned char *codes)
+{
+   long i;
+
+   for (i = 0; i < n; i++)
+   {
+      int b1 = base_code[(unsigned char)seq[3 * i]];
+      int b2 = base_code[(unsigned char)seq[3 * i + 1]];
+      int b3 = base_code[(unsigned char)seq[3 * i + 2]];
+
+      codes[i] = 0;
+      if (b1 * b2 * b3 != 0)
+         codes[i] = (unsigned char)((b1 - 1) * 16 + b2 + (b3 - 1) * 4);
+   }
+}
+
+/* the block kernels share the bodies of the others (for each row of    */
+/* counts, add each codon count times its row of w, skipping zero        */
+/* counts) without forcing the vectoriser on                             */
+static void score_block_scalar(const double *c, long nc, const double *w, long ldw, long nw, double *acc)
+{
+   score_block_body(c, nc, w, ldw, nw, acc);
+}
+
+static void dist_block_scalar(DIST_METRIC metric, const double *a, const double *wa, long na, const double *bt,
+                              const double *wbt, long ldb, long nb, double *out, long ldo)
+{
+   dist_block_body(metric, a, wa, na, bt, wbt, ldb, nb, out, ldo);
+}
+
+static void widen_u16_scalar(const uint16_t *m, long n, long *out)
+{
+   long i;
+   for (i = 0; i < n; i++)
+      out[i] = m[i];
+}
+
+static void widen_u32_scalar(const uint32_t *m, long n, long *out)
+{
+   long i;
+   for (i = 0; i < n; i++)
+      out[i] = m[i];
+}
+
+#define SIMD_VARIANT(SUFFIX, ATTR)                                                                         \
+   ATTR static void base_codes_##SUFFIX(const char *seq, long n, unsigned char *codes)                     \
+   {                                                                                                       \
+      base_codes_body(seq, n, codes);                                                                      \
+   }                                                                                                       \
+   ATTR static void codon_codes_##SUFFIX(const char *seq, long n, unsigned char *codes)                    \
+   {                                                                                                       \
+      codon_codes_body(seq, n, codes);                                                                     \
+   }                                                                                                       \
+   ATTR static void score_block_##SUFFIX(const double *c, long nc, const double *w, long ldw, long nw,     \
+                                         double *acc)                                                      \
+   {                                                                                                       \
+      score_block_body(c, nc, w, ldw, nw, acc);                                                            \
+   }                                                                                                       \
+   ATTR static void dist_block_##SUFFIX(DIST_METRIC metric, const double *a, const double *wa, long na,     \
+                                        const double *bt, const double *wbt, long ldb, long nb, double *out, \
+                                        long ldo)                                                          \
+   {                                                                                                       \
+      dist_block_body(metric, a, wa, na, bt, wbt, ldb, nb, out, ldo);                                      \
+   }                                                                                                       \
+   ATTR static void widen_u16_##SUFFIX(const uint16_t *m, long n, long *out) { widen_u16_body(m, n, out); } \
+   ATTR static void widen_u32_##SUFFIX(const uint32_t *m, long n, long *out) { widen_u32_body(m, n, out); }
+
+SIMD_VARIANT(baseline, VECTORIZE)
+#ifdef SIMD_X86
+SIMD_VARIANT(avx2, VECTORIZE __attribute__((target("avx2"))))
+SIMD_VARIANT(avx512, VECTORIZE __attribute__((target("avx512f,avx512bw"))))
+#endif
+
+/******************  Dispatch               *******************************/
+typedef struct
+{
+   const char *name;
+   int (*supported)(void);
+   void (*base_codes)(const char *seq, long n, unsigned char *codes);
+   void (*codon_codes)(const char *seq, long n, unsigned char *codes);
+   void (*widen_u16)(const uint16_t *m, long n, long *out);
+   void (*widen_u32)(const uint32_t *m, long n, long *out);
+   void (*score_block)(const double *c, long nc, const double *w, long ldw, long nw, double *acc);
+   void (*dist_block)(DIST_METRIC metric, const double *a, const double *wa, long na, const double *bt,
+                      const double *wbt, long ldb, long nb, double *out, long ldo);
+} SIMD_KERNELS;
+
+static int always(void) { return 1; }
+
+#ifdef SIMD_X86
+static int has_avx2(void)
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx2");
+}
+
+static int has_avx512(void)
+{
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+#endif
+
+#define KERNELS(NAME, SUFFIX, SUPPORTED) \
+   {NAME, SUPPORTED, base_codes_##SUFFIX, codon_codes_##SUFFIX, widen_u16_##SUFFIX, widen_u32_##SUFFIX, \
+    score_block_##SUFFIX, dist_block_##SUFFIX}
+
+/* best first. Without byte shuffles (e.g. SSE2 only) the table lookups */
+/* of the scalar variant beat the vectorised baseline build at counting. */
+/* Its block kernels are the same loops as baseline, but are only       */
+/* vectorised where the compiler does so unasked                         */
+static const SIMD_KERNELS variants[] = {
+#ifdef SIMD_X86
+   KERNELS("avx512", avx512, has_avx512),
+   KERNELS("avx2", avx2, has_avx2),
+#endif
+   KERNELS("scalar", scalar, always),
+   KERNELS("baseline", baseline, always),
+};
+
+#define NUM_VARIANTS ((int)(sizeof(variants) / sizeof(variants[0])))
+
+static const SIMD_KERNELS *active = NULL;
+static pthread_once_t active_once = PTHREAD_ONCE_INIT;
+
+static int select_variant(const char *name)
+{
+   int i;
+
+   for (i = 0; i < NUM_VARIANTS; i++)
+      if (!strcmp(name, variants[i].name) && variants[i].supported())
+      {
+         active = &variants[i];
+         return 0;
+      }
+   return 1;
+}
+
+static void simd_init(void)
+{
+   const char *env = getenv("CODONW_ISA");
+   int i;
+
+   for (i = 0; !variants[i].supported(); i++)
+      ; /* scalar is always supported        */
+   active = &variants[i];
+
+   if (env && *env)
+      select_variant(env); /* otherwise the best supported one  */
+}
+
+static const SIMD_KERNELS *simd(void)
+{
+   pthread_once(&active_once, simd_init);
+   return active;
+}
+
+/* Returns the name of the i-th variant built in (best first), NULL past  */
+/* the last one                                                           */
+const char *simd_variant(int i)
+{
+   return (i >= 0 && i < NUM_VARIANTS) ? variants[i].name : NULL;
+}
+
+/* Returns 1 if the named variant was built in and the CPU supports it    */
+int simd_supported(const char *name)
+{
+   int i;
+   for (i = 0; i < NUM_VARIANTS; i++)
+      if (!strcmp(name, variants[i].name))
+         return variants[i].supported();
+   return 0;
+}
+
+/* Returns the name of the variant in use                                 */
+const char *simd_isa(void)
+{
+   return simd()->name;
+}
+
+/* Switches to the named variant, returns 1 if it is not supported. Not   */
+/* meant to be called while other threads are counting                    */
+int simd_select(const char *name)
+{
+   pthread_once(&active_once, simd_init);
+   return select_variant(name);
+}
+
+/******************  Kernels                *******************************/
+/* base_codes maps n characters to base codes as base_code does,         */
+/* codon_codes maps n complete codons (3n characters) to codon codes as  */
+/* ident_codon does, widen_counts copies n counts of a narrow count      */
+/* matrix into longs and score_block multiplies nc rows of 64 codon      */
+/* counts by nw columns of a 64 x ldw weight matrix into nc x nw sums.   */
+/* dist_block sums the differences (see DIST_METRIC) of na rows of 64     */
+/* features against nb columns of 64 x ldb transposed features            */
+/**************************************************************************/
+void base_codes(const char *seq, long n, unsigned char *codes)
+{
+   simd()->base_codes(seq, n, codes);
+}
+
+void codon_codes(const char *seq, long n, unsigned char *codes)
+{
+   simd()->codon_codes(seq, n, codes);
+}
+
+void score_block(const double *c, long nc, const double *w, long ldw, long nw, double *acc)
+{
+   simd()->score_block(c, nc, w, ldw, nw, acc);
+}
+
+void dist_block(DIST_METRIC metric, const double *a, const double *wa, long na, const double *bt, const double *wbt, long ldb, long nb, double *out, long ldo)
+{
+   simd()->dist_block(metric, a, wa, na, bt, wbt, ldb, nb, out, ldo);
+}
+
+void widen_counts(const void *m, COUNT_TYPE type, long n, long *out)
+{
+   switch (type)
+   {
+   case COUNT_U16:
+      simd()->widen_u16(m, n, out);
+      break;
+   case COUNT_U32:
+      simd()->widen_u32(m, n, out);
+      break;
+   default:
+      memcpy(out, m, n * sizeof(long));
+      break;
+   }
+}
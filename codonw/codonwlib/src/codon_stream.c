@@ -0,0 +1,203 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains a streaming version of codon_usage_tot. A sequence
+is fed in chunks of any size, partial codons and the dinucleotide frame
+are carried across chunk boundaries, and lengths are 64-bit, so
+chromosome-scale sequences can be counted in constant memory.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <limits.h>
+#include <stdbool.h>
+
+#include "../include/codonW.h"
+
+/****************** Stream codon           *******************************/
+/* Counts a single codon given as three characters                        */
+/**************************************************************************/
+static void stream_codon(CODON_STREAM_STRUCT *ps, const char *codon)
+{
+   int b1 = base_code[(unsigned char)codon[0]];
+   int b2 = base_code[(unsigned char)codon[1]];
+   int b3 = base_code[(unsigned char)codon[2]];
+   int icode = 0;
+
+   if (b1 * b2 * b3 != 0)
+      icode = (b1 - 1) * 16 + b2 + (b3 - 1) * 4;
+
+   ps->ncod[icode]++;              /*increment the codon count */
+   ps->naa[ps->pcu->ca[icode]]++;  /*increment the AA count    */
+   if (ps->prot)
+      ps->prot[ps->nprot++] = amino_acids.aa1[ps->pcu->ca[icode]][0];
+   ps->codon_tot++;
+   ps->last_icode = icode;
+}
+
+/****************** Stream init            *******************************/
+/* Zeros the counters. dinuc selects whether dinucleotides are counted.   */
+/* Setting ps->hash afterwards also hashes the bases fed (see digest),    */
+/* pointing ps->prot at a buffer of one char per complete codon also     */
+/* writes the translation there as the codons are counted, and pointing  */
+/* ps->pack at a packed sequence (see packed_init) packs the bases fed    */
+/**************************************************************************/
+int codon_stream_init(CODON_STREAM_STRUCT *ps, GENETIC_CODE_STRUCT *pcu, char dinuc)
+{
+   memset(ps, 0, sizeof(CODON_STREAM_STRUCT));
+   ps->pcu = pcu;
+   ps->dinuc = dinuc;
+
+   return 0;
+}
+
+/****************** Stream feed            *******************************/
+/* Counts len bases of chunk. A codon split between two chunks is held   */
+/* in ps->codon until the remaining bases arrive. Returns 1 if memory to  */
+/* pack the bases ran out                                                 */
+/**************************************************************************/
+int codon_stream_feed(CODON_STREAM_STRUCT *ps, const char *chunk, long long len)
+{
+   long long i = 0;
+
+   if (len <= 0)
+      return 0;
+
+   if (ps->ncodon)
+   { /* complete the codon left by the last chunk */
+      while (ps->ncodon < 3 && i < len)
+         ps->codon[ps->ncodon++] = chunk[i++];
+
+      if (ps->ncodon == 3)
+      {
+         stream_codon(ps, ps->codon);
+         ps->ncodon = 0;
+      }
+   }
+
+   if (i + 2 < len)
+   {
+      long long n = (len - i) / 3;
+      ps->last_icode = tally_codons(chunk + i, n, ps->ncod, ps->naa, ps->pcu,
+                                    ps->prot ? ps->prot + ps->nprot : NULL);
+      if (ps->prot)
+         ps->nprot += n;
+      ps->codon_tot += n;
+      i += 3 * n;
+   }
+
+   while (i < len) /* hold on to any trailing partial codon */
+      ps->codon[ps->ncodon++] = chunk[i++];
+
+   if (ps->dinuc)
+      dinuc_feed(chunk, len, ps->din, &ps->fram, &ps->last_base);
+   if (ps->hash)
+      seq_hash_feed(&ps->hstate, chunk, len);
+
+   ps->seqlen += len;
+   if (ps->pack)
+      return packed_feed(ps->pack, chunk, len);
+   return 0;
+}
+
+/****************** Stream feed codes      *******************************/
+/* Counts len bases given as base codes (base_code, 0 for a non-standard */
+/* base) rather than characters, e.g. as decoded from a packed file, so  */
+/* no text is built. Partial codons are carried as codon_stream_feed     */
+/* does and the two may be mixed. Only codons (and the translation) are  */
+/* counted: dinucleotides, the hash and packing need the characters      */
+/**************************************************************************/
+int codon_stream_feed_codes(CODON_STREAM_STRUCT *ps, const unsigned char *codes, long long len)
+{
+   static const char code_base[5] = {'N', 'T', 'C', 'A', 'G'};
+   long block[65] = {0};
+   long long i = 0;
+   int b1, b2, b3, icode, x;
+
+   if (len <= 0)
+      return 0;
+
+   if (ps->ncodon)
+   { /* complete the codon left by the last chunk */
+      while (ps->ncodon < 3 && i < len)
+         ps->codon[ps->ncodon++] = code_base[codes[i++]];
+
+      if (ps->ncodon == 3)
+      {
+         stream_codon(ps, ps->codon);
+         ps->ncodon = 0;
+      }
+   }
+
+   for (; i + 2 < len; i += 3)
+   {
+      b1 = codes[i];
+      b2 = codes[i + 1];
+      b3 = codes[i + 2];
+      icode = (b1 && b2 && b3) ? (b1 - 1) * 16 + b2 + (b3 - 1) * 4 : 0;
+      block[icode]++;
+      if (ps->prot)
+         ps->prot[ps->nprot++] = amino_acids.aa1[ps->pcu->ca[icode]][0];
+      ps->codon_tot++;
+      ps->last_icode = icode;
+   }
+
+   for (x = 0; x < 65; x++)
+   {
+      ps->ncod[x] += block[x];
+      ps->naa[ps->pcu->ca[x]] += block[x];
+   }
+
+   while (i < len) /* hold on to any trailing partial codon */
+      ps->codon[ps->ncodon++] = code_base[codes[i++]];
+
+   ps->seqlen += len;
+   return 0;
+}
+
+/****************** Stream finish          *******************************/
+/* Called once the whole sequence has been fed. A trailing partial codon */
+/* is counted as untranslated and valid_stops is set as codon_usage_tot  */
+/* would, returns the code of the last codon                              */
+/**************************************************************************/
+int codon_stream_finish(CODON_STREAM_STRUCT *ps)
+{
+   int icode = ps->last_icode;
+
+   if (ps->ncodon)
+   {             /*if last codon was partial */
+      icode = 0; /*set icode to zero and     */
+      ps->ncod[0]++;
+      ps->ncodon = 0;
+   }
+
+   ps->valid_stops = (ps->codon_tot && ps->pcu->ca[icode] == 11) ? 1 : 0;
+   if (ps->hash)
+      seq_hash_final(&ps->hstate, ps->digest);
+
+   return icode;
+}
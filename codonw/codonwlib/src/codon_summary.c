@@ -0,0 +1,140 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains summaries of the distribution of indices by group: the
+count, mean and variance (Welford's online algorithm), range and a fixed
+bin histogram of each index. Their size depends only on the number of
+groups, so any number of sequences can be folded into them. Summaries
+of different shards are merged exactly (Chan et al.) by
+IndexSummary.merge.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../include/codonW.h"
+
+/******************  Summary memory         *******************************/
+/* summary_alloc allocates (and resets) the arrays of a summary, which    */
+/* summary_free releases. Callers may also point them at their own        */
+/* arrays and call summary_reset. Returns 1 if memory ran out             */
+/**************************************************************************/
+int summary_alloc(SUMMARY_STRUCT *ps, long ngroups, int nwhich, int nbins, const double *lo, const double *hi)
+{
+   long cells = ngroups * nwhich;
+
+   memset(ps, 0, sizeof(SUMMARY_STRUCT));
+   ps->ngroups = ngroups;
+   ps->nwhich = nwhich;
+   ps->nbins = nbins;
+   ps->lo = lo;
+   ps->hi = hi;
+
+   ps->count = malloc(cells * sizeof(long) + 1);
+   ps->nan = malloc(cells * sizeof(long) + 1);
+   ps->mean = malloc(cells * sizeof(double) + 1);
+   ps->m2 = malloc(cells * sizeof(double) + 1);
+   ps->min = malloc(cells * sizeof(double) + 1);
+   ps->max = malloc(cells * sizeof(double) + 1);
+   ps->hist = malloc(cells * (nbins + 2) * sizeof(long) + 1);
+   if (!ps->count || !ps->nan || !ps->mean || !ps->m2 || !ps->min || !ps->max || !ps->hist)
+   {
+      summary_free(ps);
+      return 1;
+   }
+
+   summary_reset(ps);
+   return 0;
+}
+
+void summary_free(SUMMARY_STRUCT *ps)
+{
+   free(ps->count);
+   free(ps->nan);
+   free(ps->mean);
+   free(ps->m2);
+   free(ps->min);
+   free(ps->max);
+   free(ps->hist);
+   ps->count = ps->nan = ps->hist = NULL;
+   ps->mean = ps->m2 = ps->min = ps->max = NULL;
+}
+
+void summary_reset(SUMMARY_STRUCT *ps)
+{
+   long c, cells = ps->ngroups * ps->nwhich;
+
+   for (c = 0; c < cells; c++)
+   {
+      ps->count[c] = ps->nan[c] = 0;
+      ps->mean[c] = ps->m2[c] = 0.0;
+      ps->min[c] = INFINITY;
+      ps->max[c] = -INFINITY;
+   }
+   memset(ps->hist, 0, cells * (ps->nbins + 2) * sizeof(long));
+}
+
+/******************  Summary add            *******************************/
+/* Folds the nwhich values of one sequence into the summary of its group  */
+/**************************************************************************/
+void summary_add(SUMMARY_STRUCT *ps, long group, const double *values)
+{
+   long c = group * ps->nwhich;
+   int k;
+
+   for (k = 0; k < ps->nwhich; k++, c++)
+   {
+      double x = values[k], delta;
+      long bin;
+
+      if (isnan(x))
+      {
+         ps->nan[c]++;
+         continue;
+      }
+
+      ps->count[c]++;
+      delta = x - ps->mean[c];
+      ps->mean[c] += delta / ps->count[c];
+      ps->m2[c] += delta * (x - ps->mean[c]);
+      if (x < ps->min[c])
+         ps->min[c] = x;
+      if (x > ps->max[c])
+         ps->max[c] = x;
+
+      if (x < ps->lo[k])
+         bin = 0;
+      else if (x >= ps->hi[k])
+         bin = ps->nbins + 1;
+      else
+      {
+         bin = 1 + (long)((x - ps->lo[k]) / (ps->hi[k] - ps->lo[k]) * ps->nbins);
+         if (bin > ps->nbins) /* rounding just below hi            */
+            bin = ps->nbins;
+      }
+      ps->hist[c * (ps->nbins + 2) + bin]++;
+   }
+}
@@ -0,0 +1,474 @@
+/*************************************************************************
+
+CodonW codon usage analysis package
+
+    Copyright (C) 2005            John F. Peden
+    Copyright (C) 2020            Shyam Saladi
+
+This program is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+675 Mass Ave, Cambridge, MA 02139, USA.
+
+*************************************************************************
+
+This file contains a vantage point tree over rows of 64 features (see
+dist_features) for nearest neighbour searches. The tree is implicit in
+the order of the points: the node of positions lo..hi-1 has its vantage
+point at lo, the points no further from it than mu[lo] at lo+1..mid-1
+and the others at mid..hi-1 (mid as in vp_mid), down to leaves of at
+most VP_LEAF points. So the tree is three flat arrays without pointers,
+saved to a file as they are and searched straight from a mapping of it.
+
+************************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/codonW.h"
+
+#define VP_LEAF 8       /* points searched one by one         */
+#define VP_MAGIC "CODONWVP"
+#define VP_VERSION 1
+
+typedef struct
+{
+   char magic[8];
+   int32_t version;
+   int32_t metric;
+   int32_t rscu;
+   int32_t leaf;
+   int64_t n;
+   int64_t nextra;
+   char pad[24];
+} VP_HEADER;            /* 64 bytes, followed by order, mu, feat, extra */
+
+static long vp_mid(long lo, long hi)
+{
+   return lo + 1 + (hi - lo - 1) / 2;
+}
+
+static double vp_dist(DIST_METRIC metric, const double *a, const float *b)
+{
+   double s[4] = {0.0, 0.0, 0.0, 0.0}; /* independent sums, to pipeline */
+   int x, l;
+
+   if (metric == DIST_MANHATTAN)
+      for (x = 0; x < 64; x += 4)
+         for (l = 0; l < 4; l++)
+            s[l] += fabs(a[x + l] - b[x + l]);
+   else
+      for (x = 0; x < 64; x += 4)
+         for (l = 0; l < 4; l++)
+            s[l] += (a[x + l] - b[x + l]) * (a[x + l] - b[x + l]);
+
+   s[0] += s[1] + s[2] + s[3];
+   return metric == DIST_MANHATTAN ? s[0] : sqrt(s[0]);
+}
+
+/******************  Build                  *******************************/
+typedef struct
+{
+   VPTREE_STRUCT *pt;
+   const double *feat;  /* rows of features as given         */
+   double *fp;          /* features of the point at each position, */
+                        /* in double while building          */
+   double *d;           /* distance to the current vantage point */
+   long (*task)[2];     /* ranges built on threads           */
+} VP_BUILD;
+
+static void vp_swap(VP_BUILD *pb, long a, long b)
+{
+   long long o = pb->pt->order[a];
+   double t = pb->d[a];
+   int x;
+
+   pb->pt->order[a] = pb->pt->order[b];
+   pb->pt->order[b] = o;
+   pb->d[a] = pb->d[b];
+   pb->d[b] = t;
+   for (x = 0; x < 64; x++)
+   {
+      double f = pb->fp[a * 64 + x];
+      pb->fp[a * 64 + x] = pb->fp[b * 64 + x];
+      pb->fp[b * 64 + x] = f;
+   }
+}
+
+/* splits positions lo..hi-1 into a node, returns 0 for a leaf           */
+static int vp_split(VP_BUILD *pb, long lo, long hi)
+{
+   VPTREE_STRUCT *pt = pb->pt;
+   long i, mid = vp_mid(lo, hi), a = lo + 1, b = hi - 1;
+   float vp[64];
+   int x;
+
+   if (hi - lo <= VP_LEAF)
+      return 0;
+
+   /* a pseudo-random vantage point, the same for every build          */
+   vp_swap(pb, lo, lo + (long)(((unsigned long long)lo * 2654435761ULL + hi) % (hi - lo)));
+   for (x = 0; x < 64; x++)
+      vp[x] = (float)pb->fp[lo * 64 + x];
+   for (i = lo + 1; i < hi; i++)
+      pb->d[i] = vp_dist(pt->metric, pb->fp + i * 64, vp);
+
+   /* quickselect the median distance into mid                          */
+   while (a < b)
+   {
+      double pivot = pb->d[(a + b) / 2];
+      long l = a, r = b;
+      while (l <= r)
+      {
+         while (pb->d[l] < pivot)
+            l++;
+         while (pb->d[r] > pivot)
+            r--;
+         if (l <= r)
+            vp_swap(pb, l++, r--);
+      }
+      if (mid <= r)
+         b = r;
+      else if (mid >= l)
+         a = l;
+      else
+         break;
+   }
+   pt->mu[lo] = pb->d[mid];
+   return 1;
+}
+
+static void vp_build_range(VP_BUILD *pb, long lo, long hi)
+{
+   while (vp_split(pb, lo, hi))
+   {
+      long mid = vp_mid(lo, hi);
+      vp_build_range(pb, lo + 1, mid);
+      lo = mid;
+   }
+}
+
+static void build_tasks(long lo, long hi, void *ctx)
+{
+   VP_BUILD *pb = ctx;
+   long t;
+
+   for (t = lo; t < hi; t++)
+      vp_build_range(pb, pb->task[t][0], pb->task[t][1]);
+}
+
+/* Builds a tree of the n rows of 64 features in feat for metric          */
+/* (DIST_EUCLIDEAN or DIST_MANHATTAN). The top of the tree is split on    */
+/* this thread and the subtrees below are built on threads threads.       */
+/* Returns 1 if memory ran out, 2 if the metric is not supported          */
+int vptree_build(VPTREE_STRUCT *pt, DIST_METRIC metric, long n, const double *feat, int threads)
+{
+   VP_BUILD b = {.pt = pt, .feat = feat};
+   long ntask = 0, cap, t, i;
+
+   memset(pt, 0, sizeof(VPTREE_STRUCT));
+   if (metric != DIST_EUCLIDEAN && metric != DIST_MANHATTAN)
+      return 2; /* the triangle inequality is needed */
+   pt->metric = metric;
+   pt->n = n;
+
+   cap = 4L * (threads > 1 ? threads : 1);
+   pt->order = malloc(n * sizeof(long long) + 1);
+   pt->mu = calloc(n + 1, sizeof(double));
+   pt->feat = malloc(n * 64 * sizeof(float) + 1);
+   b.fp = malloc(n * 64 * sizeof(double) + 1);
+   b.d = malloc(n * sizeof(double) + 1);
+   b.task = malloc((4 * cap + 4) * sizeof(long[2]));
+   if (!pt->order || !pt->mu || !pt->feat || !b.fp || !b.d || !b.task)
+   {
+      free(b.fp);
+      free(b.d);
+      free(b.task);
+      vptree_free(pt);
+      return 1;
+   }
+   for (i = 0; i < n; i++)
+      pt->order[i] = i;
+   for (i = 0; i < n * 64; i++) /* as saved, so that distances agree */
+      b.fp[i] = (float)feat[i];
+
+   /* split breadth first until there are enough subtrees for threads   */
+   b.task[ntask][0] = 0;
+   b.task[ntask++][1] = n;
+   for (t = 0; t < ntask && ntask - t < cap && ntask + 2 <= 4 * cap + 4; t++)
+   {
+      long lo = b.task[t][0], hi = b.task[t][1];
+      if (!vp_split(&b, lo, hi))
+         continue; /* a leaf, nothing left to build     */
+      b.task[ntask][0] = lo + 1;
+      b.task[ntask++][1] = vp_mid(lo, hi);
+      b.task[ntask][0] = vp_mid(lo, hi);
+      b.task[ntask++][1] = hi;
+   }
+   b.task += t; /* the subtrees not split yet        */
+   ntask -= t;
+   parallel_rows(ntask, threads, build_tasks, &b);
+
+   for (i = 0; i < n * 64; i++)
+      pt->feat[i] = (float)b.fp[i];
+   free(b.fp);
+   free(b.d);
+   free(b.task - t);
+   return 0;
+}
+
+/******************  Query                  *******************************/
+/* Finds the k nearest points of each of nq rows of features in q, their  */
+/* rows (nearest first, -1 past the n-th) in nbr and distances in dist.   */
+/* With eps > 0 subtrees are skipped unless they may hold a point closer  */
+/* than the k-th found divided by 1 + eps, which is faster and finds      */
+/* neighbours at most that much further. With budget > 0 the search stops */
+/* after comparing that many points (the nearer side of each node first), */
+/* for when the features are too many dimensional for the tree to prune   */
+/**************************************************************************/
+typedef struct
+{
+   const VPTREE_STRUCT *pt;
+   const double *q;
+   int k;
+   double eps;
+   long budget;
+   long *nbr;
+   double *dist;
+} VP_QUERY;
+
+typedef struct
+{
+   const double *q;
+   int k, nfound;
+   long *pos;           /* positions found, furthest first (a max heap) */
+   double *d;
+   long left;           /* points that may still be compared  */
+} VP_HEAP;
+
+static void heap_push(VP_HEAP *ph, long pos, double d)
+{
+   long i, c;
+
+   if (ph->nfound == ph->k)
+   {
+      if (d >= ph->d[0])
+         return;
+      /* replace the furthest and sift it down                          */
+      for (i = 0; (c = 2 * i + 1) < ph->k; i = c)
+      {
+         if (c + 1 < ph->k && ph->d[c + 1] > ph->d[c])
+            c++;
+         if (ph->d[c] <= d)
+            break;
+         ph->d[i] = ph->d[c];
+         ph->pos[i] = ph->pos[c];
+      }
+   }
+   else
+      for (i = ph->nfound++; i > 0 && ph->d[(i - 1) / 2] < d; i = (i - 1) / 2)
+      {
+         ph->d[i] = ph->d[(i - 1) / 2];
+         ph->pos[i] = ph->pos[(i - 1) / 2];
+      }
+   ph->d[i] = d;
+   ph->pos[i] = pos;
+}
+
+static double heap_tau(const VP_HEAP *ph, double eps)
+{
+   return ph->nfound < ph->k ? DBL_MAX : ph->d[0] / (1.0 + eps);
+}
+
+static void vp_search(const VPTREE_STRUCT *pt, VP_HEAP *ph, double eps, long lo, long hi)
+{
+   while (hi > lo && ph->left > 0)
+   {
+      long i, mid = vp_mid(lo, hi);
+      double d = vp_dist(pt->metric, ph->q, pt->feat + lo * 64);
+
+      heap_push(ph, lo, d);
+      ph->left--;
+      if (hi - lo <= VP_LEAF)
+      {
+         for (i = lo + 1; i < hi; i++)
+            heap_push(ph, i, vp_dist(pt->metric, ph->q, pt->feat + i * 64));
+         ph->left -= hi - lo - 1;
+         return;
+      }
+
+      double mu = pt->mu[lo];
+      if (d <= mu)
+      { /* inside first                      */
+         vp_search(pt, ph, eps, lo + 1, mid);
+         if (d + heap_tau(ph, eps) < mu)
+            return;
+         lo = mid;
+      }
+      else
+      {
+         vp_search(pt, ph, eps, mid, hi);
+         if (d - heap_tau(ph, eps) > mu)
+            return;
+         hi = mid;
+         lo = lo + 1;
+      }
+   }
+}
+
+static void query_rows(long lo, long hi, void *ctx)
+{
+   VP_QUERY *pj = ctx;
+   const VPTREE_STRUCT *pt = pj->pt;
+   long i;
+   int a, b;
+
+   for (i = lo; i < hi; i++)
+   {
+      long *nbr = pj->nbr + i * pj->k;
+      double *dist = pj->dist + i * pj->k;
+      VP_HEAP h = {pj->q + i * 64, pj->k, 0, nbr, dist, pj->budget > 0 ? pj->budget : LONG_MAX};
+
+      vp_search(pt, &h, pj->eps, 0, pt->n);
+
+      for (a = 1; a < h.nfound; a++)
+      { /* nearest first (k is small)       */
+         long p = nbr[a];
+         double d = dist[a];
+         for (b = a; b > 0 && (dist[b - 1] > d || (dist[b - 1] == d && nbr[b - 1] > p)); b--)
+         {
+            nbr[b] = nbr[b - 1];
+            dist[b] = dist[b - 1];
+         }
+         nbr[b] = p;
+         dist[b] = d;
+      }
+      for (a = 0; a < h.nfound; a++)
+         nbr[a] = (long)pt->order[nbr[a]];
+      for (; a < pj->k; a++)
+      {
+         nbr[a] = -1;
+         dist[a] = NAN;
+      }
+   }
+}
+
+int vptree_query(const VPTREE_STRUCT *pt, long nq, const double *q, int k, double eps, long budget, long *nbr, double *dist, int threads)
+{
+   VP_QUERY job = {pt, q, k, eps < 0 ? 0 : eps, budget, nbr, dist};
+   parallel_rows(nq, threads, query_rows, &job);
+   return 0;
+}
+
+/******************  Files                  *******************************/
+/* vptree_save writes the header, order, mu, features and extra bytes to  */
+/* filename and returns 1 if it could not. vptree_load maps such a file   */
+/* and points the tree into it, returning 1 if it could not be read and 2 */
+/* if it is not a tree (or one of another version or byte order)          */
+/**************************************************************************/
+int vptree_save(const VPTREE_STRUCT *pt, const char *filename)
+{
+   VP_HEADER h;
+   FILE *f = fopen(filename, "wb");
+   int ok;
+
+   if (!f)
+      return 1;
+   memset(&h, 0, sizeof(h));
+   memcpy(h.magic, VP_MAGIC, 8);
+   h.version = VP_VERSION;
+   h.metric = pt->metric;
+   h.rscu = pt->rscu;
+   h.leaf = VP_LEAF;
+   h.n = pt->n;
+   h.nextra = (int64_t)pt->nextra;
+
+   ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+        fwrite(pt->order, sizeof(long long), pt->n, f) == (size_t)pt->n &&
+        fwrite(pt->mu, sizeof(double), pt->n, f) == (size_t)pt->n &&
+        fwrite(pt->feat, 64 * sizeof(float), pt->n, f) == (size_t)pt->n &&
+        fwrite(pt->extra, 1, pt->nextra, f) == pt->nextra;
+   if (fclose(f))
+      ok = 0;
+   return !ok;
+}
+
+int vptree_load(VPTREE_STRUCT *pt, const char *filename)
+{
+   struct stat st;
+   VP_HEADER h;
+
+   memset(pt, 0, sizeof(VPTREE_STRUCT));
+   int fd = open(filename, O_RDONLY);
+   if (fd < 0)
+      return 1;
+   if (fstat(fd, &st))
+   {
+      close(fd);
+      return 1;
+   }
+   if ((size_t)st.st_size < sizeof(VP_HEADER))
+   {
+      close(fd);
+      return 2;
+   }
+
+   void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED)
+      return 1;
+   memcpy(&h, map, sizeof(h));
+
+   size_t need = sizeof(VP_HEADER) + (size_t)h.n * (sizeof(long long) + sizeof(double) + 64 * sizeof(float));
+   if (memcmp(h.magic, VP_MAGIC, 8) || h.version != VP_VERSION || h.leaf != VP_LEAF ||
+       (h.metric != DIST_EUCLIDEAN && h.metric != DIST_MANHATTAN) || h.n < 0 || h.nextra < 0 ||
+       (size_t)st.st_size != need + (size_t)h.nextra)
+   {
+      munmap(map, st.st_size);
+      return 2;
+   }
+
+   char *p = (char *)map + sizeof(VP_HEADER);
+   pt->map = map;
+   pt->size = st.st_size;
+   pt->metric = h.metric;
+   pt->rscu = h.rscu;
+   pt->n = h.n;
+   pt->order = (long long *)p;
+   pt->mu = (double *)(p + h.n * sizeof(long long));
+   pt->feat = (float *)(p + h.n * (sizeof(long long) + sizeof(double)));
+   pt->extra = p + h.n * (sizeof(long long) + sizeof(double) + 64 * sizeof(float));
+   pt->nextra = h.nextra;
+   return 0;
+}
+
+void vptree_free(VPTREE_STRUCT *pt)
+{
+   if (pt->map)
+      munmap(pt->map, pt->size);
+   else
+   {
+      free(pt->order);
+      free(pt->mu);
+      free(pt->feat);
+   }
+   memset(pt, 0, sizeof(VPTREE_STRUCT));
+}
@@ -307,6 +307,49 @@ AMINO_PROP_STRUCT amino_prop = {
     }
 };
 
+/* as ExPASy ProtParam and Bio.SeqUtils.ProtParam                      */
+PROTEIN_PROP_STRUCT protein_prop = {
+    { /* average mass of each amino acid */
+        0.0,
+        165.1891, 131.1729, 131.1729, 149.2113, 117.1463,
+        105.0926, 115.1305, 119.1192, 89.0932, 181.1885,
+        0.0, 155.1546, 146.1445, 132.1179, 146.1876,
+        133.1027, 147.1293, 121.1582, 204.2252, 174.201, 75.0666
+    },
+    18.0153, /* water                       */
+    { /* pK of the side chain */
+        0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 10.0,
+        0.0, 5.98, 0.0, 0.0, 10.0,
+        4.05, 4.45, 9.0, 0.0, 12.0, 0.0
+    },
+    { /* its charge           */
+        0,
+        0, 0, 0, 0, 0,
+        0, 0, 0, 0, -1,
+        0, 1, 0, 0, 1,
+        -1, -1, -1, 0, 1, 0
+    },
+    7.5,  /* pK of the amino terminus    */
+    3.55, /*       the carboxyl terminus */
+    { /* extinction coefficient */
+        0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 1490.0,
+        0.0, 0.0, 0.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 5500.0, 0.0, 0.0
+    },
+    { /* aliphatic index      */
+        0.0,
+        0.0, 3.9, 3.9, 0.0, 2.9,
+        0.0, 0.0, 0.0, 1.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0, 0.0
+    }
+};
+
+#ifndef CODONW_NO_STDIO
 MENU_STRUCT Z_menu = {
     'X',   /*This default is set in proc_commline to CU        */
     false, /*totals                                            */
@@ -360,3 +403,4 @@ REF_STRUCT Z_ref = {
     &amino_acids,
     &amino_prop
 };
+#endif
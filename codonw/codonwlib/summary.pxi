@@ -0,0 +1,242 @@
+"""
+
+Distributions of indices over many sequences, folded into summaries of
+fixed size instead of keeping a row per sequence. Included into
+`codonw.pyx`.
+
+"""
+
+# histogram range of each index, values outside fall in the end bins
+summary_ranges = {
+    'CAI': (0, 1), 'Fop': (0, 1), 'CBI': (-1, 1), 'Nc': (20, 61),
+    'Gravy': (-2, 2), 'Aromo': (0, 0.5), 'GC': (0, 1), 'GC3s': (0, 1),
+    'L_sym': (0, 5000), 'L_aa': (0, 5000),
+    'T3s': (0, 1), 'C3s': (0, 1), 'A3s': (0, 1), 'G3s': (0, 1),
+}
+
+_summary_cells = ['count', 'nan', 'mean', 'm2', 'min', 'max', 'hist']
+
+
+class IndexSummary:
+    """Count, mean, variance, range and histogram of indices by group
+
+    Built by `summarize_indices`. Memory depends on the number of groups
+    and bins only. Summaries of the same indices, bins and ranges (e.g. of
+    the shards of a data set) are combined exactly with `merge` or `+`.
+
+    `groups`: the group keys
+    `indices`: the index names
+    `lo`, `hi`, `bins`: the histogram of each index has `bins` equal bins
+        between `lo` and `hi`, and one more at each end for values outside
+    `count`, `nan`: groups x indices number of values folded, and of NaNs
+        (e.g. Nc that could not be calculated) skipped
+    `mean`, `m2`, `min`, `max`: groups x indices running moments (`m2` is
+        the sum of squared deviations from the mean) and range
+    `hist`: groups x indices x (`bins` + 2) histogram counts
+    """
+
+    def __init__(self, groups, indices, lo, hi, bins):
+        self.groups = np.asarray(groups, dtype=object)
+        self.indices = list(indices)
+        self.lo = np.asarray(lo, dtype=c_double)
+        self.hi = np.asarray(hi, dtype=c_double)
+        self.bins = int(bins)
+
+        shape = (len(self.groups), len(self.indices))
+        self.count = np.zeros(shape, dtype=c_long)
+        self.nan = np.zeros(shape, dtype=c_long)
+        self.mean = np.zeros(shape, dtype=c_double)
+        self.m2 = np.zeros(shape, dtype=c_double)
+        self.min = np.full(shape, np.inf)
+        self.max = np.full(shape, -np.inf)
+        self.hist = np.zeros(shape + (self.bins + 2,), dtype=c_long)
+        return
+
+    def __repr__(self):
+        return "<IndexSummary of {} indices in {} groups>".format(
+            len(self.indices), len(self.groups))
+
+    def __add__(self, other):
+        return self.merge(other)
+
+    @property
+    def var(self):
+        """Sample variance (NaN for fewer than two values)"""
+        with np.errstate(invalid='ignore', divide='ignore'):
+            return np.where(self.count > 1, self.m2 / (self.count - 1), np.nan)
+
+    def edges(self):
+        """Bin edges of the histogram of each index, `bins` + 1 each"""
+        return np.linspace(self.lo, self.hi, self.bins + 1, axis=1)
+
+    def merge(self, *others):
+        """Returns the summary of this and `others` together, groups in
+        order of first appearance
+        """
+        parts = (self,) + others
+        for p in others:
+            if (p.indices != self.indices or p.bins != self.bins or
+                    not np.array_equal(p.lo, self.lo) or not np.array_equal(p.hi, self.hi)):
+                raise ValueError("Summaries must have the same indices, bins and ranges")
+
+        merged = IndexSummary(pd.unique(np.concatenate([p.groups for p in parts])),
+                              self.indices, self.lo, self.hi, self.bins)
+        rows = pd.Series(np.arange(len(merged.groups)), index=merged.groups)
+        for p in parts:
+            r = rows[p.groups].values
+            na, nb = merged.count[r], p.count
+            n = na + nb
+            with np.errstate(invalid='ignore', divide='ignore'):
+                delta = p.mean - merged.mean[r]
+                frac = np.where(n > 0, nb / np.maximum(n, 1), 0)
+                merged.m2[r] += p.m2 + delta * delta * na * frac
+                merged.mean[r] += delta * frac
+            merged.count[r] = n
+            merged.nan[r] += p.nan
+            merged.min[r] = np.minimum(merged.min[r], p.min)
+            merged.max[r] = np.maximum(merged.max[r], p.max)
+            merged.hist[r] += p.hist
+        return merged
+
+    def quantile(self, q):
+        """Approximate quantiles from the histograms, by interpolation in
+        the bin each falls in, as a groups x indices array for each `q`
+        """
+        q = np.atleast_1d(q)
+        out = np.full((len(q),) + self.count.shape, np.nan)
+        edges = self.edges()
+        for g in range(len(self.groups)):
+            for k in range(len(self.indices)):
+                n = self.count[g, k]
+                if not n:
+                    continue
+                lo, hi = self.min[g, k], self.max[g, k]
+                e = np.concatenate([[min(lo, edges[k, 0])], edges[k],
+                                    [max(hi, edges[k, -1])]])
+                e = np.clip(e, lo, hi)
+                cum = np.cumsum(self.hist[g, k])
+                # bin holding the value of each rank, interpolated within
+                t = q * n
+                j = np.minimum(np.searchsorted(cum, t), len(cum) - 1)
+                before = cum[j] - self.hist[g, k][j]
+                with np.errstate(invalid='ignore', divide='ignore'):
+                    frac = np.clip((t - before) / self.hist[g, k][j], 0, 1)
+                out[:, g, k] = e[j] + np.nan_to_num(frac) * (e[j + 1] - e[j])
+        return out
+
+    def table(self, quantiles=(0.05, 0.25, 0.5, 0.75, 0.95)):
+        """The summary of each group and index as a `pd.DataFrame`
+        """
+        idx = pd.MultiIndex.from_product([self.groups, self.indices],
+                                         names=['group', 'index'])
+        cols = dict(count=self.count.ravel(), nan=self.nan.ravel(),
+                    mean=np.where(self.count > 0, self.mean, np.nan).ravel(),
+                    std=np.sqrt(self.var).ravel(),
+                    min=np.where(self.count > 0, self.min, np.nan).ravel(),
+                    max=np.where(self.count > 0, self.max, np.nan).ravel())
+        for q, v in zip(quantiles, self.quantile(quantiles)):
+            cols['q{:g}'.format(100 * q)] = v.ravel()
+        return pd.DataFrame(cols, index=idx)
+
+    def histogram(self, index, group=None):
+        """Histogram of one index as a `pd.Series` indexed by the left edge
+        of each bin (-inf and `hi` for values outside the range)
+        """
+        k = self.indices.index(index)
+        g = 0 if group is None else list(self.groups).index(group)
+        left = np.concatenate([[-np.inf], self.edges()[k]])
+        return pd.Series(self.hist[g, k], index=left, name=index)
+
+
+def summarize_indices(counts, indices=None, groups=None, int bins=64,
+                      ranges=None, int cai_ref=0, int fop_ref=0, int cbi_ref=0,
+                      bool factor_in_rare=False, int threads=1):
+    """Folds the indices of every sequence of a `CodonCounts` into an
+    `IndexSummary` per group, without keeping them
+
+    `indices`: names from `index_names` (default all)
+    `groups`: group key of each sequence, by default `counts.groups` or one
+        group "all"
+    `bins`: histogram bins of each index
+    `ranges`: histogram range of some indices, as a dict of (lo, hi), over
+        those of `summary_ranges`
+    `cai_ref`, `fop_ref`, `cbi_ref`, `factor_in_rare`: as for `CodonSeq`
+    `threads`: number of threads. Each calculates a block of rows at a time
+        and folds it into the one summary, so memory does not grow with
+        threads
+    """
+    if indices is None:
+        indices = index_names
+    indices = list(indices)
+    unknown = [i for i in indices if i not in index_names]
+    if unknown:
+        raise ValueError("Unknown indices: {}".format(", ".join(map(str, unknown))))
+    if bins < 1:
+        raise ValueError("bins must be at least 1")
+    lim = dict(summary_ranges, **(ranges or {}))
+    lo = np.array([lim[i][0] for i in indices], dtype=c_double)
+    hi = np.array([lim[i][1] for i in indices], dtype=c_double)
+    if (hi <= lo).any():
+        raise ValueError("ranges must have lo < hi")
+
+    cdef long n = len(counts)
+    if groups is None:
+        groups = counts.groups if counts.groups is not None else np.full(n, "all", dtype=object)
+    if len(groups) != n:
+        raise ValueError("groups must have one key per sequence")
+    codes, keys = pd.factorize(np.asarray(groups, dtype=object))
+
+    summary = IndexSummary(keys, indices, lo, hi, bins)
+    if not n or not indices:
+        return summary
+
+    _check_refs(cai_ref, fop_ref, cbi_ref)
+
+    ncod, naa = counts.ncod, counts.naa
+    if ncod.dtype != naa.dtype or ncod.dtype not in count_dtypes:
+        ncod, naa = ncod.astype(c_long), naa.astype(c_long)
+    ncod, naa = np.ascontiguousarray(ncod), np.ascontiguousarray(naa)
+    which = np.array([index_names.index(i) for i in indices], dtype=c_int)
+    _summarize_into(ncod, naa, which, codes.astype(c_long), summary,
+                    counts.genetic_code, cai_ref, fop_ref, cbi_ref,
+                    factor_in_rare, threads)
+    return summary
+
+
+cdef _summarize_into(np.ndarray ncod, np.ndarray naa, int[::1] which,
+                     long[::1] group, summary, genetic_code, int cai_ref,
+                     int fop_ref, int cbi_ref, bool factor_in_rare, int threads):
+    """Runs `batch_summary` over all rows into the arrays of `summary`
+    """
+    cdef codonwlib.GENETIC_CODE_STRUCT code = _resolve_code(genetic_code)
+    cdef codonwlib.CODE_PLAN_STRUCT plan
+    cdef codonwlib.INDEX_PLAN_STRUCT pi
+    cdef codonwlib.SUMMARY_STRUCT s
+    cdef long n = ncod.shape[0]
+    cdef codonwlib.COUNT_TYPE ctype = _count_type(ncod.dtype)
+    cdef int ret
+
+    s.ngroups = len(summary.groups)
+    s.nwhich = which.shape[0]
+    s.nbins = summary.bins
+    s.lo = <double *>np.PyArray_DATA(summary.lo)
+    s.hi = <double *>np.PyArray_DATA(summary.hi)
+    s.count = <long *>np.PyArray_DATA(summary.count)
+    s.nan = <long *>np.PyArray_DATA(summary.nan)
+    s.mean = <double *>np.PyArray_DATA(summary.mean)
+    s.m2 = <double *>np.PyArray_DATA(summary.m2)
+    s.min = <double *>np.PyArray_DATA(summary.min)
+    s.max = <double *>np.PyArray_DATA(summary.max)
+    s.hist = <long *>np.PyArray_DATA(summary.hist)
+    codonwlib.summary_reset(&s)
+
+    codonwlib.code_plan_init(&plan, &code)
+    codonwlib.index_plan_init(&pi, &plan, &codonwlib.cai_ref[cai_ref],
+                              &codonwlib.fop_ref[fop_ref], &codonwlib.fop_ref[cbi_ref],
+                              &codonwlib.amino_prop, factor_in_rare)
+    with nogil:
+        ret = codonwlib.batch_summary(n, np.PyArray_DATA(ncod), np.PyArray_DATA(naa), ctype,
+                                      &which[0], which.shape[0], &group[0], &pi, &s,
+                                      max(threads, 1))
+    if ret < 0:
+        raise MemoryError()
@@ -14,6 +14,7 @@ codonwlib = Extension(
     "codonw.codonwlib",
     ext_files,
     include_dirs=["codonw/codonwlib/include/", np.get_include()],
+    libraries=["z", "pthread"],
 )
 
 this_directory = os.path.abspath(os.path.dirname(__file__))
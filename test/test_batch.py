@@ -0,0 +1,198 @@
+"""
+
+codonw-slim tests of counting and index calculation in batches
+
+"""
+
+import os
+from multiprocessing import shared_memory
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def reference_indices(seq):
+    cseq = codonw.CodonSeq(seq)
+    bases = cseq.bases2()
+    return [cseq.cai(), cseq.fop(), cseq.cbi(), cseq.enc(), cseq.hydropathy(),
+            cseq.aromaticity(), bases['GC'], bases['GC3s'], bases['Len_sym'],
+            bases['Len_aa']] + list(cseq.silent_base_usage_())
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_count_sequences(threads):
+    seqs = pd.Series([s for _, s in test_records], index=[r for r, _ in test_records])
+    counts = codonw.count_sequences(seqs, threads=threads)
+    assert list(counts.ids) == list(seqs.index)
+    for i, seq in enumerate(seqs):
+        ref = codonw.CodonSeq(seq)
+        np.testing.assert_array_equal(counts.ncod[i], ref.ncod)
+        np.testing.assert_array_equal(counts.naa[i], ref.naa)
+        assert counts.codon_tot[i] == ref.codon_tot
+        assert counts.valid_stops[i] == ref.valid_stops
+
+
+@pytest.mark.parametrize("threads", [1, 4])
+def test_compute_indices(threads):
+    counts = codonw.count_sequences([s for _, s in test_records])
+    df = codonw.compute_indices(counts, threads=threads)
+    assert list(df.columns) == codonw.index_names
+
+    expected = np.array([reference_indices(s) for _, s in test_records])
+    # CodonSeq.enc leaves a partial sum where Nc can not be calculated
+    expected[df['Nc'].isna().values, 3] = np.nan
+    np.testing.assert_allclose(df.values, expected, rtol=1e-6, equal_nan=True)
+
+
+def test_compute_indices_subset():
+    counts = codonw.count_sequences([s for _, s in test_records[:5]])
+    df = counts.indices(['G3s', 'CAI'], cai_ref=1)
+    for i, (_, seq) in enumerate(test_records[:5]):
+        cseq = codonw.CodonSeq(seq)
+        assert df['CAI'][i] == cseq.cai(1)
+        assert df['G3s'][i] == cseq.silent_base_usage_()[3]
+
+    with pytest.raises(ValueError):
+        counts.indices(['nope'])
+    with pytest.raises(ValueError):
+        counts.indices(cai_ref=100)
+
+
+def test_compute_indices_shared_memory():
+    seqs = [s for _, s in test_records]
+    cols = ['CAI', 'GC3s', 'Nc']
+    expected = codonw.compute_indices(codonw.count_sequences(seqs), cols).values
+
+    shm = shared_memory.SharedMemory(create=True, size=len(seqs) * len(cols) * 8)
+    try:
+        half = len(seqs) // 2
+        for lo, hi in [(0, half), (half, len(seqs))]:
+            part = codonw.count_sequences(seqs[lo:hi])
+            codonw.compute_indices(part, cols, out=shm, row_offset=lo)
+
+        result = np.ndarray([len(seqs), len(cols)], dtype=np.float64, buffer=shm.buf)
+        np.testing.assert_array_equal(result, expected)
+        del result
+    finally:
+        shm.close()
+        shm.unlink()
+
+
+def test_compute_indices_out_checks():
+    counts = codonw.count_sequences([s for _, s in test_records[:4]])
+    out = np.zeros([6, 2])
+    assert codonw.compute_indices(counts, ['CAI', 'Fop'], out=out, row_offset=2) is out
+    assert (out[:2] == 0).all() and (out[2:] != 0).all()
+
+    with pytest.raises(ValueError):
+        codonw.compute_indices(counts, ['CAI', 'Fop'], out=out, row_offset=3)
+    with pytest.raises(ValueError):
+        codonw.compute_indices(counts, ['CAI'], out=out)
+
+
+@pytest.mark.parametrize("dtype", ["auto", np.uint16, np.uint32])
+def test_narrow_counts(dtype):
+    seqs = [s for _, s in test_records]
+    wide = codonw.count_sequences(seqs)
+    narrow = codonw.count_sequences(seqs, dtype=dtype, threads=2)
+    assert narrow.ncod.dtype == narrow.naa.dtype == np.dtype(np.uint16 if dtype == "auto" else dtype)
+    np.testing.assert_array_equal(narrow.ncod, wide.ncod)
+    np.testing.assert_array_equal(narrow.naa, wide.naa)
+
+    np.testing.assert_array_equal(narrow.indices().values, wide.indices().values)
+    assert narrow[2].cai() == wide[2].cai()
+    np.testing.assert_array_equal(wide.astype("auto").ncod, narrow.ncod)
+
+
+def test_narrow_counts_overflow():
+    long_seq = "GCT" * 70000
+    counts = codonw.count_sequences([long_seq], dtype="auto")
+    assert counts.ncod.dtype == np.uint32
+    assert counts.ncod.max() == counts.naa.max() == 70000
+    with pytest.raises(OverflowError):
+        codonw.count_sequences([long_seq], dtype=np.uint16)
+    with pytest.raises(OverflowError):
+        counts.astype(np.uint16)
+    with pytest.raises(ValueError):
+        counts.astype(np.int8)
+
+
+def test_stream_digest():
+    seq = test_records[0][1]
+    whole = codonw.CodonStream(hash=True)
+    whole.feed(seq)
+    whole.finish()
+    chunked = codonw.CodonStream(hash=True)
+    for k in range(0, len(seq), 7):
+        chunked.feed(seq[k:k + 7])
+    chunked.finish()
+    np.testing.assert_array_equal(whole.digest, chunked.digest)
+
+    with pytest.raises(ValueError):
+        codonw.CodonStream().digest
+
+    mmh3 = pytest.importorskip("mmh3")
+    for s in ["", "A", "ACGTACGTACGTACG", "ACGTACGTACGTACGT", seq]:
+        stream = codonw.CodonStream(hash=True)
+        stream.feed(s)
+        stream.finish()
+        ref = mmh3.hash128(s.encode(), 0, True, signed=False)
+        assert int(stream.digest[0]) | (int(stream.digest[1]) << 64) == ref
+
+
+def test_dedup(tmp_path):
+    seqs = [s for _, s in test_records[:10]]
+    dup = seqs + seqs[:4] + seqs[2:3] * 3
+    counts = codonw.count_sequences(dup, hash=True, threads=2)
+
+    uniq, inverse = counts.unique()
+    assert len(uniq) == 10
+    assert list(inverse) == list(range(10)) + [0, 1, 2, 3, 2, 2, 2]
+    assert counts.dedup_ratio() == pytest.approx(7 / 17)
+
+    plain = codonw.compute_indices(counts)
+    dedup = codonw.compute_indices(counts, dedup=True)
+    np.testing.assert_array_equal(plain.values, dedup.values)
+    assert dedup.attrs['dedup_ratio'] == pytest.approx(7 / 17)
+
+    # FASTA records hash their bases whatever the line wrapping
+    fn = str(tmp_path / "dup.fna")
+    with open(fn, 'w') as fh:
+        for i, s in enumerate(dup):
+            width = 60 if i % 2 else 17
+            fh.write(">r{}\n{}\n".format(i, "\n".join(s[k:k + width] for k in range(0, len(s), width))))
+    fasta = codonw.count_fasta(fn, hash=True)
+    np.testing.assert_array_equal(fasta.digests, counts.digests)
+
+    fn_saved = str(tmp_path / "dup.npz")
+    fasta.save(fn_saved)
+    np.testing.assert_array_equal(codonw.CodonCounts.load(fn_saved).digests, counts.digests)
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_count_translate(threads):
+    from Bio.Seq import Seq
+    seqs = [s for _, s in test_records] + ["ATGNNNTAAGC", "AUGGCU", ""]
+    plain = codonw.count_sequences(seqs)
+    counts, proteins = codonw.count_sequences(seqs, translate=True, threads=threads,
+                                              dtype="auto")
+    np.testing.assert_array_equal(counts.ncod, plain.ncod)
+    assert list(proteins.index) == list(counts.ids)
+
+    for seq, prot in zip(seqs[:-3], proteins):
+        whole = seq[:len(seq) - len(seq) % 3]
+        assert prot == str(Seq(whole).translate())
+    assert list(proteins[-3:]) == ["MX*", "MA", ""]
+
+    _, empty = codonw.count_sequences([], translate=True)
+    assert len(empty) == 0
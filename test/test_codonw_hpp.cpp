@@ -0,0 +1,224 @@
+/* codonw-slim tests of the C++ kernels of codonw.hpp against libcodonw,
+   run by ctest with the path of input.fna */
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "codonw.hpp"
+#include "libcodonw.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+   do                                                                       \
+   {                                                                        \
+      if (!(cond))                                                          \
+      {                                                                     \
+         std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         failures++;                                                        \
+      }                                                                     \
+   } while (0)
+
+static bool same(double a, double b)
+{
+   return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+/* the records of a FASTA file */
+static std::vector<std::string> read_fasta(const char *fn)
+{
+   std::ifstream in(fn);
+   std::vector<std::string> seqs;
+   std::string line;
+
+   while (std::getline(in, line))
+   {
+      if (!line.empty() && line.back() == '\r')
+         line.pop_back();
+      if (!line.empty() && line[0] == '>')
+         seqs.emplace_back();
+      else if (!seqs.empty())
+         seqs.back() += line;
+   }
+   return seqs;
+}
+
+/* Fop as fop() of codon_idx.c, looping over the code at run time */
+static double reference_fop(const int *ca, const int *ds, const long *ncod,
+                            const char *fop_cod, bool factor_in_rare)
+{
+   bool has_opt_info[22] = {false};
+   long opt = 0, common = 0, nonopt = 0;
+   int x;
+
+   for (x = 1; x < 65; x++)
+      if (ca[x] != 11 && ds[x] != 1 &&
+          (fop_cod[x] == 3 || (factor_in_rare && fop_cod[x] == 1)))
+         has_opt_info[ca[x]] = true;
+   for (x = 1; x < 65; x++)
+   {
+      if (!has_opt_info[ca[x]])
+         continue;
+      if (fop_cod[x] == 3)
+         opt += ncod[x];
+      else if (fop_cod[x] == 2)
+         common += ncod[x];
+      else if (fop_cod[x] == 1)
+         nonopt += ncod[x];
+      else
+         return NAN;
+   }
+   if (factor_in_rare && opt + common + nonopt)
+      return (float)(opt - nonopt) / (float)(opt + common + nonopt);
+   if (opt + common + nonopt)
+      return (float)opt / (float)(opt + common + nonopt);
+   return 0;
+}
+
+/* every kernel of one code, compared with libcodonw and the Dynamic   */
+/* tables of the same code                                             */
+template <class Code>
+static void check_code(const Code &code, const codonw::Dynamic &dyn,
+                       const codonw_counts &c, const codonw_metrics &m,
+                       const float *w, const char *fop_cod)
+{
+   const codonw::CodeTables &t = codonw::tables(code);
+   codonw::BaseComposition b = codonw::gc(code, c.ncod), bd = codonw::gc(dyn, c.ncod);
+   float rscu[65], rscu_dyn[65];
+   int x;
+
+   CHECK(codonw::cai(code, c.ncod, w) == m.cai);
+   CHECK(codonw::cai(dyn, c.ncod, w) == m.cai);
+   CHECK(same(codonw::enc(code, c.ncod, c.naa), m.nc));
+   CHECK(same(codonw::enc(dyn, c.ncod, c.naa), m.nc));
+   CHECK(same(b.gc, m.gc) && same(b.gc3s, m.gc3s));
+   CHECK(b.l_sym == (long)m.l_sym && b.l_aa == (long)m.l_aa);
+   CHECK(same(bd.gc, b.gc) && same(bd.gc3s, b.gc3s) && bd.l_sym == b.l_sym);
+
+   for (bool rare : {false, true})
+   {
+      double f = reference_fop(t.ca, t.ds, c.ncod, fop_cod, rare);
+      CHECK(same(codonw::fop(code, c.ncod, fop_cod, rare), f));
+      CHECK(same(codonw::fop(dyn, c.ncod, fop_cod, rare), f));
+   }
+
+   codonw::rscu(code, c.ncod, c.naa, rscu);
+   codonw::rscu(dyn, c.ncod, c.naa, rscu_dyn);
+   for (x = 1; x < 65; x++)
+   {
+      float r = c.naa[t.ca[x]] ? (float)c.ncod[x] / (float)c.naa[t.ca[x]] * (float)t.ds[x] : 0;
+      CHECK(rscu[x] == r && rscu_dyn[x] == r);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   std::vector<std::string> seqs;
+   double w[64];
+   float w_cod[65] = {0};
+   char fop_cod[65] = {0};
+   int id, k, x;
+
+   if (argc < 2 || (seqs = read_fasta(argv[1])).empty())
+   {
+      std::fprintf(stderr, "usage: %s input.fna\n", argv[0]);
+      return 2;
+   }
+
+   /* w values and codon classes that differ between the codons of a family */
+   for (k = 0; k < 64; k++)
+   {
+      w[k] = (k % 7) / 6.0;
+      w_cod[codonw::ncbi_icode(k)] = (float)w[k];
+      fop_cod[codonw::ncbi_icode(k)] = (char)(1 + k % 3);
+   }
+
+   /* the tables are made at compile time */
+   static_assert(codonw::builtin_tables<0>.nsense == 61, "");
+   static_assert(codonw::builtin_tables<0>.nsyn == 59, "");
+   static_assert(codonw::builtin_tables<1>.nsense == 60, "");
+   static_assert(codonw::builtin_tables<2>.da[8] == 8, "");
+   static_assert(codonw::builtin_tables<0>.fold[2] == 9 &&
+                     codonw::builtin_tables<0>.fold[6] == 3, "");
+
+   for (id = 0; id < codonw::num_builtin_codes; id++)
+   {
+      codonw_options opt;
+      codonw_ctx *ctx;
+      codonw::Dynamic dyn(codonw::builtin_translation[id]);
+
+      codonw_options_default(&opt);
+      opt.genetic_code = id;
+      opt.cai_w = w;
+      CHECK(codonw_create(&opt, &ctx) == CODONW_OK);
+      CHECK(codonw::builtin_id(dyn.tables.ca) == id);
+
+      for (const std::string &s : seqs)
+      {
+         codonw_counts c;
+         codonw_metrics m;
+
+         CHECK(codonw_score(ctx, s.data(), s.size(), &c, &m) == CODONW_OK);
+         codonw::with_code(id, [&](auto code) {
+            check_code(code, dyn, c, m, w_cod, fop_cod);
+         });
+      }
+      codonw_destroy(ctx);
+   }
+
+   /* dispatch by the amino acids of the codons */
+   {
+      codonw::Dynamic universal(codonw::builtin_translation[0]);
+      int ca[65];
+      bool builtin = false;
+
+      for (x = 0; x < 65; x++)
+         ca[x] = universal.tables.ca[x];
+      codonw::with_code(ca, [&](auto code) {
+         builtin = !std::is_same<decltype(code), codonw::Dynamic>::value;
+      });
+      CHECK(builtin);
+
+      /* AGA and AGG as stops, which no code of cu_ref has */
+      ca[44] = ca[48] = codonw::stop_aa;
+      CHECK(codonw::builtin_id(ca) == -1);
+      codonw::with_code(ca, [&](auto code) {
+         builtin = !std::is_same<decltype(code), codonw::Dynamic>::value;
+         CHECK(codonw::tables(code).da[21] == 4);
+      });
+      CHECK(!builtin);
+   }
+
+   /* invalid codes */
+   {
+      bool thrown = false;
+      try
+      {
+         codonw::with_code(8, [](auto) {});
+      }
+      catch (const std::out_of_range &)
+      {
+         thrown = true;
+      }
+      CHECK(thrown);
+
+      thrown = false;
+      try
+      {
+         codonw::Dynamic bad("FFLL");
+      }
+      catch (const std::invalid_argument &)
+      {
+         thrown = true;
+      }
+      CHECK(thrown);
+   }
+
+   if (failures)
+      std::fprintf(stderr, "%d checks failed\n", failures);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+"""
+
+codonw-slim tests of distances between the codon usage of sequences
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+@pytest.fixture(scope="module")
+def counts():
+    return codonw.count_sequences([s for _, s in test_records])
+
+
+def reference_distances(counts, metric, on):
+    """Pairwise distances in numpy, as a square matrix"""
+    ncod = counts.ncod[:, 1:65].astype(float)
+    code = codonw.CodonSeq("").genetic_code[codonw.ref_codons[1:65]].values
+    aas = sorted(set(code))
+    onehot = np.array([[c == a for a in aas] for c in code], dtype=float)  # 64 x naa
+    per_aa = ncod @ onehot                       # N x naa
+    codon_aa = per_aa @ onehot.T                 # N x 64, codons of the amino acid
+    with np.errstate(invalid='ignore', divide='ignore'):
+        within = np.nan_to_num(ncod / codon_aa)
+        freq = np.nan_to_num(ncod / ncod.sum(axis=1, keepdims=True))
+
+    if metric == 'chi2':
+        f = freq
+        s, d = f[:, None] + f[None], f[:, None] - f[None]
+        with np.errstate(invalid='ignore', divide='ignore'):
+            return np.nan_to_num(d * d / s).sum(axis=2)
+    if metric == 'karlin':
+        sense = per_aa * np.array([a != '*' for a in aas])
+        with np.errstate(invalid='ignore', divide='ignore'):
+            p = np.nan_to_num(sense / sense.sum(axis=1, keepdims=True)) @ onehot.T * 0.5
+        return ((p[:, None] + p[None]) * np.abs(within[:, None] - within[None])).sum(axis=2)
+
+    if on == 'rscu':
+        f = np.array([codonw.CodonSeq(s).rscu().values for _, s in test_records])
+    else:
+        f = freq
+    d = f[:, None] - f[None]
+    if metric == 'euclidean':
+        return np.sqrt((d * d).sum(axis=2))
+    return np.abs(d).sum(axis=2)
+
+
+def condensed(square):
+    return square[np.triu_indices(len(square), 1)]
+
+
+@pytest.mark.parametrize("metric,on", [("euclidean", "rscu"), ("manhattan", "rscu"),
+                                       ("euclidean", "freq"), ("chi2", "freq"),
+                                       ("karlin", "freq")])
+@pytest.mark.parametrize("threads", [1, 3])
+def test_distances(counts, metric, on, threads):
+    expected = reference_distances(counts, metric, on)
+    dist = codonw.codon_distances(counts, metric, on, threads=threads)
+    # RSCU of CodonSeq is single precision
+    np.testing.assert_allclose(dist, condensed(expected), rtol=1e-5, atol=1e-5)
+
+    blocks = list(codonw.distance_blocks(counts.astype("auto"), metric=metric, on=on,
+                                         block=40, threads=threads))
+    assert [b[0] for b in blocks] == [slice(0, 40), slice(40, 80), slice(80, 111)]
+    square = np.concatenate([b[1] for b in blocks])
+    np.testing.assert_allclose(condensed(square), dist, rtol=1e-12)
+
+
+def test_threshold(counts):
+    dist = codonw.codon_distances(counts, "manhattan", threads=2)
+    cut = np.quantile(dist, 0.1)
+    close = codonw.codon_distances(counts, "manhattan", threshold=cut, threads=2)
+    i, j = np.triu_indices(len(counts), 1)
+    keep = dist <= cut
+    np.testing.assert_array_equal(close['i'], i[keep])
+    np.testing.assert_array_equal(close['j'], j[keep])
+    np.testing.assert_array_equal(close['distance'], dist[keep])
+
+    assert len(codonw.codon_distances(counts, threshold=-1)) == 0
+    with pytest.raises(ValueError):
+        codonw.codon_distances(counts, "cosine")
+
+
+def test_cross_distances(counts):
+    first, rest = counts.take(slice(0, 10)), counts.take(slice(10, None))
+    (rows, block), = codonw.distance_blocks(first, rest, metric="chi2")
+    assert rows == slice(0, 10) and block.shape == (10, len(counts) - 10)
+    full = reference_distances(counts, "chi2", "freq")
+    np.testing.assert_allclose(block, full[:10, 10:], rtol=1e-10, atol=1e-12)
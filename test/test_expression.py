@@ -0,0 +1,110 @@
+"""
+
+codonw-slim tests of expression level predictors against per genome
+references
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def families(code):
+    """Codon columns (1..64) of each amino acid with several codons"""
+    aa = np.array([code[c] for c in codonw.ref_codons[1:65]])
+    fam = {}
+    for x, a in enumerate(aa, 1):
+        if a != '*':
+            fam.setdefault(a, []).append(x)
+    return [np.array(v) for v in fam.values() if len(v) > 1], (aa != '*')
+
+
+def reference(ncod, tot, pseudo, fams, sense):
+    """Karlin's B and MILC of each row of ncod against tot, in Python"""
+    ref = np.zeros(65)
+    for f in fams:
+        ref[f] = (tot[f] + pseudo) / (tot[f] + pseudo).sum()
+    b, milc = [], []
+    for row in ncod:
+        length = row[1:65][sense].sum()
+        sb = sm = corr = 0.0
+        for f in fams:
+            na = row[f].sum()
+            if not na:
+                continue
+            sb += np.abs(row[f] / na - ref[f]).sum() * na
+            o = row[f]
+            sm += 2 * (o[o > 0] * np.log(o[o > 0] / (na * ref[f][o > 0]))).sum()
+            corr += len(f) - 1
+        b.append(sb / length)
+        milc.append(sm / length - (corr / length - 0.5))
+    return np.array(b), np.array(milc)
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_expression_indices(threads):
+    seqs = [s for _, s in test_records]
+    counts = codonw.count_sequences(seqs, threads=2)
+    n = len(counts)
+    groups = np.array(["g{}".format(i % 3) for i in range(n)], dtype=object)
+    he = np.arange(n) % 4 == 0
+
+    df = codonw.expression_indices(counts, he, groups=groups, pseudocount=0.5,
+                                   threads=threads)
+    assert list(df.columns) == codonw.expression_names
+    assert list(df.index) == list(counts.ids)
+
+    fams, sense = families(codonw.CodonSeq("").genetic_code)
+    for g in ["g0", "g1", "g2"]:
+        rows = groups == g
+        ncod = counts.ncod[rows]
+        b, milc = reference(ncod, ncod.sum(axis=0), 0.5, fams, sense)
+        b_he, milc_he = reference(ncod, counts.ncod[rows & he].sum(axis=0), 0.5, fams, sense)
+        part = df[rows]
+        np.testing.assert_allclose(part['B'], b, rtol=1e-10)
+        np.testing.assert_allclose(part['B_HE'], b_he, rtol=1e-10)
+        np.testing.assert_allclose(part['MILC'], milc, rtol=1e-10)
+        np.testing.assert_allclose(part['MILC_HE'], milc_he, rtol=1e-10)
+        np.testing.assert_allclose(part['E'], b / b_he, rtol=1e-10)
+        np.testing.assert_allclose(part['MELP'], milc / milc_he, rtol=1e-10)
+
+
+def test_expression_options():
+    seqs = [s for _, s in test_records[:12]]
+    counts = codonw.count_sequences(seqs, dtype=np.uint16)
+    ids = list(counts.ids[:3])
+
+    by_id = codonw.expression_indices(counts, ids, ['B', 'MELP'])
+    mask = codonw.expression_indices(counts, np.arange(12) < 3, ['B', 'MELP'])
+    pd.testing.assert_frame_equal(by_id, mask)
+
+    # a baseline of the genome made elsewhere replaces the sum of its genes
+    whole = codonw.count_sequences(["".join(seqs)], ids=["all"])
+    np.testing.assert_allclose(
+        codonw.expression_indices(counts, ids, baseline=whole).values,
+        codonw.expression_indices(counts, ids).values)
+    with pytest.raises(ValueError):
+        codonw.expression_indices(counts, ids, baseline=whole, groups=["x"] * 12)
+
+    # no highly expressed genes, or no sense codons, give NaN
+    empty = codonw.count_sequences(seqs[:2] + [""])
+    df = codonw.expression_indices(empty, [False] * 3)
+    assert df['B_HE'].isna().all() and df['B'][:2].notna().all()
+    assert df.iloc[2].isna().all()
+
+    with pytest.raises(ValueError):
+        codonw.expression_indices(counts, ids, ['nope'])
+    with pytest.raises(ValueError):
+        codonw.expression_indices(counts, [True])
@@ -0,0 +1,179 @@
+"""
+
+codonw-slim tests of the native sequence file readers
+
+"""
+
+import os
+import gzip
+import shutil
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+import Bio.bgzf
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def check_counts(counts, records=test_records):
+    assert len(counts) == len(records)
+    for i, (rid, seq) in enumerate(records):
+        ref = codonw.CodonSeq(seq)
+        assert counts.ids[i] == rid
+        np.testing.assert_array_equal(counts.ncod[i], ref.ncod)
+        np.testing.assert_array_equal(counts.naa[i], ref.naa)
+        assert counts.codon_tot[i] == ref.codon_tot
+        assert counts.valid_stops[i] == ref.valid_stops
+
+
+@pytest.fixture(scope="module")
+def compressed(tmp_path_factory):
+    tmp = tmp_path_factory.mktemp("fasta")
+    gz_fn = str(tmp / "input.fna.gz")
+    with open(seq_fn, 'rb') as fin, gzip.open(gz_fn, 'wb') as fout:
+        shutil.copyfileobj(fin, fout)
+
+    bgz_fn = str(tmp / "input.fna.bgz")
+    with open(seq_fn, 'rb') as fin, Bio.bgzf.BgzfWriter(bgz_fn, 'wb') as fout:
+        fout.write(fin.read())
+    return gz_fn, bgz_fn
+
+
+def test_count_fasta():
+    counts = codonw.count_fasta(seq_fn)
+    check_counts(counts)
+    assert counts[3].cai() == codonw.CodonSeq(test_records[3][1]).cai()
+
+
+@pytest.mark.parametrize("threads", [1, 4])
+def test_count_fasta_compressed(compressed, threads):
+    for fn in compressed:
+        check_counts(codonw.count_fasta(fn, threads=threads))
+
+
+def test_count_fasta_line_endings(tmp_path):
+    fn = str(tmp_path / "crlf.fna")
+    with open(fn, 'w', newline='') as fh:
+        fh.write(">a first\r\nATGAA\r\nATAA\r\n>b\r\n\r\nATG NNN\r\n")
+    counts = codonw.count_fasta(fn)
+    check_counts(counts, [("a", "ATGAAATAA"), ("b", "ATGNNN")])
+    assert list(counts.titles) == ["a first", "b"]
+
+
+def test_count_fasta_dtype(tmp_path, monkeypatch):
+    def no_astype(self, dtype):
+        raise AssertionError("counted as long and narrowed")
+    monkeypatch.setattr(codonw.CodonCounts, "astype", no_astype)
+
+    for dtype in (np.uint16, np.uint32, "auto"):
+        counts = codonw.count_fasta(seq_fn, dtype=dtype)
+        assert counts.ncod.dtype == (np.uint16 if dtype == "auto" else dtype)
+        assert counts.naa.dtype == counts.ncod.dtype
+        check_counts(counts)
+
+    # a record past uint16 widens "auto" from the rows already read
+    fn = str(tmp_path / "long.fna")
+    with open(fn, 'w') as fh:
+        fh.write(">a\nATGAAA\n>b\n" + "AAA" * 70000 + "\n>c\nATG\n")
+    counts = codonw.count_fasta(fn, dtype="auto")
+    assert counts.ncod.dtype == np.uint32
+    check_counts(counts, [("a", "ATGAAA"), ("b", "AAA" * 70000), ("c", "ATG")])
+    with pytest.raises(OverflowError):
+        codonw.count_fasta(fn, dtype=np.uint16)
+
+
+def test_count_fasta_missing():
+    with pytest.raises(IOError):
+        codonw.count_fasta("{}/does_not_exist.fna".format(path))
+
+
+def write_fai(fn):
+    """Writes a samtools style index of a FASTA file with uniform lines"""
+    rows = []
+    with open(fn, 'rb') as fh:
+        offset = 0
+        for line in fh:
+            if line.startswith(b'>'):
+                rows.append([line[1:].split()[0].decode(), 0, offset + len(line), 0, 0])
+            elif rows:
+                if rows[-1][3] == 0:
+                    rows[-1][3:5] = [len(line.rstrip()), len(line)]
+                rows[-1][1] += len(line.rstrip())
+            offset += len(line)
+    with open(fn + ".fai", 'w') as fh:
+        for r in rows:
+            fh.write("\t".join(map(str, r)) + "\n")
+
+
+@pytest.mark.parametrize("n", [1, 2, 3, 7, 200])
+@pytest.mark.parametrize("use_fai", [False, True])
+def test_count_fasta_shards(tmp_path, n, use_fai):
+    fn = str(tmp_path / "input.fna")
+    shutil.copy(seq_fn, fn)
+    if use_fai:
+        write_fai(fn)
+
+    parts = []
+    for k in range(n):
+        part = codonw.count_fasta(fn, shard=(k, n), fai=True if use_fai else None)
+        part_fn = str(tmp_path / "part{}.npz".format(k))
+        part.save(part_fn)
+        parts.append(part_fn)
+
+    merged = codonw.merge_counts(parts)
+    check_counts(merged)
+    assert list(merged.titles) == list(codonw.count_fasta(fn).titles)
+
+
+def test_shard_ranges_balanced(tmp_path):
+    fn = str(tmp_path / "input.fna")
+    shutil.copy(seq_fn, fn)
+    write_fai(fn)
+
+    lengths = [len(s) for _, s in test_records]
+    for start, end in codonw.shard_ranges(fn, 4, fai=True):
+        counts = codonw.count_fasta(fn, byte_range=(start, end))
+        bases = sum(lengths[i] for i, (rid, _) in enumerate(test_records)
+                    if rid in set(counts.ids))
+        assert abs(bases - sum(lengths) / 4) <= max(lengths)
+
+
+def test_count_fasta_shard_compressed(compressed):
+    with pytest.raises(ValueError):
+        codonw.count_fasta(compressed[0], shard=(0, 2))
+
+
+def test_scan_files(tmp_path):
+    fns, groups = [], []
+    with open(seq_fn) as fh:
+        records = fh.read().split('>')[1:]
+    for k in range(5):
+        fn = str(tmp_path / "genome{}.fna{}".format(k, ".gz" if k % 2 else ""))
+        opener = gzip.open if k % 2 else open
+        with opener(fn, 'wt') as fh:
+            for r in records[k::5]:
+                fh.write('>' + r)
+        fns.append(fn)
+        groups.append(test_records[k::5])
+
+    per_file, per_gene = codonw.scan_files(fns, genes=True, threads=3)
+
+    assert list(per_file.ids) == fns
+    for k, recs in enumerate(groups):
+        ncod = sum(codonw.CodonSeq(seq).ncod.base for _, seq in recs)
+        np.testing.assert_array_equal(per_file.ncod[k], ncod)
+        assert per_file.codon_tot[k] == sum(len(seq) // 3 for _, seq in recs)
+
+    check_counts(per_gene, [r for recs in groups for r in recs])
+    assert list(per_gene.groups) == [fn for fn, recs in zip(fns, groups) for _ in recs]
+
+    genes_only = codonw.scan_files(fns, aggregate=None)
+    np.testing.assert_array_equal(genes_only.ncod, per_gene.ncod)
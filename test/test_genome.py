@@ -0,0 +1,217 @@
+"""
+
+codonw-slim tests of counting annotated coding sequences in a genome FASTA
+or .2bit file
+
+"""
+
+import os
+
+import numpy as np
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+# two "chromosomes" made from the test genes
+chroms = {"chrA": "".join(s for _, s in test_records[:8]),
+          "chrB": "".join(s for _, s in test_records[8:16])}
+
+# (id, chrom, strand, phase of first segment, segments 0 based, end exclusive)
+transcripts = [
+    ("t1", "chrA", "+", 0, [(10, 200), (350, 611), (900, 1001)]),
+    ("t2", "chrA", "-", 0, [(1200, 1301), (1500, 1750)]),
+    ("t3", "chrB", "-", 2, [(30, 91), (300, 452), (600, 800)]),
+    ("t4", "chrB", "+", 1, [(1000, 1457)]),
+]
+
+
+def revcomp(s):
+    return s[::-1].translate(str.maketrans("ACGTacgt", "TGCAtgca"))
+
+
+def spliced(chrom, strand, phase, segs):
+    seq = "".join(chroms[chrom][s:e] for s, e in sorted(segs))
+    if strand == "-":
+        seq = revcomp(seq)
+    return seq[phase:]
+
+
+def write_genome(fn, width=60, crlf=False):
+    nl = "\r\n" if crlf else "\n"
+    with open(fn, "w", newline="") as fh:
+        for name, seq in chroms.items():
+            fh.write(">{} some description{}".format(name, nl))
+            fh.write(nl.join(seq[k:k + width] for k in range(0, len(seq), width)) + nl)
+
+
+def write_gff3(fn):
+    with open(fn, "w") as fh:
+        fh.write("##gff-version 3\n")
+        for tid, chrom, strand, phase, segs in transcripts:
+            fh.write("{}\ttest\tmRNA\t{}\t{}\t.\t{}\t.\tID={}\n".format(
+                chrom, segs[0][0] + 1, segs[-1][1], strand, tid))
+            # the phase is that of the first segment in transcription order
+            order = segs if strand == "+" else segs[::-1]
+            for s, e in segs:
+                p = phase if (s, e) == order[0] else 0
+                fh.write("{}\ttest\tCDS\t{}\t{}\t.\t{}\t{}\tParent={}\n".format(
+                    chrom, s + 1, e, strand, p, tid))
+
+
+def write_bed12(fn):
+    with open(fn, "w") as fh:
+        fh.write("track name=test\n")
+        for tid, chrom, strand, phase, segs in transcripts:
+            # one UTR base either side of the coding part
+            start, end = segs[0][0] - 1, segs[-1][1] + 1
+            blocks = [(s - 1 if i == 0 else s, e + 1 if i == len(segs) - 1 else e)
+                      for i, (s, e) in enumerate(segs)]
+            thick = (segs[0][0] + (phase if strand == "+" else 0),
+                     segs[-1][1] - (phase if strand == "-" else 0))
+            fh.write("\t".join(map(str, [
+                chrom, start, end, tid, 0, strand, thick[0], thick[1], 0, len(blocks),
+                ",".join(str(e - s) for s, e in blocks) + ",",
+                ",".join(str(s - start) for s, _ in blocks) + ","])) + "\n")
+
+
+def check_counts(counts):
+    assert list(counts.ids) == [t[0] for t in transcripts]
+    assert list(counts.groups) == [t[1] for t in transcripts]
+    for i, (_, chrom, strand, phase, segs) in enumerate(transcripts):
+        ref = codonw.CodonSeq(spliced(chrom, strand, phase, segs))
+        np.testing.assert_array_equal(counts.ncod[i], ref.ncod)
+        np.testing.assert_array_equal(counts.naa[i], ref.naa)
+        assert counts.codon_tot[i] == ref.codon_tot
+        assert counts.valid_stops[i] == ref.valid_stops
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+@pytest.mark.parametrize("crlf", [False, True])
+def test_count_cds_gff3(tmp_path, threads, crlf):
+    genome_fn, gff_fn = str(tmp_path / "genome.fna"), str(tmp_path / "genes.gff3")
+    write_genome(genome_fn, crlf=crlf)
+    write_gff3(gff_fn)
+
+    genome = codonw.Genome(genome_fn)
+    assert genome.names == list(chroms)
+    assert list(genome.lengths) == [len(s) for s in chroms.values()]
+    check_counts(genome.count_cds(gff_fn, threads=threads))
+
+
+def test_count_cds_bed12(tmp_path):
+    genome_fn, bed_fn = str(tmp_path / "genome.fna"), str(tmp_path / "genes.bed")
+    write_genome(genome_fn, width=70)
+    write_bed12(bed_fn)
+    check_counts(codonw.count_cds(genome_fn, bed_fn))
+
+
+def test_count_cds_errors(tmp_path):
+    genome_fn = str(tmp_path / "genome.fna")
+    write_genome(genome_fn)
+    genome = codonw.Genome(genome_fn)
+
+    gff_fn = str(tmp_path / "bad.gff3")
+    with open(gff_fn, "w") as fh:
+        fh.write("chrZ\ttest\tCDS\t1\t30\t.\t+\t0\tParent=x\n")
+    with pytest.raises(ValueError):
+        genome.count_cds(gff_fn)
+
+    with open(gff_fn, "w") as fh:
+        fh.write("chrA\ttest\tCDS\t1\t{}\t.\t+\t0\tParent=x\n".format(len(chroms["chrA"]) + 1))
+    with pytest.raises(ValueError):
+        genome.count_cds(gff_fn)
+
+    ragged_fn = str(tmp_path / "ragged.fna")
+    with open(ragged_fn, "w") as fh:
+        fh.write(">chrA\nACGTACGT\nACG\nACGTACGT\n")
+    with pytest.raises(ValueError):
+        codonw.Genome(ragged_fn)
+
+
+def write_twobit(fn, seqs, version=0, order="<"):
+    """Writes seqs (a dict) as a UCSC .2bit file, keeping runs of N and
+    lower case"""
+    import re
+    import struct
+    word = order + "I"
+    wide = order + ("Q" if version else "I")
+    code = {"T": 0, "C": 1, "A": 2, "G": 3}
+
+    records = []
+    for seq in seqs.values():
+        nruns = [m.span() for m in re.finditer("[Nn]+", seq)]
+        lower = [m.span() for m in re.finditer("[a-z]+", seq)]
+        bases = [code.get(c, 0) for c in seq.upper()] + [0] * (-len(seq) % 4)
+        packed = bytes((bases[k] << 6) | (bases[k + 1] << 4) | (bases[k + 2] << 2) | bases[k + 3]
+                       for k in range(0, len(bases), 4))
+        rec = struct.pack(order + "II", len(seq), len(nruns))
+        rec += b"".join(struct.pack(word, s) for s, _ in nruns)
+        rec += b"".join(struct.pack(word, e - s) for s, e in nruns)
+        rec += struct.pack(word, len(lower))
+        rec += b"".join(struct.pack(word, s) for s, _ in lower)
+        rec += b"".join(struct.pack(word, e - s) for s, e in lower)
+        records.append(rec + struct.pack(word, 0) + packed)
+
+    index_size = sum(1 + len(name) + struct.calcsize(wide) for name in seqs)
+    offset = 16 + index_size
+    out = struct.pack(order + "IIII", 0x1A412743, version, len(seqs), 0)
+    for name, rec in zip(seqs, records):
+        out += struct.pack("B", len(name)) + name.encode() + struct.pack(wide, offset)
+        offset += len(rec)
+    with open(fn, "wb") as fh:
+        fh.write(out + b"".join(records))
+
+
+@pytest.mark.parametrize("version,order", [(0, "<"), (1, "<"), (0, ">")])
+def test_twobit(tmp_path, version, order):
+    # runs of N (one across an exon junction) and soft masked runs
+    masked = {"chrA": chroms["chrA"][:195] + "N" * 10 + chroms["chrA"][205:400] +
+                      chroms["chrA"][400:480].lower() + chroms["chrA"][480:],
+              "chrB": "nnnn" + chroms["chrB"][4:1100] + "NNN" + chroms["chrB"][1103:-3] + "nnn"}
+
+    fasta_fn, twobit_fn = str(tmp_path / "genome.fna"), str(tmp_path / "genome.2bit")
+    gff_fn = str(tmp_path / "genes.gff3")
+    with open(fasta_fn, "w") as fh:
+        for name, seq in masked.items():
+            fh.write(">{}\n{}\n".format(name, "\n".join(seq[k:k + 60] for k in range(0, len(seq), 60))))
+    write_twobit(twobit_fn, masked, version, order)
+    write_gff3(gff_fn)
+
+    fasta, twobit = codonw.Genome(fasta_fn), codonw.Genome(twobit_fn)
+    assert twobit.twobit and not fasta.twobit
+    assert twobit.names == list(masked)
+    assert list(twobit.lengths) == [len(s) for s in masked.values()]
+
+    for name, seq in masked.items():
+        assert twobit.fetch(name) == seq
+        assert fasta.fetch(name) == seq
+        assert twobit.fetch(name, 190, 483, "-") == revcomp(seq[190:483])
+        assert twobit.fetch(name, 190, 483, "-") == fasta.fetch(name, 190, 483, "-")
+        assert twobit.fetch(name, 7, 7) == ""
+
+    expected = fasta.count_cds(gff_fn)
+    assert expected.ncod[0, 0] > 0  # the run of N is counted as non-standard
+    for threads in [1, 2]:
+        counts = twobit.count_cds(gff_fn, threads=threads)
+        np.testing.assert_array_equal(counts.ncod, expected.ncod)
+        np.testing.assert_array_equal(counts.naa, expected.naa)
+        np.testing.assert_array_equal(counts.codon_tot, expected.codon_tot)
+        np.testing.assert_array_equal(counts.valid_stops, expected.valid_stops)
+
+    with pytest.raises(ValueError):
+        twobit.fetch("chrA", 0, len(masked["chrA"]) + 1)
+    with pytest.raises(KeyError):
+        twobit.fetch("chrZ")
+
+    truncated_fn = str(tmp_path / "truncated.2bit")
+    with open(twobit_fn, "rb") as fh, open(truncated_fn, "wb") as out:
+        out.write(fh.read()[:-40])
+    with pytest.raises(ValueError):
+        codonw.Genome(truncated_fn)
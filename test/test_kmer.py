@@ -0,0 +1,105 @@
+"""
+
+codonw-slim tests of k-mer counts by frame
+
+"""
+
+import os
+import itertools
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+extra = ["ACGTNACGTACGGGA", "acgu" * 7, "", "AC", "NNNNACG"]
+
+
+def reference(seq, k):
+    """k-mer counts by the codon position of their first base"""
+    out = {}
+    seq = seq.upper().replace('U', 'T')
+    for p in range(len(seq) - k + 1):
+        word = seq[p:p + k]
+        if set(word) <= set("TCAG"):
+            out.setdefault(word, [0, 0, 0])[p % 3] += 1
+    return out
+
+
+def test_kmer_names():
+    assert codonw.kmer_names(2) == list(codonw.CodonSeq("").dinuc(False).columns)
+    assert codonw.kmer_names(3)[:5] == ["TTT", "TTC", "TTA", "TTG", "TCT"]
+    assert len(codonw.kmer_names(5)) == 4 ** 5
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_dinuc(threads):
+    seqs = [s for _, s in test_records] + extra
+    counts = codonw.kmer_counts(seqs, 2, frame="counted", threads=threads)
+    for i, seq in enumerate(seqs):
+        din = codonw.CodonSeq(seq).dinuc(pct=False).values
+        np.testing.assert_array_equal(counts[i], din[:3])
+
+
+@pytest.mark.parametrize("k", [1, 3, 4])
+def test_kmer_dense(k):
+    seqs = [s for _, s in test_records[:10]] + extra
+    counts = codonw.kmer_counts(seqs, k, threads=2)
+    assert counts.shape == (len(seqs), 3, 4 ** k)
+    names = codonw.kmer_names(k)
+    for i, seq in enumerate(seqs):
+        expected = np.zeros([3, 4 ** k], dtype=int)
+        for word, c in reference(seq, k).items():
+            expected[:, names.index(word)] = c
+        np.testing.assert_array_equal(counts[i], expected)
+
+
+@pytest.mark.parametrize("k", [3, 8, 12])
+def test_kmer_sparse(k):
+    seqs = pd.Series([s for _, s in test_records[:8]] + extra,
+                     index=["s{}".format(i) for i in range(8 + len(extra))])
+    df = codonw.kmer_counts(seqs, k, sparse=True, threads=3)
+    assert list(df.columns) == ['id', 'kmer', '1', '2', '3']
+    for sid, seq in seqs.items():
+        part = df[df['id'] == sid]
+        assert list(part['kmer']) == sorted(part['kmer'], key=lambda w: [
+            "TCAG".index(b) for b in w])
+        got = {w: list(c) for w, c in zip(part['kmer'], part[['1', '2', '3']].values)}
+        assert got == reference(seq, k)
+
+    if k == 3:
+        dense = codonw.kmer_counts(seqs, 3)
+        names = codonw.kmer_names(3)
+        rows = [list(seqs.index).index(s) for s in df['id']]
+        cols = [names.index(w) for w in df['kmer']]
+        np.testing.assert_array_equal(dense[rows, :, cols], df[['1', '2', '3']].values)
+        assert dense.sum() == df[['1', '2', '3']].values.sum()
+
+
+def test_kmer_sparse_k32():
+    # all G at k = 32 packs to every bit set
+    seqs = ["G" * 40, "T" * 33 + "G" * 35, "ACGT" * 20]
+    df = codonw.kmer_counts(seqs, 32, sparse=True, threads=2)
+    for i, seq in enumerate(seqs):
+        part = df[df['id'] == i]
+        got = {w: list(c) for w, c in zip(part['kmer'], part[['1', '2', '3']].values)}
+        assert got == reference(seq, 32)
+    assert list(df[df['id'] == 0]['kmer']) == ["G" * 32]
+
+
+def test_kmer_errors():
+    with pytest.raises(ValueError):
+        codonw.kmer_counts(["ACGT"], 0)
+    with pytest.raises(ValueError):
+        codonw.kmer_counts(["ACGT"], 9, sparse=False)
+    with pytest.raises(ValueError):
+        codonw.kmer_counts(["ACGT"], 2, frame="nope")
+    assert codonw.kmer_counts([], 2).shape == (0, 3, 16)
+    assert len(codonw.kmer_counts([], 9)) == 0
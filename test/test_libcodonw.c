@@ -0,0 +1,179 @@
+/* codonw-slim tests of the embeddable C interface (libcodonw.h), run by
+   ctest with the path of input.fna */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "libcodonw.h"
+
+#define MAX_SEQS 64
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+   do                                                                       \
+   {                                                                        \
+      if (!(cond))                                                          \
+      {                                                                     \
+         fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         failures++;                                                        \
+      }                                                                     \
+   } while (0)
+
+static int close_to(double a, double b)
+{
+   return fabs(a - b) <= 1e-6 * (fabs(b) > 1 ? fabs(b) : 1);
+}
+
+static int same_metrics(const codonw_metrics *a, const codonw_metrics *b)
+{
+   const double *x = (const double *)a, *y = (const double *)b;
+   size_t k;
+
+   for (k = 0; k < sizeof(codonw_metrics) / sizeof(double); k++)
+      if (!(x[k] == y[k] || (isnan(x[k]) && isnan(y[k]))))
+         return 0;
+   return 1;
+}
+
+static int same_counts(const codonw_counts *a, const codonw_counts *b)
+{
+   return !memcmp(a->ncod, b->ncod, sizeof(a->ncod)) &&
+          !memcmp(a->naa, b->naa, sizeof(a->naa)) &&
+          a->codon_tot == b->codon_tot && a->valid_stops == b->valid_stops;
+}
+
+/* reads the records of a FASTA file into seqs, returning their No. */
+static size_t read_fasta(const char *fn, char **seqs, size_t *lens)
+{
+   FILE *fp = fopen(fn, "r");
+   char line[4096];
+   size_t n = 0, k;
+
+   if (!fp)
+      return 0;
+   while (fgets(line, sizeof(line), fp))
+   {
+      if (line[0] == '>')
+      {
+         if (n == MAX_SEQS)
+            break;
+         seqs[n] = NULL;
+         lens[n++] = 0;
+         continue;
+      }
+      if (!n)
+         continue;
+      k = strcspn(line, "\r\n");
+      seqs[n - 1] = realloc(seqs[n - 1], lens[n - 1] + k + 1);
+      memcpy(seqs[n - 1] + lens[n - 1], line, k);
+      lens[n - 1] += k;
+   }
+   fclose(fp);
+   return n;
+}
+
+int main(int argc, char **argv)
+{
+   static const char *standard =
+       "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG";
+   char *seqs[MAX_SEQS + 1];
+   size_t lens[MAX_SEQS + 1], n, i;
+   codonw_options opt;
+   codonw_ctx *ctx, *ctx2;
+   codonw_counts counts, counts2, batch_counts[MAX_SEQS];
+   codonw_metrics m, m2, batch_metrics[MAX_SEQS];
+   double w[64];
+   long sum;
+   int x;
+
+   if (argc < 2 || !(n = read_fasta(argv[1], seqs, lens)))
+   {
+      fprintf(stderr, "usage: %s input.fna\n", argv[0]);
+      return 2;
+   }
+
+   codonw_options_default(&opt);
+   CHECK(codonw_create(&opt, &ctx) == CODONW_OK);
+
+   /* as calculated by codonw.compute_indices for the first record */
+   CHECK(codonw_score(ctx, seqs[0], lens[0], &counts, &m) == CODONW_OK);
+   CHECK(counts.codon_tot == 459 && counts.valid_stops == 1);
+   CHECK(counts.ncod[1] == 27 && counts.ncod[5] == 12);
+   for (sum = 0, x = 0; x < 22; x++)
+      sum += counts.naa[x];
+   CHECK(sum == counts.codon_tot);
+   CHECK(close_to(m.cai, 0.17694742821339282));
+   CHECK(close_to(m.fop, 0.3599088788032532));
+   CHECK(close_to(m.cbi, -0.08285164088010788));
+   CHECK(close_to(m.nc, 54.08925247192383));
+   CHECK(close_to(m.gravy, 0.6106986999511719));
+   CHECK(close_to(m.aromo, 0.12227074801921844));
+   CHECK(close_to(m.gc, 0.3937409024745269));
+   CHECK(close_to(m.gc3s, 0.3348519362186788));
+   CHECK(m.l_sym == 439 && m.l_aa == 458);
+   CHECK(close_to(m.t3s, 0.4336734693877551));
+   CHECK(close_to(m.g3s, 0.18518518518518517));
+
+   /* batches match single sequences on any No. of threads */
+   CHECK(codonw_score_batch(ctx, n, (const char *const *)seqs, lens, batch_counts,
+                            batch_metrics, 3) == CODONW_OK);
+   for (i = 0; i < n; i++)
+   {
+      CHECK(codonw_score(ctx, seqs[i], lens[i], &counts, &m) == CODONW_OK);
+      CHECK(same_counts(&counts, &batch_counts[i]));
+      CHECK(same_metrics(&m, &batch_metrics[i]));
+   }
+   CHECK(codonw_score_batch(ctx, n, (const char *const *)seqs, lens, NULL,
+                            batch_metrics, 1) == CODONW_OK);
+   CHECK(codonw_score_batch(ctx, 0, NULL, NULL, NULL, NULL, 2) == CODONW_OK);
+
+   /* partial codons, RNA and lower case */
+   CHECK(codonw_count(ctx, "AUGgcuTA", 8, &counts) == CODONW_OK);
+   CHECK(counts.codon_tot == 2 && counts.ncod[0] == 1 && counts.valid_stops == 0);
+   CHECK(codonw_count(ctx, "ATGGCT", 6, &counts2) == CODONW_OK);
+   CHECK(!memcmp(counts.ncod + 1, counts2.ncod + 1, 64 * sizeof(long)));
+   CHECK(codonw_count(ctx, NULL, 0, &counts) == CODONW_OK && counts.codon_tot == 0);
+
+   /* a translation table and w values given by the caller */
+   for (x = 0; x < 64; x++)
+      w[x] = 1.0;
+   opt.translation = standard;
+   opt.cai_w = w;
+   CHECK(codonw_create(&opt, &ctx2) == CODONW_OK);
+   CHECK(codonw_score(ctx, seqs[1], lens[1], &counts, &m) == CODONW_OK);
+   CHECK(codonw_score(ctx2, seqs[1], lens[1], &counts2, &m2) == CODONW_OK);
+   CHECK(same_counts(&counts, &counts2));
+   CHECK(close_to(m2.cai, 1.0) && m2.nc == m.nc && m2.gc3s == m.gc3s);
+   codonw_destroy(ctx2);
+
+   /* invalid arguments */
+   codonw_options_default(&opt);
+   opt.genetic_code = 8;
+   CHECK(codonw_create(&opt, &ctx2) == CODONW_EINVAL && ctx2 == NULL);
+   codonw_options_default(&opt);
+   opt.translation = "FFLL";
+   CHECK(codonw_create(&opt, &ctx2) == CODONW_EINVAL);
+   w[3] = -1.0;
+   opt.translation = NULL;
+   opt.cai_w = w;
+   CHECK(codonw_create(&opt, &ctx2) == CODONW_EINVAL);
+   CHECK(codonw_count(ctx, NULL, 3, &counts) == CODONW_EINVAL);
+   seqs[n] = NULL;
+   lens[n] = 3;
+   CHECK(codonw_score_batch(ctx, n + 1, (const char *const *)seqs, lens, NULL, NULL, 1) ==
+         CODONW_EINVAL);
+
+   CHECK(!strcmp(codonw_strerror(CODONW_EINVAL), "Invalid argument"));
+   CHECK(!strcmp(codonw_version(), CODONW_VERSION));
+
+   codonw_destroy(ctx);
+   for (i = 0; i < n; i++)
+      free(seqs[i]);
+
+   if (failures)
+      fprintf(stderr, "%d checks failed\n", failures);
+   return failures ? 1 : 0;
+}
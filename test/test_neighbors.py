@@ -0,0 +1,121 @@
+"""
+
+codonw-slim tests of the nearest neighbour index
+
+"""
+
+import os
+
+import numpy as np
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+@pytest.fixture(scope="module")
+def counts():
+    # perturbed copies of the test genes, so that there are close pairs
+    rng = np.random.default_rng(5)
+    base = codonw.count_sequences([s for _, s in test_records])
+    ncod = np.concatenate([base.ncod] + [base.ncod + rng.integers(0, 3, base.ncod.shape)
+                                         for _ in range(9)])
+    ids = ["g{}".format(i) for i in range(len(ncod))]
+    return codonw.CodonCounts(ids, ncod, np.zeros([len(ncod), 22], dtype=ncod.dtype))
+
+
+def brute_force(index_counts, query_counts, metric, on, k):
+    full = np.concatenate([b for _, b in codonw.distance_blocks(
+        query_counts, index_counts, metric=metric, on=on)])
+    return full, np.sort(full, axis=1)[:, :k]
+
+
+@pytest.mark.parametrize("metric,on", [("euclidean", "rscu"), ("manhattan", "freq")])
+@pytest.mark.parametrize("threads", [1, 4])
+def test_query(counts, metric, on, threads):
+    index = codonw.NeighborIndex.build(counts, metric, on, threads=threads)
+    assert len(index) == len(counts)
+    queries = counts.take(slice(0, 200))
+    ids, dist = index.query(queries, k=5, threads=threads)
+
+    full, expected = brute_force(counts, queries, metric, on, 5)
+    # the index holds single precision features
+    np.testing.assert_allclose(dist.values, expected, rtol=1e-5, atol=1e-6)
+    np.testing.assert_allclose(dist.values[:, 0], 0, atol=1e-6)
+    # each id is that of a sequence at the distance returned (ties aside)
+    rows = np.vectorize(list(counts.ids).index)(ids.values)
+    np.testing.assert_allclose(np.take_along_axis(full, rows, 1), dist.values,
+                               rtol=1e-5, atol=1e-6)
+
+
+def test_approximate(counts):
+    index = codonw.NeighborIndex.build(counts)
+    exact = index.query(counts, k=3)[1].values
+    approx = index.query(counts, k=3, eps=0.5)[1].values
+    assert (approx <= exact * 1.5 + 1e-9).all() and (approx >= exact - 1e-9).all()
+
+
+def test_save_load(counts, tmp_path):
+    index = codonw.NeighborIndex.build(counts, "manhattan", "freq", threads=3)
+    fn = str(tmp_path / "genes.vpt")
+    index.save(fn)
+    loaded = codonw.NeighborIndex.load(fn)
+    assert (loaded.metric, loaded.on, len(loaded)) == ("manhattan", "freq", len(counts))
+    assert list(loaded.ids) == list(counts.ids)
+
+    queries = counts.take(slice(100, 150))
+    for a, b in zip(index.query(queries, k=4), loaded.query(queries, k=4)):
+        np.testing.assert_array_equal(a.values, b.values)
+
+    with open(fn, "r+b") as fh:
+        fh.write(b"garbage!")
+    with pytest.raises(ValueError):
+        codonw.NeighborIndex.load(fn)
+    with pytest.raises(ValueError):
+        codonw.NeighborIndex.build(counts, "chi2")
+
+
+@pytest.mark.parametrize("ids,kind", [(np.arange(5) * 7, "i"), ([1.5, 2.5, 3.0, 4.0, 5.0], "f"),
+                                       (["a", "bb", "c", "d", "e"], "U"),
+                                       ([1, "b", 3, "d", 5], "U")])
+def test_save_load_ids(counts, tmp_path, ids, kind):
+    part = counts.take(slice(0, 5))
+    part = codonw.CodonCounts(ids, part.ncod, part.naa)
+    index = codonw.NeighborIndex.build(part)
+    fn = str(tmp_path / "ids.vpt")
+    index.save(fn)
+    loaded = codonw.NeighborIndex.load(fn)
+    assert loaded.ids.dtype.kind == kind
+    if kind == "U" and not isinstance(ids[0], str):
+        assert list(loaded.ids) == [str(i) for i in ids]  # mixed types
+    else:
+        assert list(loaded.ids) == list(ids)
+        assert type(loaded.ids[0]) is type(index.ids[0])
+    assert list(loaded.query(part, k=1)[0][0]) == list(loaded.ids)
+
+    empty = codonw.NeighborIndex.build(counts.take(slice(0, 0)))
+    empty.save(fn)
+    assert len(codonw.NeighborIndex.load(fn).ids) == 0
+
+
+def test_small(counts):
+    index = codonw.NeighborIndex.build(counts.take(slice(0, 3)))
+    ids, dist = index.query(counts.take(slice(0, 2)), k=5)
+    assert list(ids.values[0][3:]) == [None, None]
+    assert np.isnan(dist.values[0][3:]).all()
+    assert len(codonw.NeighborIndex.build(counts.take(slice(0, 0))).query(counts, k=1)[0]) == len(counts)
+
+
+def test_budget(counts):
+    index = codonw.NeighborIndex.build(counts, threads=2)
+    exact_ids, exact = index.query(counts, k=5)
+    ids, dist = index.query(counts, k=5, budget=200)
+    assert (dist.values >= exact.values - 1e-9).all()
+    # the query itself is still found nearly always
+    assert (ids.values[:, 0] == exact_ids.values[:, 0]).mean() > 0.5
@@ -0,0 +1,107 @@
+"""
+
+codonw-slim tests of correspondence and principal component analysis
+
+"""
+
+import os
+
+import numpy as np
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+@pytest.fixture(scope="module")
+def counts():
+    return codonw.count_sequences([s for _, s in test_records])
+
+
+def align(a, b):
+    """b with each column's sign flipped to match a"""
+    return b * np.sign((a * b).sum(axis=0))
+
+
+def test_ca(counts):
+    ca = codonw.codon_ca(counts, n_axes=3, threads=2)
+    assert len(ca.columns) == 59 and ca.gene_coords.shape == (len(counts), 3)
+
+    # reference: SVD of the standardised residuals
+    X = counts.ncod[:, ca.columns].astype(float)
+    P = X / X.sum()
+    r, c = P.sum(axis=1), P.sum(axis=0)
+    S = (P - np.outer(r, c)) / np.sqrt(np.outer(r, c))
+    U, sv, Vt = np.linalg.svd(S, full_matrices=False)
+    np.testing.assert_allclose(ca.inertia[:10], sv[:10] ** 2, rtol=1e-8, atol=1e-12)
+    assert ca.inertia.sum() == pytest.approx((S ** 2).sum())
+
+    rows = U[:, :3] * sv[:3] / np.sqrt(r)[:, None]
+    cols = Vt[:3].T * sv[:3] / np.sqrt(c)[:, None]
+    np.testing.assert_allclose(ca.gene_coords.values, align(ca.gene_coords.values, rows),
+                               rtol=1e-6, atol=1e-9)
+    np.testing.assert_allclose(ca.codon_coords.values, align(ca.codon_coords.values, cols),
+                               rtol=1e-6, atol=1e-9)
+    assert list(ca.codon_coords.index) == [codonw.ref_codons[i] for i in ca.columns]
+
+
+@pytest.mark.parametrize("on", ["rscu", "freq"])
+def test_pca(counts, on):
+    pca = codonw.codon_pca(counts, n_axes=4, on=on)
+    if on == "rscu":
+        X = np.array([codonw.CodonSeq(s).rscu().values for _, s in test_records])
+    else:
+        X = counts.ncod[:, 1:65] / counts.ncod[:, pca.columns].sum(axis=1, keepdims=True)
+    X = X[:, pca.columns - 1].astype(float)
+    values, vectors = np.linalg.eigh(np.cov(X.T))
+    vectors = vectors[:, ::-1][:, :4]
+    # RSCU of CodonSeq is single precision
+    np.testing.assert_allclose(pca.inertia, np.clip(values[::-1], 0, None), rtol=1e-5, atol=1e-6)
+    np.testing.assert_allclose(pca.codon_coords.values, align(pca.codon_coords.values, vectors),
+                               rtol=1e-4, atol=1e-5)
+    scores = (X - X.mean(axis=0)) @ pca.axes
+    np.testing.assert_allclose(pca.gene_coords.values, scores, rtol=1e-4, atol=1e-5)
+    assert pca.explained.sum() <= 1
+
+
+@pytest.mark.parametrize("method", [codonw.codon_ca, codonw.codon_pca])
+def test_parts(counts, method, tmp_path, monkeypatch):
+    whole = method(counts, threads=3)
+    fns = []
+    for k, (lo, hi) in enumerate([(0, 30), (30, 31), (31, len(counts))]):
+        fns.append(str(tmp_path / "part{}.npz".format(k)))
+        counts.take(slice(lo, hi)).astype("auto").save(fns[-1])
+
+    # each file is read once per pass
+    reads = []
+    load = codonw.CodonCounts.load
+    monkeypatch.setattr(codonw.CodonCounts, "load",
+                        staticmethod(lambda fn: reads.append(fn) or load(fn)))
+    parts = method(fns)
+    assert sorted(reads) == sorted(fns * 2)
+    np.testing.assert_allclose(parts.inertia, whole.inertia, rtol=1e-10, atol=1e-14)
+    np.testing.assert_allclose(parts.gene_coords.values, whole.gene_coords.values,
+                               rtol=1e-8, atol=1e-10)
+    np.testing.assert_allclose(whole.transform(counts.take(slice(5, 9))).values,
+                               whole.gene_coords.values[5:9])
+
+
+def test_errors(counts):
+    with pytest.raises(ValueError):
+        codonw.codon_ca([])
+    with pytest.raises(ValueError):
+        codonw.codon_pca(counts, on="counts")
+    with pytest.raises(ValueError):
+        codonw.codon_ca(counts, codons="some")
+
+    # sequences without any of the codons are left out and placed at NaN
+    seqs = ["", "ATG"] + [s for _, s in test_records[:5]]
+    pca = codonw.codon_pca(codonw.count_sequences(seqs))
+    assert np.isnan(pca.gene_coords.values[:2]).all()
+    np.testing.assert_allclose(pca.inertia, codonw.codon_pca(counts.take(slice(0, 5))).inertia)
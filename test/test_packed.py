@@ -0,0 +1,86 @@
+"""
+
+codonw-slim tests of sequences packed at 2 bits per base
+
+"""
+
+import os
+import pickle
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+odd = ["", "A", "acgtNNNNacgUUuRYKMacg" * 5, "ATG" + "N" * 70 + "GCAtta" * 20,
+       "GGGCCC" * 11 + "ACGT-*xx", "ACGT" * 40]
+
+
+@pytest.mark.parametrize("seq", [s for _, s in test_records[:10]] + odd)
+def test_packed_roundtrip(seq):
+    packed = codonw.PackedSeq(seq)
+    assert len(packed) == len(seq)
+    assert str(packed) == seq
+    for a, b in [(0, 5), (3, 40), (31, 97), (len(seq) - 7, len(seq) + 5)]:
+        assert packed[a:b] == seq[max(a, 0):b]
+
+    chunked = codonw.PackedSeq()
+    for k in range(0, len(seq), 13):
+        chunked.feed(seq[k:k + 13])
+    assert str(chunked) == seq
+
+
+@pytest.mark.parametrize("seq", [s for _, s in test_records[:10]] + odd)
+def test_packed_kernels(seq):
+    plain = codonw.CodonSeq(seq)
+    packed = codonw.CodonSeq(seq, pack=True)
+    assert packed.seq is None and str(packed.packed) == seq
+    np.testing.assert_array_equal(packed.ncod, plain.ncod)
+    np.testing.assert_array_equal(packed.naa, plain.naa)
+    assert packed.codon_tot == plain.codon_tot
+    assert packed.valid_stops == plain.valid_stops
+    pd.testing.assert_frame_equal(packed.dinuc(pct=False), plain.dinuc(pct=False))
+
+    for a, b in [(0, len(seq)), (1, len(seq) - 2), (5, 50)]:
+        part = packed.packed.codon_usage(a, b, genetic_code=1)
+        ref = codonw.CodonSeq(seq[a:b], genetic_code=1)
+        np.testing.assert_array_equal(part.ncod, ref.ncod)
+        np.testing.assert_array_equal(part.naa, ref.naa)
+        assert part.valid_stops == ref.valid_stops
+
+
+def test_packed_windows():
+    seq = "".join(s for _, s in test_records[:3]) + "NNNNNNNNNN" + "gcGCat"
+    packed = codonw.PackedSeq(seq)
+    for width, step in [(100, None), (64, 17), (1000, 250), (5, 3)]:
+        df = packed.gc_windows(width, step)
+        step = step or width
+        assert df['start'].iloc[-1] + width >= len(seq)
+        for _, w in df.iterrows():
+            sub = seq[int(w['start']):int(w['end'])].upper()
+            assert w['GC'] == sub.count('G') + sub.count('C')
+            assert w['valid'] == sum(sub.count(b) for b in 'ACGTU')
+    assert len(codonw.PackedSeq("").gc_windows(10)) == 0
+
+
+def test_packed_stream():
+    seq = "".join(s for _, s in test_records) + "nnacgu"
+    stream = codonw.CodonStream(pack=True)
+    for k in range(0, len(seq), 5000):
+        stream.feed(seq[k:k + 5000])
+    cseq = stream.finish()
+    assert str(cseq.packed) == seq
+    np.testing.assert_array_equal(cseq.ncod, codonw.CodonSeq(seq).ncod)
+    # at most twice the 2 bits of each base, as the words grow by doubling
+    assert cseq.packed.nbytes <= len(seq) / 2 + 64
+
+    # the packed sequence is not pickled, as the bytes are not
+    again = pickle.loads(pickle.dumps(codonw.CodonSeq(seq, pack=True)))
+    assert again.packed is None
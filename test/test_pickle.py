@@ -0,0 +1,68 @@
+"""
+
+codonw-slim tests of pickling, e.g. to pass objects between processes
+
+"""
+
+import os
+import pickle
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_seqs = [str(r.seq) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def check_same(ref, test):
+    np.testing.assert_array_equal(ref.ncod, test.ncod)
+    np.testing.assert_array_equal(ref.naa, test.naa)
+    assert ref.codon_tot == test.codon_tot
+    assert ref.valid_stops == test.valid_stops
+    pd.testing.assert_series_equal(ref.genetic_code, test.genetic_code)
+    assert ref.cai() == test.cai()
+    assert ref.enc() == test.enc()
+    pd.testing.assert_series_equal(ref.rscu(), test.rscu())
+
+
+@pytest.mark.parametrize("protocol", range(2, pickle.HIGHEST_PROTOCOL + 1))
+@pytest.mark.parametrize("code", [0, 1])
+def test_pickle(protocol, code):
+    ref = codonw.CodonSeq(test_seqs[0], code)
+    data = pickle.dumps(ref, protocol=protocol)
+    check_same(ref, pickle.loads(data))
+    # the sequence is not sent along
+    assert len(data) < len(test_seqs[0])
+
+
+def test_pickle_custom_code():
+    code = codonw.get_reference_code(0)
+    code['TGA'] = 'W'
+    ref = codonw.CodonSeq(test_seqs[1], code)
+    check_same(ref, pickle.loads(pickle.dumps(ref)))
+
+
+def test_pickle_out_of_band():
+    ref = codonw.CodonSeq(test_seqs[2])
+    buffers = []
+    data = pickle.dumps(ref, protocol=5, buffer_callback=buffers.append)
+    assert len(buffers) == 2
+    check_same(ref, pickle.loads(data, buffers=buffers))
+
+
+def test_pickle_dinuc():
+    stream = codonw.CodonStream()
+    stream.feed(test_seqs[3])
+    ref = stream.finish()
+    test = pickle.loads(pickle.dumps(ref))
+    pd.testing.assert_frame_equal(ref.dinuc(), test.dinuc())
+
+    with pytest.raises(ValueError):
+        pickle.loads(pickle.dumps(codonw.CodonSeq(test_seqs[3]))).dinuc()
@@ -0,0 +1,77 @@
+"""
+
+codonw-slim tests of codon usage profiles by position
+
+"""
+
+import os
+
+import numpy as np
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_seqs = [str(r.seq) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def reference_profile(seqs, mode, bins, width):
+    """Sums the codons of each bin by slicing every sequence"""
+    ncod = np.zeros([bins, 65], dtype=int)
+    naa = np.zeros([bins, 22], dtype=int)
+    genes = np.zeros(bins, dtype=int)
+    for seq in seqs:
+        n = len(seq) // 3
+        for b in range(bins):
+            if mode == "start":
+                idx = range(b * width, min((b + 1) * width, n))
+            elif mode == "end":
+                idx = range(max(n - (b + 1) * width, 0), n - b * width)
+            else:
+                idx = [i for i in range(n) if i * bins // n == b]
+            part = "".join(seq[3 * i:3 * i + 3] for i in idx)
+            if part:
+                cseq = codonw.CodonSeq(part)
+                ncod[b] += cseq.ncod
+                naa[b] += cseq.naa
+                genes[b] += 1
+    return ncod, naa, genes
+
+
+@pytest.mark.parametrize("mode,bins,width", [("start", 12, 5), ("end", 7, 20),
+                                             ("relative", 10, 1)])
+@pytest.mark.parametrize("threads", [1, 3])
+def test_codon_profile(mode, bins, width, threads):
+    seqs = test_seqs + ["ATGNNNTAA", "AT", ""]
+    counts, genes = codonw.codon_profile(seqs, mode, bins, width, threads=threads, genes=True)
+    assert len(counts) == bins
+
+    ncod, naa, ngenes = reference_profile(seqs, mode, bins, width)
+    np.testing.assert_array_equal(counts.ncod, ncod)
+    np.testing.assert_array_equal(counts.naa, naa)
+    np.testing.assert_array_equal(counts.codon_tot, ncod.sum(axis=1))
+    np.testing.assert_array_equal(genes.values, ngenes)
+
+    if mode == "relative":
+        assert list(counts.ids) == [b / bins for b in range(bins)]
+    else:
+        assert list(counts.ids) == [b * width for b in range(bins)]
+
+
+def test_codon_profile_indices():
+    counts = codonw.codon_profile(test_seqs, bins=4, width=30)
+    df = counts.indices(['CAI', 'GC3s'])
+    part = "".join(s[90:180] for s in test_seqs if len(s) >= 180) + \
+        "".join(s[90:len(s) // 3 * 3] for s in test_seqs if 90 < len(s) < 180)
+    cseq = codonw.CodonSeq(part)
+    assert df['CAI'].iloc[1] == pytest.approx(cseq.cai())
+    assert df['GC3s'].iloc[1] == pytest.approx(cseq.bases2()['GC3s'])
+
+    with pytest.raises(ValueError):
+        codonw.codon_profile(test_seqs, "middle")
+    with pytest.raises(ValueError):
+        codonw.codon_profile(test_seqs, bins=0)
@@ -0,0 +1,89 @@
+"""
+
+codonw-slim tests of protein properties from amino acid counts
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+from Bio.Seq import Seq
+from Bio.SeqUtils.ProtParam import ProteinAnalysis
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def protein(seq):
+    """Translation without stops or partial codons"""
+    seq = seq[:len(seq) - len(seq) % 3]
+    return str(Seq(seq).translate()).replace('*', '')
+
+
+def charge(prot, ph):
+    """Net charge as Bio.SeqUtils.IsoelectricPoint, with the default
+    pK of the termini"""
+    pos = {'K': 10.0, 'R': 12.0, 'H': 5.98}
+    neg = {'D': 4.05, 'E': 4.45, 'C': 9.0, 'Y': 10.0}
+    q = 1 / (10 ** (ph - 7.5) + 1) - 1 / (10 ** (3.55 - ph) + 1)
+    q += sum(prot.count(a) / (10 ** (ph - pk) + 1) for a, pk in pos.items())
+    q -= sum(prot.count(a) / (10 ** (pk - ph) + 1) for a, pk in neg.items())
+    return q
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_protein_properties(threads):
+    seqs = [s for _, s in test_records]
+    counts = codonw.count_sequences(seqs, dtype="auto")
+    df = counts.protein_properties(threads=threads, ph=6.5)
+    assert list(df.columns) == codonw.protein_names
+
+    for i, seq in enumerate(seqs):
+        prot = protein(seq)
+        ref = ProteinAnalysis(prot)
+        row = df.iloc[i]
+        assert row['MW'] == pytest.approx(ref.molecular_weight(), rel=1e-9)
+        assert row['Gravy'] == pytest.approx(ref.gravy(), abs=1e-6)
+        assert row['Aromo'] == pytest.approx(ref.aromaticity(), rel=1e-9)
+        assert row['Extinction'] == ref.molar_extinction_coefficient()[0]
+        aliphatic = 100 * (prot.count('A') + 2.9 * prot.count('V') +
+                           3.9 * (prot.count('I') + prot.count('L'))) / len(prot)
+        assert row['Aliphatic'] == pytest.approx(aliphatic)
+        assert row['Charge'] == pytest.approx(charge(prot, 6.5))
+        assert abs(charge(prot, row['pI'])) < 1e-4
+
+    cseq = codonw.CodonSeq(seqs[0])
+    pd.testing.assert_series_equal(cseq.protein_properties(ph=6.5), df.iloc[0],
+                                   check_names=False)
+
+
+def test_protein_scales():
+    seqs = [s for _, s in test_records[:5]]
+    counts = codonw.count_sequences(seqs + [""])
+    kd = pd.Series({'A': 1.8, 'R': -4.5, 'N': -3.5, 'D': -3.5, 'C': 2.5,
+                    'Q': -3.5, 'E': -3.5, 'G': -0.4, 'H': -3.2, 'I': 4.5,
+                    'L': 3.8, 'K': -3.9, 'M': 1.9, 'F': 2.8, 'P': -1.6,
+                    'S': -0.8, 'T': -0.7, 'W': -0.9, 'Y': -1.3, 'V': 4.2})
+    bulk = {a: float(i) for i, a in enumerate(kd.index)}
+    df = counts.protein_properties(['kd', 'Gravy', 'bulk'], scales={'kd': kd, 'bulk': bulk})
+    assert list(df.columns) == ['kd', 'Gravy', 'bulk']
+    np.testing.assert_allclose(df['kd'][:5], df['Gravy'][:5], rtol=1e-6)
+    for i, seq in enumerate(seqs):
+        prot = protein(seq)
+        assert df['bulk'].iloc[i] == pytest.approx(np.mean([bulk[a] for a in prot]))
+    assert df.iloc[5].isna().all()
+
+    with pytest.raises(ValueError):
+        counts.protein_properties(scales={'kd': kd.drop('W')})
+    with pytest.raises(ValueError):
+        counts.protein_properties(scales={'MW': kd})
+    with pytest.raises(ValueError):
+        counts.protein_properties(['nope'])
@@ -0,0 +1,53 @@
+"""
+
+codonw-slim tests of codon usage of ranges of one sequence
+
+"""
+
+import os
+
+import numpy as np
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+genome = "".join(str(r.seq) for r in Bio.SeqIO.parse(seq_fn, "fasta"))[:20000] + "NNACGTR"
+
+
+@pytest.mark.parametrize("step", [1, 5, 64])
+def test_ranges_match_slices(step):
+    rng = np.random.default_rng(35)
+    starts = rng.integers(0, len(genome), 300)
+    ends = starts + rng.integers(0, 900, 300)
+    ranges = np.stack([starts, np.minimum(ends, len(genome))], axis=1)
+    ranges = np.concatenate([ranges, [[0, len(genome)], [0, 0], [len(genome) - 5, len(genome)]]])
+
+    index = codonw.CodonIndex(genome, step=step)
+    counts = index.counts(ranges, threads=3)
+    for i, (start, end) in enumerate(ranges):
+        ref = codonw.CodonSeq(genome[start:end])
+        np.testing.assert_array_equal(counts.ncod[i], ref.ncod)
+        np.testing.assert_array_equal(counts.naa[i], ref.naa)
+        assert counts.codon_tot[i] == ref.codon_tot
+        assert counts.valid_stops[i] == ref.valid_stops
+
+
+def test_range_indices():
+    index = codonw.CodonIndex(genome, genetic_code=1)
+    ranges = [(3, 903), (10, 1510), (200, 4000)]
+    df = index.indices(ranges, ['CAI', 'GC3s'], ids=['a', 'b', 'c'])
+    assert list(df.index) == ['a', 'b', 'c']
+    for (start, end), (_, row) in zip(ranges, df.iterrows()):
+        ref = codonw.CodonSeq(genome[start:end], 1)
+        assert row['CAI'] == ref.cai()
+        assert row['GC3s'] == ref.bases2()['GC3s']
+
+    with pytest.raises(ValueError):
+        index.counts([(0, len(genome) + 1)])
+    with pytest.raises(ValueError):
+        index.counts([(10, 5)])
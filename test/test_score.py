@@ -0,0 +1,72 @@
+"""
+
+codonw-slim tests of scoring many sequences against many references
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+@pytest.fixture(scope="module")
+def counts():
+    return codonw.count_sequences(pd.Series([s for _, s in test_records],
+                                            index=[r for r, _ in test_records]))
+
+
+@pytest.mark.parametrize("threads", [1, 3])
+def test_builtin_references(counts, threads):
+    cai = codonw.score_references(counts, [0, 1, 2], threads=threads)
+    fop = codonw.score_references(counts, range(8), "Fop", threads=threads)
+    rare = codonw.score_references(counts, range(8), "Fop", factor_in_rare=True)
+    assert list(cai.index) == list(counts.ids) and list(cai.columns) == [0, 1, 2]
+    for i, (_, seq) in enumerate(test_records):
+        cseq = codonw.CodonSeq(seq)
+        np.testing.assert_allclose(cai.values[i], [cseq.cai(r) for r in range(3)], rtol=1e-12)
+        np.testing.assert_allclose(fop.values[i], [cseq.fop(False, r) for r in range(8)], rtol=1e-6)
+        np.testing.assert_allclose(rare.values[i], [cseq.fop(True, r) for r in range(8)],
+                                   rtol=1e-6, atol=1e-7)
+
+
+def test_many_references(counts):
+    rng = np.random.default_rng(1)
+    w = pd.DataFrame(rng.uniform(0, 1, [600, 64]), columns=codonw.ref_codons[1:65],
+                     index=["host{}".format(r) for r in range(600)])
+    w.iloc[:, 5] = 0  # raised to 0.01 as for CodonSeq.cai
+    # codons may be given with T and in any order
+    shuffled = w[w.columns[::-1]].rename(columns=lambda c: c.replace('U', 'T'))
+    scores = codonw.score_references(counts, shuffled, threads=2)
+
+    cseq = codonw.CodonSeq("ATG")
+    code = cseq.genetic_code[codonw.ref_codons[1:65]].values
+    ncod = counts.ncod[:, 1:65].astype(float)
+    skip = np.array([a in ('*', 'M', 'W') for a in code])
+    logw = np.log(np.where(w.values < 0.0001, 0.01, w.values))
+    logw[:, skip] = 0
+    tot = ncod[:, ~skip].sum(axis=1)
+    expected = np.exp(ncod @ logw.T / tot[:, None])
+    np.testing.assert_allclose(scores.values, expected, rtol=1e-10)
+
+    names, best = codonw.score_references(counts.astype("auto"), w, top=5, threads=3)
+    order = np.argsort(-expected, axis=1, kind="stable")[:, :5]
+    np.testing.assert_array_equal(names.values, w.index.values[order])
+    np.testing.assert_allclose(best.values, np.take_along_axis(expected, order, 1), rtol=1e-10)
+
+    with pytest.raises(ValueError):
+        codonw.score_references(counts, w.iloc[:, :60])
+    with pytest.raises(ValueError):
+        codonw.score_references(counts, [5])
+    with pytest.raises(ValueError):
+        codonw.score_references(counts, np.full([2, 64], 4), "Fop")
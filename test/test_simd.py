@@ -0,0 +1,98 @@
+"""
+
+codonw-slim tests of the instruction set variants of the counting kernels
+
+"""
+
+import os
+import sys
+import subprocess
+
+import numpy as np
+
+import pytest
+
+import codonw
+
+features = codonw.cpu_features()
+
+
+@pytest.fixture
+def random_seqs():
+    rng = np.random.default_rng(33)
+    alphabet = np.frombuffer(b"ACGTUacgtuNn-*\xd4\xf4 ", dtype=np.uint8)
+    weights = np.array([10] * 10 + [1] * 7, dtype=float)
+    seqs = []
+    for n in [0, 1, 2, 3, 5, 767, 768, 769, 4096 * 3 + 7, 20000]:
+        seq = rng.choice(alphabet, n, p=weights / weights.sum()).tobytes()
+        seqs.append(seq.decode('latin-1'))
+    return seqs
+
+
+def counts_with(isa, seqs):
+    codonw.select_isa(isa)
+    try:
+        results = []
+        for seq in seqs:
+            stream = codonw.CodonStream()
+            for k in range(0, len(seq), 1000):
+                stream.feed(seq[k:k + 1000].encode('latin-1'))
+            cseq = stream.finish()
+            results.append((np.asarray(cseq.ncod).copy(), np.asarray(cseq.naa).copy(),
+                            cseq.codon_tot, cseq.valid_stops,
+                            cseq.dinuc(pct=False).values.copy()))
+        return results
+    finally:
+        codonw.select_isa(features['active'])
+
+
+def test_cpu_features():
+    assert features['active'] in features['available']
+    assert set(features['available']) <= set(features['built'])
+    assert {'scalar', 'baseline'} <= set(features['available'])
+    with pytest.raises(ValueError):
+        codonw.select_isa('nope')
+
+
+@pytest.mark.parametrize("isa", features['available'])
+def test_variants_match_scalar(isa, random_seqs):
+    ref = counts_with('scalar', random_seqs)
+    test = counts_with(isa, random_seqs)
+    for r, t in zip(ref, test):
+        for a, b in zip(r, t):
+            np.testing.assert_array_equal(a, b)
+
+
+@pytest.mark.parametrize("isa", features['available'])
+def test_isa_environment(isa):
+    code = "import codonw; print(codonw.cpu_features()['active'])"
+    env = dict(os.environ, CODONW_ISA=isa)
+    out = subprocess.run([sys.executable, "-c", code], env=env, cwd=os.getcwd(),
+                         capture_output=True, text=True, check=True)
+    assert out.stdout.strip() == isa
+
+
+@pytest.mark.parametrize("isa", features['available'])
+def test_score_variants(isa, random_seqs):
+    counts = codonw.count_sequences([s.encode('latin-1') for s in random_seqs])
+    refs = np.random.default_rng(3).uniform(0, 1, [300, 64])
+    ref = codonw.score_references(counts, refs).values
+    codonw.select_isa(isa)
+    try:
+        test = codonw.score_references(counts, refs).values
+    finally:
+        codonw.select_isa(features['active'])
+    np.testing.assert_allclose(test, ref, rtol=1e-12)
+
+
+@pytest.mark.parametrize("isa", features['available'])
+@pytest.mark.parametrize("metric", ["euclidean", "manhattan", "chi2", "karlin"])
+def test_distance_variants(isa, metric, random_seqs):
+    counts = codonw.count_sequences([s.encode('latin-1') for s in random_seqs] * 30)
+    ref = codonw.codon_distances(counts, metric)
+    codonw.select_isa(isa)
+    try:
+        test = codonw.codon_distances(counts, metric)
+    finally:
+        codonw.select_isa(features['active'])
+    np.testing.assert_allclose(test, ref, rtol=1e-12, atol=1e-14)
@@ -0,0 +1,67 @@
+"""
+
+codonw-slim tests of chunked (streaming) counting
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_seqs = [str(r.seq) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+
+def feed_chunks(seq, size, **kwargs):
+    stream = codonw.CodonStream(**kwargs)
+    for i in range(0, len(seq), size):
+        stream.feed(seq[i:i + size])
+    return stream.finish()
+
+
+@pytest.mark.parametrize("size", [1, 2, 5, 64, 10**6])
+def test_stream_matches_whole(size):
+    for seq in test_seqs[:20]:
+        ref = codonw.CodonSeq(seq)
+        test = feed_chunks(seq, size)
+
+        np.testing.assert_array_equal(ref.ncod, test.ncod)
+        np.testing.assert_array_equal(ref.naa, test.naa)
+        assert ref.codon_tot == test.codon_tot
+        assert ref.valid_stops == test.valid_stops
+        pd.testing.assert_frame_equal(ref.dinuc(), test.dinuc())
+        assert ref.cai() == test.cai()
+        assert ref.enc() == test.enc()
+
+
+@pytest.mark.parametrize("seq", ["", "A", "AT", "ATG", "ATGTA", "TAA"])
+def test_short_sequences(seq):
+    ref = codonw.CodonSeq(seq)
+    test = feed_chunks(seq, 1)
+    np.testing.assert_array_equal(ref.ncod, test.ncod)
+    assert ref.codon_tot == test.codon_tot == len(seq) // 3
+    assert ref.valid_stops == test.valid_stops
+
+
+def test_stream_concatenated():
+    seq = "".join(test_seqs)
+    test = feed_chunks(seq, 4099, dinuc=False)
+    assert test.codon_tot == len(seq) // 3
+    with pytest.raises(ValueError):
+        test.dinuc()
+
+
+def test_stream_finished():
+    stream = codonw.CodonStream()
+    stream.feed("ATGAAA")
+    stream.finish()
+    with pytest.raises(ValueError):
+        stream.feed("ATG")
@@ -0,0 +1,110 @@
+"""
+
+codonw-slim tests of summaries of the distribution of indices
+
+"""
+
+import os
+
+import numpy as np
+import pandas as pd
+
+import pytest
+import Bio.SeqIO
+
+import codonw
+
+# location of *this* script
+path = os.path.dirname(os.path.realpath(__file__))
+seq_fn = "{}/input.fna".format(path)
+test_records = [(r.id, str(r.seq)) for r in Bio.SeqIO.parse(seq_fn, "fasta")]
+
+cols = ['CAI', 'Nc', 'GC3s', 'Fop', 'L_aa']
+
+
+def check_summary(summary, df, group):
+    values = df.values
+    for k, name in enumerate(summary.indices):
+        v = values[:, k]
+        ok = v[~np.isnan(v)]
+        assert summary.count[group, k] == len(ok)
+        assert summary.nan[group, k] == np.isnan(v).sum()
+        assert summary.mean[group, k] == pytest.approx(ok.mean())
+        assert summary.var[group, k] == pytest.approx(ok.var(ddof=1))
+        assert summary.min[group, k] == ok.min()
+        assert summary.max[group, k] == ok.max()
+
+        lo, hi = summary.lo[k], summary.hi[k]
+        inner = np.histogram(ok[(ok >= lo) & (ok < hi)], summary.bins, (lo, hi))[0]
+        hist = summary.hist[group, k]
+        assert hist[0] == (ok < lo).sum() and hist[-1] == (ok >= hi).sum()
+        np.testing.assert_array_equal(hist[1:-1], inner)
+
+        q = summary.quantile([0.1, 0.5, 0.9])[:, group, k]
+        assert (np.diff(q) >= 0).all() and q[0] >= ok.min() and q[-1] <= ok.max()
+        if len(ok) >= 50 and name != 'L_aa':
+            # within a bin (and a rank) of the exact ones
+            width = (hi - lo) / summary.bins
+            exact = np.quantile(ok, [0.1 - 1 / len(ok), 0.5, 0.9 + 1 / len(ok)])
+            assert (q[0] >= exact[0] - width) and (q[-1] <= exact[-1] + width)
+            assert abs(q[1] - exact[1]) <= width + np.ptp(ok) / len(ok)
+
+
+@pytest.mark.parametrize("threads", [1, 4])
+def test_summarize(threads):
+    counts = codonw.count_sequences([s for _, s in test_records])
+    summary = codonw.summarize_indices(counts, cols, bins=50, threads=threads)
+    assert list(summary.groups) == ["all"]
+    check_summary(summary, counts.indices(cols), 0)
+
+    table = summary.table()
+    assert list(table.index.get_level_values('index')) == cols
+    assert table.loc[("all", "CAI"), "count"] == len(counts)
+
+
+def test_summarize_groups_and_merge():
+    seqs = [s for _, s in test_records]
+    groups = ["a" if i % 3 else "b" for i in range(len(seqs))]
+    counts = codonw.count_sequences(seqs)
+    df = counts.indices(cols)
+    summary = counts.summarize(cols, groups=groups, threads=3)
+    assert list(summary.groups) == ["b", "a"]
+    for g, key in enumerate(summary.groups):
+        check_summary(summary, df[np.array(groups) == key], g)
+
+    # summaries of parts merge into that of the whole
+    half = len(seqs) // 2
+    parts = [codonw.summarize_indices(counts.take(slice(lo, hi)), cols, groups=groups[lo:hi])
+             for lo, hi in [(0, half), (half, len(seqs))]]
+    merged = parts[0] + parts[1]
+    np.testing.assert_array_equal(merged.count, summary.count)
+    np.testing.assert_array_equal(merged.hist, summary.hist)
+    np.testing.assert_allclose(merged.mean, summary.mean)
+    np.testing.assert_allclose(merged.m2, summary.m2)
+
+    with pytest.raises(ValueError):
+        merged.merge(codonw.summarize_indices(counts, cols, bins=10))
+    with pytest.raises(ValueError):
+        codonw.summarize_indices(counts, ['nope'])
+    with pytest.raises(ValueError):
+        codonw.summarize_indices(counts, cols, ranges={'CAI': (1, 0)})
+
+
+def test_scan_files_summary(tmp_path):
+    paths = []
+    for f in range(3):
+        fn = str(tmp_path / "g{}.fna".format(f))
+        with open(fn, 'w') as fh:
+            for rid, seq in test_records[f * 7:(f + 1) * 7]:
+                fh.write(">{}\n{}\n".format(rid, seq))
+        paths.append(fn)
+
+    per_file, per_gene, summary = codonw.scan_files(paths, genes=True, summary=cols, threads=2)
+    assert list(summary.groups) == paths
+    df = per_gene.indices(cols)
+    for g, fn in enumerate(paths):
+        check_summary(summary, df[per_gene.groups == fn], g)
+
+    per_file, summary = codonw.scan_files(paths, summary=True)
+    assert summary.indices == codonw.index_names
+    assert len(per_file) == 3